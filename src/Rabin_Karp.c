@@ -1,87 +1,85 @@
 #include "Rabin_Karp.h"
-#include "clean_buff.h"
+#include "chunk_scan.h"
 
-/*Function to calculate the rolling hash for the first window of chunk.
+/*Function to get the degree of a polynomial over GF(2).
 Input:
-        char* buffer            : Buffer to store window content
-        y_uint32 *power         : Stores the value PRIME^window length
-        int *ret                : To return the status 0 on success,
-                                -1 on failure
+        rabin_poly p    : Polynomial
 Output:
-        y_uint32 hash_value     : Rolling hash of a first window of chunk.
+        int             : Degree, -1 for the zero polynomial
 */
-y_uint32
-calc_hash (char *buffer, y_uint32 *power, int *ret)
+static int
+poly_degree(rabin_poly p)
 {
 
-        int             i               =       0;
-        y_uint32        hash_value      =       0;
+        if (p == 0)
+                return -1;
+        return 63 - __builtin_clzll(p);
 
-        *power           =       1;
+}
 
-        if (buffer == NULL) {
-                *ret    = -1;
-                return    -1;
-        }
+/*Function to reduce a polynomial modulo another over GF(2).
+Input:
+        rabin_poly x    : Dividend
+        rabin_poly d    : Divisor
+Output:
+        rabin_poly      : Remainder
+*/
+static rabin_poly
+poly_mod(rabin_poly x, rabin_poly d)
+{
 
-        /*calculates the rolling hash for the first window of chunk and
-         power's PRIME with window length*/
-        for (i = 0; i < N; i++) {
-                hash_value = (PRIME * hash_value + buffer[i]) % M;
-                *power = (*power * PRIME) % M;
-        }
-        *ret = 0;
-        return hash_value;
+        int     deg     =       poly_degree(d);
 
-}
+        while (poly_degree(x) >= deg)
+                x ^= d << (poly_degree(x) - deg);
+        return x;
 
-/*Function to keep track remaining content of previous buffer when there
- is no match with fingerprint
+}
 
+/*Function to fill in the defaults of chunker parameters and check them.
 Input:
-        ssize_t remaining_length       : Remaining length of the
-                                        previous buffer
-        char** remaining_buffer_content: Contains remaining content of
-                                        the previous buffer
-        char** remaining_window_content: Contains remaining content of
-                                        the previous window
-        char** buffer                  : Contains current buffer content
-        ssize_t start                  : Starting offset of buffer
+        struct chunk_params *params : Parameters, 0 fields take defaults
 Output:
-        int     ret                    : 0 on success, -1 on failure
+        int             : 0 on success, -1 on invalid parameters
 */
 int
-get_remaining_buffer_content(char **remaining_buffer_content,
-        char **remaining_window_content, ssize_t remaining_length,
-        char **buffer, ssize_t start)
+resolve_chunk_params(struct chunk_params *params)
 {
 
-        int ret =       -1;
+        int     ret     =       -1;
 
-        *remaining_buffer_content = (char *)calloc(1,
-                remaining_length + 1);
-        if (*remaining_buffer_content == NULL) {
-                fprintf (stderr,
-                        "Error in buffer allocation\n");
+        if (params->window == 0)
+                params->window = RABIN_WINDOW;
+        if (params->avg_size != 0) {
+                params->mask_bits = 0;
+                while (((size_t)2 << params->mask_bits) <= params->avg_size)
+                        params->mask_bits++;
+        } else if (params->mask_bits == 0) {
+                params->mask_bits = RABIN_MASK_BITS;
+        }
+        if (params->mask_bits < RABIN_MASK_BITS_MIN ||
+                params->mask_bits > RABIN_MASK_BITS_MAX) {
+                fprintf(stderr, "Average chunk size has to be between %d "
+                        "and %d\n", 1 << RABIN_MASK_BITS_MIN,
+                        1 << RABIN_MASK_BITS_MAX);
                 goto out;
         }
-        memcpy (*remaining_buffer_content, *buffer + start,
-                remaining_length);
-
-        /*remaining_window_content holds last window content of previous
-          buffer, if remaining length of previous buffer is greater then
-          window size*/
-        if (remaining_length >= N) {
-                *remaining_window_content = (char *)calloc
-                        (1, N + 1);
-                if (*remaining_window_content == NULL) {
-                        fprintf (stderr,
-                                "Error in buffer allocation\n");
-                        goto out;
-                }
-
-                memcpy (*remaining_window_content,
-                        *buffer + BUFFER_LEN - N, N);
+        params->avg_size = (size_t)1 << params->mask_bits;
+        if (params->min_size == 0)
+                params->min_size = params->avg_size / 4;
+        if (params->max_size == 0)
+                params->max_size = params->avg_size * 8;
+        if (params->window < 1 || params->window > RABIN_WINDOW_MAX) {
+                fprintf(stderr, "Chunk window has to be between 1 and %d\n",
+                        RABIN_WINDOW_MAX);
+                goto out;
+        }
+        if (params->min_size > params->avg_size ||
+                params->avg_size > params->max_size ||
+                params->max_size > CHUNK_SIZE_MAX) {
+                fprintf(stderr, "Chunk sizes have to satisfy min <= avg <= "
+                        "max <= %d\n", CHUNK_SIZE_MAX);
+                goto out;
         }
         ret = 0;
 out:
@@ -89,350 +87,350 @@ out:
 
 }
 
-/*Function to get the chunk when there is a match with fingerprint
+/*Function to fill in a fingerprint configuration.
 Input:
-        ssize_t* remaining_length      : Remaining length of the
-                                        previous buffer
-        char** remaining_buffer_content: Contains remaining content of
-                                        the previous buffer
-        char** remaining_window_content: Contains remaining content of
-                                        the previous window
-        char** chunk_buffer            : Holds the chunk content
-        char** buffer                  : Contains current buffer content
-        ssize_t start                  : Starting offset of buffer
-        ssize_t end                    : Ending offset of buffer
-        ssize_t slide_incr             : Keeps track of buffer sliding
-        ssize_t* remaining_content_incr: Keeps track of sliding of
-                                        previous buffer
+        struct rabin_config *cfg    : Configuration to fill in
+        struct chunk_params *params : Parameters, NULL for defaults
 Output:
-        int     ret                    : 0 on success, -1 on failure
+        int             : 0 on success, -1 on failure
 */
 int
-get_chunk_buffer(ssize_t *remaining_content_incr, ssize_t *remaining_length,
-        char **chunk_buffer, char **buffer, char **remaining_buffer_content,
-        char **remaining_window_content, ssize_t start, ssize_t end,
-        ssize_t slide_incr, int *chunk_length)
+init_rabin_config(struct rabin_config *cfg, struct chunk_params *params)
 {
 
-        ssize_t chunk_size      =       0;
-        int     ret             =      -1;
-
-        /*Generates the chunk by combining previous
-        buffer content with current buffer content upto
-        where the fingerprint is matched*/
-        if (*remaining_content_incr != 0) {
-                chunk_size = *remaining_length + end;
-                *chunk_buffer = (char *)calloc
-                        (1, chunk_size+1);
-                if (*chunk_buffer == NULL) {
-                        fprintf (stderr, "Error in buffer allocation\n");
-                        goto out;
-                }
+        int             ret     =       -1;
+        int             b       =        0;
+        int             i       =        0;
+        rabin_poly      h       =        0;
 
-                memcpy (*chunk_buffer, *remaining_buffer_content,
-                        *remaining_length);
-                memcpy (*chunk_buffer + *remaining_length, *buffer,
-                        end);
-                *chunk_length = *remaining_length + end;
-                *remaining_content_incr  = 0;
-                *remaining_length        = 0;
-                clean_buff(remaining_window_content);
-                clean_buff(remaining_buffer_content);
-        }
-        /*Generates the chunk from previous chunk
-        boundary to where the fingerprint is matched*/
-        else {
-                *chunk_length = N+slide_incr;
-                *chunk_buffer = (char *)calloc
-                        (1, *chunk_length+1);
-                if (*chunk_buffer == NULL) {
-                        fprintf (stderr, "Error in buffer allocation\n");
-                        goto out;
-                }
-                memcpy (*chunk_buffer,
-                        *buffer + start, *chunk_length);
+        memset(&cfg->params, 0, sizeof(cfg->params));
+        if (params != NULL)
+                cfg->params = *params;
+        ret = resolve_chunk_params(&cfg->params);
+        if (ret == -1)
+                goto out;
+        cfg->mask_s = ((rabin_poly)1 << (cfg->params.mask_bits +
+                CHUNK_NORMALIZATION)) - 1;
+        cfg->mask_l = ((rabin_poly)1 << (cfg->params.mask_bits -
+                CHUNK_NORMALIZATION)) - 1;
+        for (b = 0; b < 256; b++) {
+                h = poly_mod(b, RABIN_POLY);
+                for (i = 0; i < cfg->params.window - 1; i++)
+                        h = poly_mod(h << 8, RABIN_POLY);
+                cfg->out_table[b] = h;
+                cfg->mod_table[b] = poly_mod((rabin_poly)b <<
+                        RABIN_POLY_DEGREE, RABIN_POLY) |
+                        ((rabin_poly)b << RABIN_POLY_DEGREE);
         }
         ret = 0;
 out:
         return ret;
+
+}
+
+/*Function to allocate a chunker and its input window.
+Input:
+        size_t max_size : Largest chunk the chunker can cut
+Output:
+        struct chunker* : Chunker, NULL on failure
+*/
+static struct chunker *
+alloc_chunker(size_t max_size)
+{
+
+        struct chunker  *chunker        =       NULL;
+
+        chunker = (struct chunker *)calloc(1, sizeof(*chunker));
+        if (chunker == NULL)
+                goto err;
+        /* A chunk never wraps, the window has to hold a whole one after the
+         * bytes of the chunk before it are dropped */
+        chunker->window_size = CHUNK_WINDOW_LEN;
+        if (chunker->window_size < 2 * max_size)
+                chunker->window_size = 2 * max_size;
+        chunker->window = (char *)malloc(chunker->window_size);
+        if (chunker->window == NULL)
+                goto err;
+        return chunker;
+err:
+        fprintf(stderr, "Error in chunker allocation\n");
+        destroy_chunker(&chunker);
+        return NULL;
+
+}
+
+/*Function to create a variable chunker.
+Input:
+        struct chunk_params *params : Parameters, NULL for defaults
+Output:
+        struct chunker* : Chunker, NULL on failure
+*/
+struct chunker *
+create_chunker(struct chunk_params *params)
+{
+
+        struct chunker  *chunker        =       NULL;
+        struct rabin_config config;
+
+        if (init_rabin_config(&config, params) == -1)
+                goto out;
+        chunker = alloc_chunker(config.params.max_size);
+        if (chunker == NULL)
+                goto out;
+        chunker->config = config;
+out:
+        return chunker;
+
+}
+
+/*Function to create a chunker that cuts fixed size chunks.
+Input:
+        size_t block_size : Size of the chunks, the last one may be shorter
+Output:
+        struct chunker* : Chunker, NULL on failure
+*/
+struct chunker *
+create_fixed_chunker(size_t block_size)
+{
+
+        struct chunker  *chunker        =       NULL;
+
+        if (block_size == 0 || block_size > CHUNK_SIZE_MAX) {
+                fprintf(stderr, "Chunk size has to be between 1 and %d\n",
+                        CHUNK_SIZE_MAX);
+                goto out;
+        }
+        chunker = alloc_chunker(block_size);
+        if (chunker == NULL)
+                goto out;
+        chunker->fixed_size = block_size;
+out:
+        return chunker;
+
 }
 
-/*Function to generate variable size chunk using rabin-karp.
+/*Function to hand a file to a chunker, bytes left over from the previous
+ file are dropped.
 Input:
+        struct chunker *chunker : Chunker
         int fd          : File descriptor of file that to be chuncked
-        int *ret        : Pointer to return 0 on success, -1 on failure
-        int *size       : Poniter to return remaining size of the file
 Output:
-        char*           : Chunk to be returned
+        None
 */
-char*
-get_variable_chunk (int fd, int *ret, int *size, int *chunk_flag, int *chunk_length)
+void
+chunker_feed(struct chunker *chunker, int fd)
 {
 
-        int     counter1                =       0;
-        int     counter2                =       0;
-        static int flag;
-        int     remaining_flag          =       0;
-
-        static char *buffer;
-        static char *previous_remaining_block;
-
-        char    *temp_buffer              =       NULL;
-        char    *chunk_buffer             =       NULL;
-        char    *remaining_buffer_content =       NULL;
-        char    *remaining_window_content =       NULL;
-
-        static y_uint32 hash;
-        static y_uint32 power;
-
-        static ssize_t start;
-        static ssize_t end;
-        static ssize_t remaining_length;
-        static ssize_t buffer_length;
-        static ssize_t previous_block_length;
-
-        ssize_t remaining_content_incr  =       0;
-        ssize_t slide_incr              =       0;
-
-        while (*size > 0) {
-                if (end == 0) {
-                        if (*size < BUFFER_LEN)
-                                buffer_length = *size;
-                        else
-                                buffer_length = BUFFER_LEN;
-
-                        buffer = (char *)calloc(1, buffer_length);
-                        if (buffer == NULL) {
-                                fprintf (stderr,
-                                "Error in buffer allocation\n");
-                                *ret     = -1;
-                                goto out;
-                        }
-                        *ret = read (fd, buffer, buffer_length);
-                        if (*ret < 0) {
-                                printf("%d\t%s",*ret, strerror(errno));
-                                fprintf (stderr, "Reading failed\n");
-                                *ret     = -1;
-                                goto out;
-                        }
-                        if (remaining_length == 0 && buffer_length <= N) {
-                                *size = 0;
-                                *chunk_flag   = 1;
-                                *chunk_length = buffer_length;
-                                return buffer;
-                        }
-
-                        start                   =       0;
-                        slide_incr              =       0;
-                        end                     =       N;
-
-                        /*If there is remaining content in previous buffer,
-                        set the end pointer of new buffer and
-                        remaining_content_incr according to the window size*/
-                        if (remaining_length > 0) {
-                                if (remaining_length < N) {
-                                        end = N - remaining_length;
-                                        remaining_content_incr  = N -
-                                                remaining_length;
-                                } else {
-                                        end = 0;
-                                        remaining_content_incr  = 1;
-                                }
-                        }
-                }
+        chunker->fd = fd;
+        chunker->eof = 0;
+        chunker->offset = 0;
+        chunker->window_pos = 0;
+        chunker->window_length = 0;
 
-                /*Loops until the end of the buffer, matches the hash with
-                fingerprint. If match is successful then write chunks to
-                file and length of chunk to .csv file*/
-                while (end < buffer_length) {
-                        if (flag == 0) {
-                                temp_buffer = (char *)calloc(1, N + 1);
-                                if (temp_buffer == NULL) {
-                                        fprintf (stderr,
-                                                "Error in buffer allocation\n");
-                                        *ret     = -1;
-                                        goto out;
-                                }
-
-                                if (remaining_length == N &&
-                                        remaining_content_incr != 0) {
-                                        memcpy (temp_buffer,
-                                                   remaining_window_content,
-                                                   N);
-                                        hash = calc_hash (temp_buffer,
-                                                &power, ret);
-                                }
-
-                                /*Creates the temp_buffer with previous buffers
-                                remaining content and requried amount of data
-                                from current buffer*/
-                                if (remaining_length > 0
-                                && remaining_content_incr != 0) {
-                                        if (remaining_length < N) {
-                                                memcpy (temp_buffer,
-                                                   remaining_buffer_content,
-                                                   remaining_length);
-
-                                                memcpy (temp_buffer + (N-end),
-                                                        buffer, end);
-                                                remaining_flag = 1;
-                                                hash = calc_hash (temp_buffer,
-                                                        &power, ret);
-                                        } else {
-                                                remaining_flag = 0;
-                                        }
-                                }
-                                /*Creates the temp_buffer of window size
-                                from current buffer*/
-                                else {
-                                        memcpy (temp_buffer,
-                                                buffer + start, N);
-                                        hash = calc_hash (temp_buffer,
-                                                &power, ret);
-                                }
-
-                                if (*ret == -1) {
-                                        fprintf (stderr,
-                                                "Error calculating rolling hash\n");
-                                        goto out;
-                                }
-                                clean_buff(&temp_buffer);
-                        }
-
-                        if (hash == FINGER_PRINT) {
-                                *ret = get_chunk_buffer
-                                (&remaining_content_incr, &remaining_length,
-                                &chunk_buffer, &buffer,
-                                &remaining_buffer_content,
-                                &remaining_window_content,
-                                start, end, slide_incr, chunk_length);
-
-                                if (*ret == -1)
-                                        goto out;
-                                *chunk_flag      = 1;
-                                slide_incr       = 0;
-                                hash             = 0;
-                                power            = 0;
-                                flag             = 0;
-                                start            = end;
-                                remaining_length = buffer_length - end;
-                                end += N;
-                                clean_buff(&previous_remaining_block);
-                                previous_block_length = 0;
-                                return chunk_buffer;
-                        } else {
-
-                                /*Sliding window when there is remaning content
-                                  in previous buffer with remaining length
-                                  less then window size*/
-                                if (remaining_content_incr != 0 &&
-                                    remaining_content_incr < N &&
-                                    remaining_flag == 1) {
-                                        hash = (hash * PRIME - power *
-                                        remaining_buffer_content[counter1] +
-                                        buffer[end]) % M;
-                                        remaining_content_incr++;
-                                        counter1++;
-                                } else {
-                                        counter1 = 0;
-                                }
-                                /*Sliding window when there is remaning content
-                                  in previous buffer with remaining length
-                                  greater then window size*/
-                                if (remaining_content_incr != 0 &&
-                                    remaining_content_incr <= N &&
-                                    remaining_flag == 0) {
-                                        hash = (hash * PRIME - power *
-                                        remaining_window_content[counter2] +
-                                        buffer[end]) % M;
-                                        remaining_content_incr++;
-                                        counter2++;
-                                } else {
-                                        counter2 = 0;
-                                }
-                                /*Sliding window with the current
-                                          buffer*/
-                                if ((remaining_content_incr == 0 ||
-                                        remaining_content_incr >= N) &&
-                                        counter1 == 0 && counter2 == 0) {
-
-                                        /*Returns the remaining content of
-                                         previous buffer when there is no
-                                        match with finger print even after
-                                        sliding whole window to current buffer*/
-                                        if (remaining_content_incr >= N) {
-                                                *chunk_length = remaining_length;
-                                                remaining_length = buffer_length;
-                                                clean_buff(&remaining_window_content);
-                                                clean_buff(&previous_remaining_block);
-                                                previous_block_length = 0;
-                                                chunk_flag = 0;
-                                                return remaining_buffer_content;
-                                        }
-
-                                        hash = (hash * PRIME - power *
-                                        buffer[start+slide_incr] +
-                                        buffer[end]) % M;
-                                        slide_incr++;
-                                }
-                                end++;
-                                flag = 1;
-                        }
+}
+
+/*Function to destroy a chunker.
+Input:
+        struct chunker **chunker : Pointer to the chunker, set to NULL
+Output:
+        None
+*/
+void
+destroy_chunker(struct chunker **chunker)
+{
+
+        if (*chunker == NULL)
+                return;
+        free((*chunker)->window);
+        free(*chunker);
+        *chunker = NULL;
+
+}
+
+/*Function to make sure the window holds need bytes from window_pos on, or
+ everything up to the end of the file. The bytes before window_pos belong
+ to chunks already returned and are dropped.
+Input:
+        struct chunker *chunker : Chunker
+        size_t need     : Bytes wanted after window_pos
+Output:
+        int             : 0 on success, -1 on read failure
+*/
+static int
+fill_window(struct chunker *chunker, size_t need)
+{
+
+        ssize_t         count   =       0;
+        size_t          left    =       0;
+
+        left = chunker->window_length - chunker->window_pos;
+        if (left >= need || chunker->eof)
+                return 0;
+        memmove(chunker->window, chunker->window + chunker->window_pos, left);
+        chunker->window_pos = 0;
+        chunker->window_length = left;
+        while (chunker->window_length < chunker->window_size) {
+                count = read(chunker->fd, chunker->window +
+                        chunker->window_length,
+                        chunker->window_size - chunker->window_length);
+                if (count < 0) {
+                        if (errno == EINTR)
+                                continue;
+                        fprintf (stderr, "Reading failed: %s\n",
+                                strerror(errno));
+                        return -1;
                 }
-                /*Keeps track of remaining buffers content which is not
-                 matched with fingerprint*/
-
-                if (remaining_length > 0) {
-                        *ret = get_remaining_buffer_content
-                                (&remaining_buffer_content,
-                                &remaining_window_content, remaining_length,
-                                &buffer, start);
-                        if (*ret == -1)
-                                goto out;
+                if (count == 0) {
+                        chunker->eof = 1;
+                        break;
                 }
+                chunker->window_length += count;
+        }
+        return 0;
 
-                if (previous_block_length == 0 && remaining_length > 0) {
-                        previous_remaining_block = (char *)calloc(1,
-                        remaining_length + 1);
-                        memcpy(previous_remaining_block,
-                        remaining_buffer_content, remaining_length);
-                        previous_block_length += remaining_length;
-                }
+}
 
-                *size -= buffer_length;
-                /*If buffer content is not matched with fingerprint and it has
-                reached end of file, consider remaining buffer content as
-                chunk*/
-                if (remaining_length > 0 && *size == 0) {
-                        *ret = get_chunk_buffer
-                        (&remaining_content_incr, &previous_block_length,
-                        &chunk_buffer, &buffer,
-                        &previous_remaining_block,
-                        &remaining_window_content,
-                        start, end, slide_incr, chunk_length);
-                        if (remaining_length < N)
-                                *chunk_length = remaining_length;
-                        clean_buff(&remaining_buffer_content);
-                        *chunk_flag   = 1;
-                        end             = 0;
-                        start           = 0;
-                        buffer_length   = 0;
-                        hash            = 0;
-                        power           = 0;
-                        flag            = 0;
-                        remaining_length = 0;
-                        buffer_length   = 0;
-                        previous_block_length = 0;
-                        clean_buff(&buffer);
-                        clean_buff(&remaining_window_content);
-                        clean_buff(&remaining_buffer_content);
-                        clean_buff(&previous_remaining_block);
-                        return chunk_buffer;
-                }
-                end = 0;
-                clean_buff(&buffer);
+/*Function to find the end of a variable size chunk using a rolling Rabin
+ fingerprint. The window before each position is contiguous in the input
+ window, so chunk_scan can use vector kernels.
+ The first min_size - 1 positions of a chunk can not hold a boundary and
+ are not hashed at all. Up to avg_size a boundary needs the stricter mask_s,
+ after it the looser mask_l, and at max_size the chunk is cut regardless.
+Input:
+        struct rabin_config *config : Parameters, masks and lookup tables
+        unsigned char *data     : First byte of the chunk
+        size_t limit    : Bytes available, at most max_size
+Output:
+        size_t          : Length of the chunk
+*/
+static size_t
+find_boundary(const struct rabin_config *config, const unsigned char *data,
+        size_t limit)
+{
+
+        size_t          min_check       =       0;
+        size_t          avg_check       =       0;
+        size_t          pos             =       0;
+
+        /* Positions are 0 based, a boundary at position i ends a chunk of
+         * i + 1 bytes */
+        min_check = config->params.min_size;
+        if (min_check < (size_t)config->params.window)
+                min_check = config->params.window;
+        min_check--;
+        avg_check = config->params.avg_size - 1;
+        if (min_check >= limit)
+                return limit;
+        pos = min_check;
+        if (pos < avg_check) {
+                pos = chunk_scan(config, data, pos,
+                        avg_check < limit ? avg_check : limit,
+                        config->mask_s);
+                if (pos < avg_check && pos < limit)
+                        return pos + 1;
         }
-        *ret = 0;
-out:
-        return NULL;
+        pos = chunk_scan(config, data, pos, limit, config->mask_l);
+        return pos < limit ? pos + 1 : limit;
+
+}
+
+/*Function to get the largest chunk a chunker can cut.
+Input:
+        struct chunker *chunker : Chunker
+Output:
+        size_t          : Largest chunk
+*/
+static size_t
+chunk_max(const struct chunker *chunker)
+{
+
+        size_t          max_size        =       0;
+
+        max_size = chunker->fixed_size;
+        if (max_size == 0) {
+                max_size = chunker->config.params.max_size;
+                if (max_size < (size_t)chunker->config.params.window)
+                        max_size = chunker->config.params.window;
+        }
+        return max_size;
+
+}
+
+/*Function to cut the next chunk of the file fed to the chunker. The chunk
+ is not copied, the slice points into the input window and is only valid
+ until the next call.
+Input:
+        struct chunker *chunker : Chunker the file was fed to
+        struct chunk_slice *slice : Pointer to return the chunk
+Output:
+        int             : 1 for a chunk, 0 at the end of the file, -1 on
+                          failure
+*/
+int
+chunker_next(struct chunker *chunker, struct chunk_slice *slice)
+{
+
+        size_t          max_size        =       0;
+        size_t          limit           =       0;
+        size_t          length          =       0;
+        const unsigned char *data       =       NULL;
+
+        max_size = chunk_max(chunker);
+        if (fill_window(chunker, max_size) == -1)
+                return -1;
+        limit = chunker->window_length - chunker->window_pos;
+        if (limit == 0)
+                return 0;
+        if (limit > max_size)
+                limit = max_size;
+        data = (const unsigned char *)chunker->window + chunker->window_pos;
+        if (chunker->fixed_size != 0)
+                length = limit;
+        else
+                length = find_boundary(&chunker->config, data, limit);
+        slice->data = (const char *)data;
+        slice->length = length;
+        slice->offset = chunker->offset;
+        chunker->window_pos += length;
+        chunker->offset += length;
+        return 1;
+
+}
+
+/*Function to cut all chunks the input window holds. The window is only
+ refilled before the first chunk, so every slice stays valid until the next
+ call and a batch is at most one read window.
+Input:
+        struct chunker *chunker : Chunker the file was fed to
+        struct chunk_slice *slices : Array to return the chunks
+        int max         : Size of slices
+Output:
+        int             : Number of chunks, 0 at the end of the file, -1 on
+                          failure
+*/
+int
+chunker_next_batch(struct chunker *chunker, struct chunk_slice *slices,
+        int max)
+{
+
+        size_t          max_size        =       0;
+        int             count           =       0;
+        int             ret             =       0;
+
+        max_size = chunk_max(chunker);
+        while (count < max) {
+                /* The next chunk would move the window under the slices
+                 * already returned */
+                if (count > 0 && !chunker->eof && max_size >
+                        chunker->window_length - chunker->window_pos)
+                        break;
+                ret = chunker_next(chunker, &slices[count]);
+                if (ret == -1)
+                        return -1;
+                if (ret == 0)
+                        break;
+                count++;
+        }
+        return count;
+
 }
@@ -1,3 +1,6 @@
+#ifndef __RABIN_KARP_H__
+#define __RABIN_KARP_H__
+
 #include<stdio.h>
 #include<string.h>
 #include<fcntl.h>
@@ -6,79 +9,158 @@
 #include<error.h>
 #include<sys/stat.h>
 #include<unistd.h>
-#include<string.h>
+#include<stdint.h>
 
-#define PRIME 23
-#define N 2048
-#define FINGER_PRINT 938
-#define BUFFER_LEN 10240
-#define M 1021
+/* Irreducible polynomial of degree 53 over GF(2) the fingerprint is
+ * computed modulo */
+#define RABIN_POLY              0x3DA3358B4DC173ULL
+#define RABIN_POLY_DEGREE       53
+#define RABIN_POLY_SHIFT        (RABIN_POLY_DEGREE - 8)
+#define RABIN_WINDOW            64
+#define RABIN_WINDOW_MAX        4096
+#define RABIN_MASK_BITS         13
+#define RABIN_MASK_BITS_MIN     4
+#define RABIN_MASK_BITS_MAX     30
+#define CHUNK_NORMALIZATION     2
+#define CHUNK_SIZE_MAX          (1 << 30)
+#define CHUNK_WINDOW_LEN        (4 << 20)
 
-typedef unsigned int y_uint32;
+typedef uint64_t rabin_poly;
 
-/*@description:Function to find the rolling hash of a particular window.
+/*Parameters of the variable chunker. Chunks are never cut before min_size
+and always cut at max_size. Up to avg_size a boundary needs mask_bits +
+CHUNK_NORMALIZATION zero bits, after it mask_bits - CHUNK_NORMALIZATION, which
+pulls chunk sizes towards avg_size.*/
+struct chunk_params
+{
+        int     window;
+        int     mask_bits;
+        size_t  min_size;
+        size_t  avg_size;
+        size_t  max_size;
+};
+
+/*Sliding window and lookup tables of the Rabin fingerprint.
+        out_table[b] : fingerprint of b followed by window - 1 zero bytes,
+                       xoring it removes b from the fingerprint when it
+                       slides out of the window
+        mod_table[b] : reduction of the top byte b modulo RABIN_POLY
+*/
+struct rabin_config
+{
+        struct chunk_params params;
+        rabin_poly      mask_s;
+        rabin_poly      mask_l;
+        rabin_poly      out_table[256];
+        rabin_poly      mod_table[256];
+};
+
+/*@description:Function to fill in the defaults of chunker parameters and
+check them. The average size is rounded down to a power of two, mask_bits
+is derived from it when it is given.
 Input:
-        char* buffer            : Buffer to store window content
-        y_uint32 *power         : Stores the value PRIME^window length
-        int *ret                : To return the status 0 on success,
-         -1 on failure
+        struct chunk_params *params : Parameters, 0 fields take defaults
 Output:
-        y_uint32 hash_value     : Rolling hash of a particular window
+        int             : 0 on success, -1 on invalid parameters
 */
-y_uint32 calc_hash (char *buffer, y_uint32 *power, int *ret);
+int resolve_chunk_params(struct chunk_params *params);
 
-/*@description:Function to keep track remaining content of previous
- buffer when there is no match with fingerprint
+/*@description:Function to fill in the parameters, masks and lookup tables
+of a fingerprint configuration.
+Input:
+        struct rabin_config *cfg    : Configuration to fill in
+        struct chunk_params *params : Parameters, NULL for defaults
+Output:
+        int             : 0 on success, -1 on failure
+*/
+int init_rabin_config(struct rabin_config *cfg, struct chunk_params *params);
+
+/*A chunk as a view into the input window of the chunker that cut it.
+        offset  : Offset of the first byte in the file
+*/
+struct chunk_slice
+{
+        const char      *data;
+        size_t          length;
+        uint64_t        offset;
+};
 
+/*State of one chunker, chunkers share nothing so files can be chunked
+concurrently with one chunker per thread.
+        window     : Input read from fd, the bytes from window_pos on are
+                     not chunked yet
+        fixed_size : Size of fixed chunks, 0 for variable chunks
+*/
+struct chunker
+{
+        struct rabin_config config;
+        size_t          fixed_size;
+        int             fd;
+        int             eof;
+        uint64_t        offset;
+        char            *window;
+        size_t          window_size;
+        size_t          window_pos;
+        size_t          window_length;
+};
+
+/*@description:Function to create a variable chunker, the lookup tables
+depend on the window size.
 Input:
-        ssize_t remaining_length       : Remaining length of the
-                                        previous buffer
-        char** remaining_buffer_content: Contains remaining content of
-                                        the previous buffer
-        char** remaining_window_content: Contains remaining content of
-                                        the previous window
-        char** buffer                  : Contains current buffer content
-        ssize_t start                  : Starting offset of buffer
+        struct chunk_params *params : Parameters, NULL for defaults
 Output:
-        int     ret                    : 0 on success, -1 on failure
+        struct chunker* : Chunker, NULL on failure
 */
-int
-get_remaining_buffer_content(char **remaining_buffer_content,
-        char **remaining_window_content, ssize_t remaining_length,
-        char **buffer, ssize_t start);
+struct chunker *create_chunker(struct chunk_params *params);
 
-/*@description:Function to get the chunk when there is a match with
- fingerprint
+/*@description:Function to create a chunker that cuts fixed size chunks.
 Input:
-        ssize_t* remaining_length      : Remaining length of the
-                                        previous buffer
-        char** remaining_buffer_content: Contains remaining content of
-                                        the previous buffer
-        char** remaining_window_content: Contains remaining content of
-                                        the previous window
-        char** chunk_buffer            : Holds the chunk content
-        char** buffer                  : Contains current buffer content
-        ssize_t start                  : Starting offset of buffer
-        ssize_t end                    : Ending offset of bufferw
-        ssize_t slide_incr             : Keeps track of buffer sliding
-        ssize_t* remaining_content_incr: Keeps track of sliding of
-                                        previous buffer
+        size_t block_size : Size of the chunks, the last one may be shorter
 Output:
-        int     ret                    : 0 on success, -1 on failure
+        struct chunker* : Chunker, NULL on failure
 */
-int
-get_chunk_buffer(ssize_t *remaining_content_incr, ssize_t *remaining_length,
-        char **chunk_buffer, char **buffer, char **remaining_buffer_content,
-        char **remaining_window_content, ssize_t start, ssize_t end,
-        ssize_t slide_incr, int *chunk_length);
+struct chunker *create_fixed_chunker(size_t block_size);
 
-/*@description:Function to generate variable size chunk using rabin-karp.
+/*@description:Function to hand a file to a chunker.
 Input:
+        struct chunker *chunker : Chunker
         int fd          : File descriptor of file that to be chuncked
-        int *ret        : Pointer to return 0 on success, -1 on failure
-        int *chunk_flag : Pointer to notify the chunk
-        int *size       : Poniter to return remaining size of the file
 Output:
-        char*           : Chunk to be returned
+        None
 */
-char *get_variable_chunk (int fd, int *ret, int *size,int *chunk_flag, int *chunk_length);
+void chunker_feed(struct chunker *chunker, int fd);
+
+/*@description:Function to cut the next chunk of the file fed to the
+chunker. The slice points into the input window of the chunker and is only
+valid until the next call.
+Input:
+        struct chunker *chunker : Chunker the file was fed to
+        struct chunk_slice *slice : Pointer to return the chunk
+Output:
+        int             : 1 for a chunk, 0 at the end of the file, -1 on
+                          failure
+*/
+int chunker_next(struct chunker *chunker, struct chunk_slice *slice);
+
+/*@description:Function to cut all chunks the input window of the chunker
+holds, at most max. The slices are only valid until the next call.
+Input:
+        struct chunker *chunker : Chunker the file was fed to
+        struct chunk_slice *slices : Array to return the chunks
+        int max         : Size of slices
+Output:
+        int             : Number of chunks, 0 at the end of the file, -1 on
+                          failure
+*/
+int chunker_next_batch(struct chunker *chunker, struct chunk_slice *slices,
+        int max);
+
+/*@description:Function to destroy a chunker.
+Input:
+        struct chunker **chunker : Pointer to the chunker, set to NULL
+Output:
+        None
+*/
+void destroy_chunker(struct chunker **chunker);
+
+#endif
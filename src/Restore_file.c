@@ -2,26 +2,34 @@
 #include "catalog.h"
 #include "clean_buff.h"
 #include "stub.h"
+#include "parsing.h"
+#include "container.h"
+#include "pack.h"
+#include "restore_pool.h"
+#include "restore_cache.h"
+#include "restore_faa.h"
+#include "block.h"
 
 /*Function to enter a filename that has to be restored.
 Input:void
 Output:int
 */
 int
-restore_file(char *file_path, char *store_path)
+restore_file(char *file_path, char *store_path, struct restore_range *range,
+        struct restore_options *options)
 {
 
         int ret         =       -1;
 
-        ret = comparepath(file_path);
+        ret = read_catalog_entry(file_path, options->name, NULL);
         if (ret == -1) {
                 goto out;
         }
         if (ret == 1) {
-                printf("\nInvalid path");
+                fprintf(stderr, "\nInvalid path\n");
                 goto out;
         }
-        ret = restorefile(file_path, store_path);
+        ret = restorefile(file_path, store_path, range, options);
         if (ret == -1) {
                 goto out;
         }
@@ -31,120 +39,424 @@ out:
 
 }
 
-/* Function to delete file and restore it with original contents.
-Input   :  char* path
+/*Store a stub reads its chunks from.
+        store_type : Store type from the stub header
+        digest_len : Length of the fingerprints
+        store_path : Store path of the namespace
+        cache      : Chunks read so far
+*/
+struct restore_store
+{
+        int             store_type;
+        int             digest_len;
+        char            *store_path;
+        struct chunk_cache cache;
+};
+
+/*Function to read a chunk from the store of the stub by its fingerprint.
+Input:struct restore_store *store,DIGEST *record,int *length
+Output:char*
+*/
+static char *
+read_chunk(struct restore_store *store, DIGEST *record, int *length)
+{
+
+        uint64_t        pos             =       0;
+        char            *hash           =       NULL;
+        char            *buffer         =       NULL;
+
+        if (store->store_type == STORE_TYPE_DEFAULT) {
+                if (getposition(record, &pos) == -1)
+                        return NULL;
+                buffer = get_block(pos, length);
+        } else if (store->store_type == STORE_TYPE_CONTAINER) {
+                if (getposition(record, &pos) == -1)
+                        return NULL;
+                buffer = get_block_from_container(pos, length);
+        } else if (store->store_type == STORE_TYPE_PACK) {
+                buffer = get_block_from_pack(record, length);
+        } else {
+                hash = parse(record, store->digest_len);
+                buffer = get_block_from_object(hash, length,
+                        store->store_path);
+                clean_buff(&hash);
+        }
+        return buffer;
+
+}
+
+/*Function to get a chunk from the cache, or from the store on a miss. The
+chunk is held until release_chunk.
+Input:void *arg - struct restore_store,DIGEST *record,int *length,
+void **chunk - struct cache_entry
+Output:char*
+*/
+static char *
+fetch_chunk(void *arg, DIGEST *record, int *length, void **chunk)
+{
+
+        struct restore_store *store     =       (struct restore_store *)arg;
+        struct cache_entry *entry       =       NULL;
+        char            *buffer         =       NULL;
+        int             l               =       0;
+
+        entry = chunk_cache_get(&store->cache, record);
+        if (entry == NULL) {
+                buffer = read_chunk(store, record, &l);
+                if (buffer == NULL)
+                        return NULL;
+                entry = chunk_cache_insert(&store->cache, record, buffer, l);
+                if (entry == NULL)
+                        return NULL;
+        }
+        *length = entry->length;
+        *chunk = entry;
+        return entry->data;
+
+}
+
+/*Function to drop the hold on a chunk once it is written.
+Input:void *arg - struct restore_store,void *chunk - struct cache_entry
+Output:void
+*/
+static void
+release_chunk(void *arg, void *chunk)
+{
+
+        struct restore_store *store     =       (struct restore_store *)arg;
+
+        chunk_cache_release(&store->cache, (struct cache_entry *)chunk);
+
+}
+
+/*Function to find the region of the store a chunk is kept in. Chunks of
+the object store each have a file of their own and no region.
+Input:void *arg - struct restore_store,DIGEST *record
+Output:struct chunk_region *region
+*/
+static int
+locate_chunk(void *arg, DIGEST *record, struct chunk_region *region)
+{
+
+        struct restore_store *store     =       (struct restore_store *)arg;
+        uint64_t        pos             =       0;
+        uint32_t        pack_no         =       0;
+
+        if (store->store_type == STORE_TYPE_DEFAULT) {
+                if (getposition(record, &pos) == -1)
+                        return -1;
+                region->file = 0;
+                region->offset = pos + BLOCK_HEADER_SIZE;
+        } else if (store->store_type == STORE_TYPE_CONTAINER) {
+                if (getposition(record, &pos) == -1)
+                        return -1;
+                region->file = pos / CONTAINER_SIZE;
+                region->offset = pos % CONTAINER_SIZE +
+                        CONTAINER_RECORD_HEADER;
+        } else if (store->store_type == STORE_TYPE_PACK) {
+                if (get_pack_location(record, &pack_no, &pos) == -1)
+                        return -1;
+                region->file = (uint64_t)record[0] << 32 | pack_no;
+                region->offset = pos;
+        } else {
+                return 1;
+        }
+        return 0;
+
+}
+
+/*Function to read bytes of a region of the store.
+Input:void *arg - struct restore_store,uint64_t file,uint64_t offset,
+char *buffer,size_t length
+Output:int
+*/
+static int
+read_region(void *arg, uint64_t file, uint64_t offset, char *buffer,
+        size_t length)
+{
+
+        struct restore_store *store     =       (struct restore_store *)arg;
+
+        if (store->store_type == STORE_TYPE_DEFAULT)
+                return read_block_region(offset, buffer, length);
+        if (store->store_type == STORE_TYPE_CONTAINER)
+                return read_container_region(file, offset, buffer, length);
+        return read_pack_region(file >> 32, (uint32_t)file, offset, buffer,
+                length);
+
+}
+
+/*Function to copy bytes of a chunk from the store to the restored file in
+the kernel.
+Input:void *arg - struct restore_store,DIGEST *record,uint64_t from,
+size_t length,int fd_out,uint64_t out_offset
+Output:int
+*/
+static int
+copy_chunk(void *arg, DIGEST *record, uint64_t from, size_t length,
+        int fd_out, uint64_t out_offset)
+{
+
+        struct restore_store *store     =       (struct restore_store *)arg;
+        struct chunk_region region;
+        char            *hash           =       NULL;
+        int             ret             =       -1;
+
+        ret = locate_chunk(arg, record, &region);
+        if (ret == -1)
+                return -1;
+        if (ret == 1) {
+                hash = parse(record, store->digest_len);
+                ret = copy_block_from_object(hash, store->store_path, from,
+                        fd_out, out_offset, length);
+                clean_buff(&hash);
+                return ret;
+        }
+        if (store->store_type == STORE_TYPE_DEFAULT)
+                return copy_block_region(region.offset + from, fd_out,
+                        out_offset, length);
+        if (store->store_type == STORE_TYPE_CONTAINER)
+                return copy_container_region(region.file, region.offset +
+                        from, fd_out, out_offset, length);
+        return copy_pack_region(region.file >> 32, (uint32_t)region.file,
+                region.offset + from, fd_out, out_offset, length);
+
+}
+
+/*Function to drop the file descriptors a restore thread cached.
+Input:void *arg - struct restore_store
+Output:void
+*/
+static void
+fetch_done(void *arg)
+{
+
+        struct restore_store *store     =       (struct restore_store *)arg;
+
+        if (store->store_type == STORE_TYPE_CONTAINER)
+                container_release_reader();
+        else if (store->store_type == STORE_TYPE_PACK)
+                pack_release_fds();
+
+}
+
+/*Function to write all of a buffer to a stream, which takes no offsets.
+Input:int fd,char *buffer,size_t length
+Output:int
+*/
+static int
+write_stream(int fd, char *buffer, size_t length)
+{
+
+        size_t          done    =       0;
+        ssize_t         count   =       0;
+
+        while (done < length) {
+                count = write(fd, buffer + done, length - done);
+                if (count == -1) {
+                        if (errno == EINTR)
+                                continue;
+                        return -1;
+                }
+                done += count;
+        }
+        return 0;
+
+}
+
+/* Function to delete file and restore it with original contents, or to
+write back only the bytes of a range. With a forward assembly area the
+chunks of a window are read in store order, with threads they are fetched
+by a pool of threads and written at their own offsets. With zero copy the
+chunks go from the store to the file in the kernel, otherwise chunks the
+file uses more than once are kept in a cache. Stdout is written in stub order
+with plain writes, as a pipe takes no offsets.
+Input   :  char* path,char *store_path,struct restore_range *range,
+           struct restore_options *options
 Output  :  int
 */
 int
-restorefile(char *path, char *store_path)
+restorefile(char *path, char *store_path, struct restore_range *range,
+        struct restore_options *options)
 {
 
         int l                   =       0;
         int ret                 =      -1;
-        int size                =       0;
-        int size1               =       0;
-        int     pos             =       0;
-        char *buffer            =       NULL;
         char *buffer2           =       NULL;
-        int length              =       0;
+        void *chunk             =       NULL;
         int sd1                =       -1;
-        struct stat             st;
-        int bset                =       0;
-        int eset                =       0;
+        uint64_t bset           =       0;
+        uint64_t eset           =       0;
+        uint64_t first          =       0;
+        uint64_t last           =       UINT64_MAX;
+        uint64_t from           =       0;
+        uint64_t to             =       0;
+        int flags               =       O_CREAT|O_RDWR|O_TRUNC;
         int fd2                =       -1;
-        int store_type               =       -1;
+        int stream              =       0;
+        FILE *msg               =       stdout;
         char *ts1               =       NULL;
         char *ts2               =       NULL;
         char *dir               =       NULL;
         char *filename1         =       NULL;
+        DIGEST record[MAX_DIGEST_LEN];
+        struct store_header header;
+        struct stub_reader reader;
+        struct restore_store store;
+        struct restore_source source;
+        struct faa_stats stats;
 
+        memset(&reader, 0, sizeof(reader));
+        memset(&store, 0, sizeof(store));
+        if (strcmp(path, STREAM_PATH) == 0) {
+                stream = 1;
+                msg = stderr;
+        }
         ts1 = strdup(path);
-        ts2 = strdup(path);
+        ts2 = strdup(options->name != NULL ? options->name : path);
         dir = dirname(ts1);
         filename1 = basename(ts2);
-        printf("%s\n", dir);
-        printf("\npath : %s\n", path);
-        printf("File : %s\n", filename1);
+        fprintf(msg, "%s\n", dir);
+        fprintf(msg, "\npath : %s\n", path);
+        fprintf(msg, "File : %s\n", filename1);
         ret = init_stub_store(store_path, filename1, &sd1);
         if (ret < 0) {
                 fprintf(stderr, "%s\n", strerror(errno));
                 goto out;
         } else {
-                printf("\nStub file opened\n");
+                fprintf(msg, "\nStub file opened\n");
         }
 
-        fstat(sd1, &st);
-        size = st.st_size;
-        fd2 = open(path, O_CREAT|O_RDWR, S_IRUSR|S_IWUSR);
-        if (fd2 < 1) {
-                fprintf(stderr, "%s\n", strerror(errno));
+        ret = read_store_header(sd1, STUB_STORE_MAGIC, &header);
+        if (ret == -1)
                 goto out;
-        } else {
-                printf("Restore file created\nRestore in progress...\n");
-        }
-        if (size > 0) {
-                if (-1 == lseek(sd1,0,SEEK_SET)) {
-                        fprintf(stderr, "%s\n", strerror(errno));
-                        goto out;
-                }
-        }
-        if (size == 0) {
-                printf("\nNo contents\n");
+        if (ret == 1) {
+                fprintf(msg, "\nNo contents\n");
                 ret = -1;
                 goto out;
         }
-        ret = read(sd1, &store_type, int_size);
-        if (ret== -1) {
-                fprintf(stderr, "%s\n", strerror(errno));
+        ret = stub_reader_open(&reader, sd1, &header);
+        if (ret == -1)
+                goto out;
+        store.store_type = header.store_type;
+        store.digest_len = header.digest_len;
+        store.store_path = store_path;
+        ret = chunk_cache_init(&store.cache, options->cache_size,
+                header.digest_len);
+        if (ret == -1)
                 goto out;
+        if (range != NULL) {
+                first = range->offset;
+                if (range->length != RESTORE_TO_END &&
+                        range->length <= UINT64_MAX - first)
+                        last = first + range->length;
+                if (last == first)
+                        goto out;
+                ret = stub_reader_seek(&reader, store_path, filename1,
+                        first);
+                if (ret == -1)
+                        goto out;
+                flags = O_CREAT|O_RDWR;
         }
-        while (size > 0) {
-                ret = read(sd1, &length, int_size);
-                if (ret == -1) {
+        if (stream) {
+                fd2 = STDOUT_FILENO;
+                fprintf(msg, "Restore in progress...\n");
+        } else {
+                fd2 = open(path, flags, S_IRUSR|S_IWUSR);
+                if (fd2 < 1) {
                         fprintf(stderr, "%s\n", strerror(errno));
                         goto out;
                 }
-                buffer = (char *)calloc(1, length+1);
-                ret = read(sd1, buffer, length);
-                if (ret == -1) {
-                        fprintf(stderr, "%s\n", strerror(errno));
+                fprintf(msg, "Restore file created\nRestore in "
+                        "progress...\n");
+        }
+        source.fetch = fetch_chunk;
+        source.release = release_chunk;
+        source.thread_done = fetch_done;
+        source.locate = locate_chunk;
+        source.read_region = read_region;
+        source.copy_chunk = options->zero_copy ? copy_chunk : NULL;
+        source.arg = &store;
+        if (options->faa_size > 0 && !stream) {
+                ret = run_restore_faa(&reader, &source, options->faa_size,
+                        first, last, fd2, &stats);
+                if (ret == -1)
                         goto out;
-                }
-                ret = read(sd1, &bset, int_size);
-                if (ret == -1) {
-                        fprintf(stderr, "%s\n", strerror(errno));
+                fprintf(msg, "Forward assembly: %lu windows, %lu chunks, "
+                        "%lu reads, %lu bytes read\n",
+                        (unsigned long)stats.windows,
+                        (unsigned long)stats.chunks,
+                        (unsigned long)stats.reads,
+                        (unsigned long)stats.bytes_read);
+                goto done;
+        }
+        if (options->threads > 0 && !stream) {
+                ret = run_restore_pool(&reader, &source, options->threads,
+                        first, last, fd2);
+                if (ret == -1)
                         goto out;
+                goto done;
+        }
+        while ((ret = stub_reader_next(&reader, record, &bset, &eset)) == 1) {
+                /* Chunks before the range are skipped without reading
+                 * them, the first chunk past it ends the restore */
+                if (eset < first)
+                        continue;
+                if (bset >= last)
+                        break;
+                if (options->zero_copy && !stream) {
+                        from = bset < first ? first - bset : 0;
+                        to = eset < last ? eset - bset + 1 : last - bset;
+                        ret = copy_chunk(&store, record, from, to - from, fd2,
+                                bset + from);
+                        if (ret == -1)
+                                goto out;
+                        continue;
                 }
-                ret = read(sd1, &eset, int_size);
-                if (ret == -1) {
-                        fprintf(stderr, "%s\n", strerror(errno));
+                buffer2 = fetch_chunk(&store, record, &l, &chunk);
+                if (buffer2 == NULL) {
+                        ret = -1;
                         goto out;
                 }
-                buffer[length] = '\0';
-                if (store_type == 0) {
-                        pos = getposition(buffer);
-                        if (pos == -1)
-                                goto out;
-                        buffer2 = get_block(pos, &l);
-                        if (buffer2 == NULL) {
-                                goto out;
-                        }
-                } else {
-                        buffer2 = get_block_from_object(buffer, &l, store_path);
-                        if (buffer2 == NULL)
-                                goto out;
+                from = bset < first ? first - bset : 0;
+                to = eset < last ? eset - bset + 1 : last - bset;
+                if (to > (uint64_t)l)
+                        to = l;
+                ret = 0;
+                if (stream) {
+                        if (from < to)
+                                ret = write_stream(fd2, buffer2 + from,
+                                        to - from);
+                } else if (range == NULL) {
+                        ret = write(fd2, buffer2, l);
+                } else if (from < to) {
+                        ret = pwrite(fd2, buffer2 + from, to - from,
+                                bset + from);
                 }
-                ret = write(fd2, buffer2, l);
+                release_chunk(&store, chunk);
                 if (ret < 0) {
                         fprintf(stderr, "%s\n", strerror(errno));
                         goto out;
                 }
-                size1 -= (length+int_size+int_size+int_size);
-                clean_buff(&buffer);
-                clean_buff(&buffer2);
         }
+        if (ret == -1)
+                goto out;
+done:
+        if (store.cache.hits + store.cache.misses > 0)
+                fprintf(msg, "Restore cache: %lu hits, %lu misses, %lu "
+                        "evictions\n", (unsigned long)store.cache.hits,
+                        (unsigned long)store.cache.misses,
+                        (unsigned long)store.cache.evictions);
         ret = 0;
 out:
+        stub_reader_free(&reader);
+        chunk_cache_free(&store.cache);
+        if (fd2 != -1 && !stream)
+                close(fd2);
+        if (sd1 != -1)
+                close(sd1);
+        free(ts1);
+        free(ts2);
         return ret;
 
 }
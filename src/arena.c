@@ -0,0 +1,163 @@
+#include "arena.h"
+
+/*Function to initialize an empty arena.
+Input:struct arena *arena,size_t block_size
+Output:void
+*/
+void
+arena_init(struct arena *arena, size_t block_size)
+{
+
+        memset(arena, 0, sizeof(*arena));
+        arena->block_size = block_size ? block_size : ARENA_BLOCK_SIZE;
+
+}
+
+/*Function to find a block after the current one with room for size bytes.
+Blocks left over from before a release are reused when they are big
+enough, otherwise a new block is linked in after the current one.
+Input:struct arena *arena,size_t size
+Output:struct arena_block* - NULL for error
+*/
+static struct arena_block *
+next_block(struct arena *arena, size_t size)
+{
+
+        struct arena_block *block       =       NULL;
+        size_t          block_size      =       arena->block_size;
+
+        if (arena->current != NULL)
+                block = arena->current->next;
+        else
+                block = arena->first;
+        if (block != NULL && block->size >= size) {
+                block->used = 0;
+                return block;
+        }
+        if (block_size < size)
+                block_size = size;
+        block = (struct arena_block *)malloc(sizeof(*block) + block_size);
+        if (block == NULL) {
+                fprintf(stderr, "Error in arena allocation\n");
+                return NULL;
+        }
+        arena->nr_malloc++;
+        block->size = block_size;
+        block->used = 0;
+        if (arena->current != NULL) {
+                block->next = arena->current->next;
+                arena->current->next = block;
+        } else {
+                block->next = arena->first;
+                arena->first = block;
+        }
+        return block;
+
+}
+
+/*Function to allocate zeroed memory from an arena.
+Input:struct arena *arena,size_t size
+Output:void* - NULL for error
+*/
+void *
+arena_alloc(struct arena *arena, size_t size)
+{
+
+        struct arena_block *block       =       arena->current;
+        void            *ptr            =       NULL;
+
+        size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+        if (size == 0)
+                size = ARENA_ALIGN;
+        if (block == NULL || block->size - block->used < size) {
+                block = next_block(arena, size);
+                if (block == NULL)
+                        goto out;
+                arena->current = block;
+        }
+        ptr = block->data + block->used;
+        block->used += size;
+        memset(ptr, 0, size);
+        arena->nr_alloc++;
+        arena->bytes += size;
+out:
+        return ptr;
+
+}
+
+/*Function to copy a string into an arena.
+Input:struct arena *arena,const char *str
+Output:char* - NULL for error
+*/
+char *
+arena_strdup(struct arena *arena, const char *str)
+{
+
+        size_t  len     =       strlen(str);
+        char    *copy   =       NULL;
+
+        copy = (char *)arena_alloc(arena, len + 1);
+        if (copy != NULL)
+                memcpy(copy, str, len + 1);
+        return copy;
+
+}
+
+/*Function to remember the position of an arena.
+Input:struct arena *arena
+Output:struct arena_mark *mark
+*/
+void
+arena_mark(struct arena *arena, struct arena_mark *mark)
+{
+
+        mark->current = arena->current;
+        mark->used = arena->current ? arena->current->used : 0;
+
+}
+
+/*Function to free everything allocated after a mark.
+Input:struct arena *arena,struct arena_mark *mark
+Output:void
+*/
+void
+arena_release(struct arena *arena, struct arena_mark *mark)
+{
+
+        arena->current = mark->current;
+        if (mark->current != NULL)
+                mark->current->used = mark->used;
+
+}
+
+/*Function to free everything allocated from an arena.
+Input:struct arena *arena
+Output:void
+*/
+void
+arena_reset(struct arena *arena)
+{
+
+        arena->current = NULL;
+
+}
+
+/*Function to free the blocks of an arena.
+Input:struct arena *arena
+Output:void
+*/
+void
+arena_destroy(struct arena *arena)
+{
+
+        struct arena_block *block       =       arena->first;
+        struct arena_block *next        =       NULL;
+
+        while (block != NULL) {
+                next = block->next;
+                free(block);
+                block = next;
+        }
+        arena_init(arena, arena->block_size);
+
+}
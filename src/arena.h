@@ -0,0 +1,89 @@
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<stdint.h>
+
+#define ARENA_BLOCK_SIZE        (64 << 10)
+#define ARENA_ALIGN             16
+
+/*Block of an arena, allocations are carved from data in order.*/
+struct arena_block
+{
+        struct arena_block *next;
+        size_t          size;
+        size_t          used;
+        char            data[];
+};
+
+/*Bump allocator for the scratch memory of one dedup session. Nothing is
+freed on its own, arena_release() rewinds to a mark and arena_reset() to
+the start, the blocks are kept for the allocations that follow.
+        nr_alloc  : Allocations served
+        nr_malloc : Blocks taken from malloc
+        bytes     : Bytes served
+*/
+struct arena
+{
+        struct arena_block *first;
+        struct arena_block *current;
+        size_t          block_size;
+        uint64_t        nr_alloc;
+        uint64_t        nr_malloc;
+        uint64_t        bytes;
+};
+
+/*Position in an arena to rewind to.*/
+struct arena_mark
+{
+        struct arena_block *current;
+        size_t          used;
+};
+
+/*@description:Function to initialize an empty arena
+@in: struct arena *arena-arena, size_t block_size-size of the blocks, 0 for
+ARENA_BLOCK_SIZE
+@out: void
+@return: void */
+void arena_init(struct arena *arena, size_t block_size);
+
+/*@description:Function to allocate zeroed memory from an arena
+@in: struct arena *arena-arena, size_t size-bytes wanted
+@out: void *
+@return: NULL for error and memory otherwise */
+void *arena_alloc(struct arena *arena, size_t size);
+
+/*@description:Function to copy a string into an arena
+@in: struct arena *arena-arena, const char *str-string
+@out: char *
+@return: NULL for error and the copy otherwise */
+char *arena_strdup(struct arena *arena, const char *str);
+
+/*@description:Function to remember the position of an arena
+@in: struct arena *arena-arena
+@out: struct arena_mark *mark-position
+@return: void */
+void arena_mark(struct arena *arena, struct arena_mark *mark);
+
+/*@description:Function to free everything allocated after a mark
+@in: struct arena *arena-arena, struct arena_mark *mark-position
+@out: void
+@return: void */
+void arena_release(struct arena *arena, struct arena_mark *mark);
+
+/*@description:Function to free everything allocated from an arena, the
+blocks are kept
+@in: struct arena *arena-arena
+@out: void
+@return: void */
+void arena_reset(struct arena *arena);
+
+/*@description:Function to free the blocks of an arena
+@in: struct arena *arena-arena
+@out: void
+@return: void */
+void arena_destroy(struct arena *arena);
+
+#endif
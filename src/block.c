@@ -1,6 +1,7 @@
 #include "block.h"
 #include "clean_buff.h"
 #include "vector.h"
+#include "store_format.h"
 
 static struct block_store fd;
 
@@ -14,6 +15,7 @@ init_block_store(char *path)
         int ret         =       -1;
         DIR *dp = NULL;
         char filename[1024], block_path[1024];
+        struct store_header header;
 
         strcpy(block_path,path);
         sprintf(block_path, "%s/blocks", block_path);
@@ -33,6 +35,14 @@ init_block_store(char *path)
                         strerror(errno));
                 goto out;
         }
+        ret = read_store_header(fd.fd_block, BLOCK_STORE_MAGIC, &header);
+        if (ret == -1)
+                goto out;
+        if (ret == 1) {
+                ret = write_store_header(fd.fd_block, BLOCK_STORE_MAGIC, 0, 0);
+                if (ret == -1)
+                        goto out;
+        }
         ret = 0;
 out:
         if (dp != NULL)
@@ -42,117 +52,111 @@ out:
 }
 
 /*Function to write contents to a block file.
-Input:vector_ptr list,size_t length
+Input:vector_ptr list,size_t length,uint64_t *offset
 Output:int
 */
 int
-insert_block(vector_ptr list, size_t length)
+insert_block(vector_ptr list, size_t length, uint64_t *offset)
 {
 
         int ret                 =       -1;
-        vector_ptr temp_node    =       NULL;
+        off_t position          =       -1;
+        uint32_t block_length   =        0;
 
         if (length <= 0) {
                 goto out;
         }
-        if (write (fd.fd_block, &length, INT_SIZE) == -1) {
+        if (list == NULL) {
                 fprintf(stderr, "%s\n", strerror(errno));
                 goto out;
         }
-        ret = lseek(fd.fd_block, 1, SEEK_CUR);
-        if (ret == -1)
+        position = lseek(fd.fd_block, 0, SEEK_END);
+        if (position == -1) {
+                fprintf(stderr, "%s\n", strerror(errno));
                 goto out;
-        if (list == NULL) {
+        }
+        block_length = length;
+        if (vector_writev(fd.fd_block, list, &block_length,
+                BLOCK_HEADER_SIZE) == -1) {
                 fprintf(stderr, "%s\n", strerror(errno));
                 goto out;
         }
-
-        do {
-                temp_node = list;
-                if (-1 == write(fd.fd_block, temp_node->vector_element,
-                        temp_node->length)) {
-                        fprintf(stderr, "%s\n", strerror(errno));
-                        goto out;
-                }
-                list = list->next;
-                free(temp_node);
-        } while (list != NULL);
-
+        *offset = position;
+        ret = 0;
 out:
         return ret;
 
 }
 
-/*Function to get the block from blockstore.
-Input:int pos
+/*Function to get the block from blockstore. The offset recorded in the
+hash store is the start of the block record, so the length header and the
+payload are read directly from it.
+Input:uint64_t pos
 Output:char*
 */
 char*
-get_block(int pos, int *l)
+get_block(uint64_t pos, int *l)
 {
 
-        struct stat                     st;
-        int     size     =               0;
-        int    length    =               0;
+        uint32_t length  =               0;
         int     ret      =               -1;
         char    *buffer   =               NULL;
-        int     position =               1;
-
-        fstat(fd.fd_block, &st);
-        size = st.st_size;
-        /*rewind the stream pointer to the start of block file*/
-        if (size > 0) {
-                if (-1 == lseek(fd.fd_block, 0, SEEK_SET)) {
-                        printf("\nLseek failed with error: [%s]\n",
-                                strerror(errno));
-                        goto out;
-                }
-        }
-        while (size > 0) {
-                ret = read(fd.fd_block, &length, INT_SIZE);
-                *l = length;
-                if (ret == -1) {
-                        printf("\nError while reading %s", strerror(errno));
-                        goto out;
-                }
-                position = position+ret;
-                if (length <= 0) {
-                        goto out;
-                }
-                buffer = (char *)calloc(1, length+1);
-
-                if (position == pos) {
-                        ret = read(fd.fd_block, buffer, length);
-                        if (ret == -1) {
-                                printf("\nRead failed with error %s\n",
-                                        strerror(errno));
-                                goto out;
-                        }
-                        ret = 0;
-                        buffer[length] = '\0';
-                        break;
-                }
-                ret = read(fd.fd_block, buffer, length);
-                if (ret == -1) {
-                        printf("\nRead failed with error %s\n",
-                                strerror(errno));
-                        goto out;
-                }
-                position = position + length;
-                buffer[length] = '\0';
-                size -= (length+INT_SIZE);
-                clean_buff(&buffer);
 
+        ret = pread(fd.fd_block, &length, BLOCK_HEADER_SIZE, pos);
+        if (ret != BLOCK_HEADER_SIZE) {
+                printf("\nError while reading %s", strerror(errno));
+                ret = -1;
+                goto out;
+        }
+        buffer = (char *)calloc(1, length+1);
+        if (buffer == NULL) {
+                ret = -1;
+                goto out;
         }
+        ret = pread(fd.fd_block, buffer, length, pos + BLOCK_HEADER_SIZE);
+        if (ret != (int)length) {
+                printf("\nRead failed with error %s\n", strerror(errno));
+                ret = -1;
+                goto out;
+        }
+        *l = length;
         ret = 0;
 out:
-        if (ret == -1) {
-                memset(buffer, 0, length+1);
-        }
+        if (ret == -1)
+                clean_buff(&buffer);
         return buffer;
 
 }
 
+/*Function to read bytes of the block store.
+Input:uint64_t pos,char *buffer,size_t length
+Output:int
+*/
+int
+read_block_region(uint64_t pos, char *buffer, size_t length)
+{
+
+        if (pread(fd.fd_block, buffer, length, pos) != (ssize_t)length) {
+                printf("\nRead failed with error %s\n", strerror(errno));
+                return -1;
+        }
+        return 0;
+
+}
+
+/*Function to copy bytes of the block store into a file in the kernel.
+Input:uint64_t pos,int fd_out,uint64_t out_offset,size_t length
+Output:int
+*/
+int
+copy_block_region(uint64_t pos, int fd_out, uint64_t out_offset,
+        size_t length)
+{
+
+        return copy_file_region(fd.fd_block, pos, fd_out, out_offset, length);
+
+}
+
 /*Function to close block fd.
 Input:void
 Output:int*/
@@ -20,8 +20,10 @@
 #include<openssl/ssl.h>
 #include<openssl/sha.h>
 #endif
+#include <stdint.h>
 #define NAME_SIZE 100
 #define INT_SIZE sizeof(int)
+#define BLOCK_HEADER_SIZE sizeof(uint32_t)
 
 struct block_store
 {
@@ -36,10 +38,26 @@ struct block_store
 int init_block_store(char* path);
 
 /*@description:Function to get specific block from specified position 
-@in: int pos-position of block,
+@in: uint64_t pos-position of block,
 @out: char*
 @return: block */
-char* get_block(int pos, int *l);
+char* get_block(uint64_t pos, int *l);
+
+/*@description:Function to read bytes of the blockstore in one go, the
+records of many blocks are read together this way
+@in: uint64_t pos-position in the blockstore, size_t length-bytes to read
+@out: char *buffer-bytes read
+@return: -1 for error and 0 on success */
+int read_block_region(uint64_t pos, char *buffer, size_t length);
+
+/*@description:Function to copy bytes of the blockstore into a file without
+reading them into memory
+@in: uint64_t pos-position in the blockstore, int fd_out-file written,
+uint64_t out_offset-offset in fd_out, size_t length-bytes to copy
+@out: int
+@return: -1 for error and 0 on success */
+int copy_block_region(uint64_t pos, int fd_out, uint64_t out_offset,
+        size_t length);
 
 /*@description:Function to close filedescriptor of blockstore
 @in: void
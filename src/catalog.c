@@ -2,7 +2,468 @@
 #include "clean_buff.h"
 
 /* Globals */
-static size_t fd_cat;
+static int fd_log = -1;
+static int fd_idx = -1;
+static char cat_dir[1024];
+static struct catalog_index_header idx_header;
+
+#define INDEX_HEADER_OFFSET     STORE_HEADER_SIZE
+#define SLOTS_OFFSET    (STORE_HEADER_SIZE + sizeof(struct catalog_index_header))
+
+/*Function to hash a key of the catalog with 64 bit FNV-1a.
+Input:const char *key,size_t length
+Output:uint64_t
+*/
+static uint64_t
+catalog_hash(const char *key, size_t length)
+{
+
+        uint64_t        hash    =       14695981039346656037ULL;
+        size_t          i       =       0;
+
+        for (i = 0; i < length; i++) {
+                hash ^= (unsigned char)key[i];
+                hash *= 1099511628211ULL;
+        }
+        return hash;
+
+}
+
+/*Function to read a record of the log and its key.
+Input:uint64_t offset,char *key - PATH_MAX + 1 bytes
+Output:struct catalog_record *record,char *key
+*/
+static int
+read_record(uint64_t offset, struct catalog_record *record, char *key)
+{
+
+        int ret         =       -1;
+
+        if (pread(fd_log, record, sizeof(*record), offset) !=
+                sizeof(*record) || record->key_len > PATH_MAX ||
+                record->stub_len > NAME_MAX ||
+                pread(fd_log, key, record->key_len, offset + sizeof(*record))
+                != (ssize_t)record->key_len) {
+                fprintf(stderr, "Catalog record at %lu is corrupt\n",
+                        (unsigned long)offset);
+                goto out;
+        }
+        key[record->key_len] = '\0';
+        ret = 0;
+out:
+        return ret;
+
+}
+
+/*Function to find the slot of a key in the index.
+Input:char *key,uint64_t hash
+Output:uint64_t *slot_no - matching slot or the empty slot ending the probe,
+struct catalog_slot *slot - contents of the slot
+*/
+static int
+find_slot(char *key, uint64_t hash, uint64_t *slot_no,
+struct catalog_slot *slot)
+{
+
+        int             ret             =       -1;
+        uint64_t        i               =        0;
+        uint64_t        probes          =        0;
+        char            stored[PATH_MAX + 1];
+        struct catalog_record record;
+
+        i = hash & (idx_header.nr_slots - 1);
+        for (probes = 0; probes < idx_header.nr_slots; probes++) {
+                if (pread(fd_idx, slot, sizeof(*slot), SLOTS_OFFSET +
+                        i * sizeof(*slot)) != sizeof(*slot)) {
+                        fprintf(stderr, "%s\n", strerror(errno));
+                        goto out;
+                }
+                *slot_no = i;
+                if (slot->offset == 0) {
+                        ret = 1;
+                        goto out;
+                }
+                if (slot->offset != CATALOG_TOMBSTONE && slot->hash == hash) {
+                        ret = read_record(slot->offset, &record, stored);
+                        if (ret == -1)
+                                goto out;
+                        if (strcmp(stored, key) == 0) {
+                                ret = 0;
+                                goto out;
+                        }
+                }
+                i = (i + 1) & (idx_header.nr_slots - 1);
+        }
+        fprintf(stderr, "Catalog index is full\n");
+        ret = -1;
+out:
+        return ret;
+
+}
+
+/*Function to write a slot of the index.
+Input:uint64_t slot_no,uint64_t hash,uint64_t offset
+Output:int
+*/
+static int
+write_slot(uint64_t slot_no, uint64_t hash, uint64_t offset)
+{
+
+        struct catalog_slot slot;
+
+        slot.hash = hash;
+        slot.offset = offset;
+        if (pwrite(fd_idx, &slot, sizeof(slot), SLOTS_OFFSET +
+                slot_no * sizeof(slot)) != sizeof(slot)) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                return -1;
+        }
+        return 0;
+
+}
+
+/*Function to write the header of the index.
+Input:void
+Output:int
+*/
+static int
+write_index_header()
+{
+
+        if (pwrite(fd_idx, &idx_header, sizeof(idx_header),
+                INDEX_HEADER_OFFSET) != sizeof(idx_header)) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                return -1;
+        }
+        return 0;
+
+}
+
+/*Function to mark a record of the log dead, its slot is left to the
+caller.
+Input:uint64_t offset
+Output:int
+*/
+static int
+mark_dead(uint64_t offset)
+{
+
+        uint32_t        state   =       CATALOG_DEAD;
+
+        if (pwrite(fd_log, &state, sizeof(state), offset +
+                offsetof(struct catalog_record, state)) != sizeof(state)) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                return -1;
+        }
+        idx_header.live--;
+        idx_header.dead++;
+        return 0;
+
+}
+
+/*Function to rebuild the index from the log, sized for twice the live
+records. A key with more than one live record, left by a crash while it
+was replaced, keeps its last record.
+Input:void
+Output:int
+*/
+static int
+rebuild_index()
+{
+
+        int             ret             =       -1;
+        uint64_t        offset          =       STORE_HEADER_SIZE;
+        uint64_t        live            =        0;
+        uint64_t        hash            =        0;
+        uint64_t        slot_no         =        0;
+        char            key[PATH_MAX + 1];
+        struct stat     st;
+        struct catalog_record record;
+        struct catalog_slot slot;
+
+        if (fstat(fd_log, &st) == -1) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                goto out;
+        }
+        memset(&idx_header, 0, sizeof(idx_header));
+        for (offset = STORE_HEADER_SIZE; offset < (uint64_t)st.st_size;
+                offset += sizeof(record) + record.key_len + record.stub_len) {
+                /* A record cut short by a crash while it was appended is
+                 * dropped */
+                if (offset + sizeof(record) > (uint64_t)st.st_size ||
+                        pread(fd_log, &record, sizeof(record), offset) !=
+                        sizeof(record) || offset + sizeof(record) +
+                        record.key_len + record.stub_len >
+                        (uint64_t)st.st_size) {
+                        if (ftruncate(fd_log, offset) == -1) {
+                                fprintf(stderr, "%s\n", strerror(errno));
+                                ret = -1;
+                                goto out;
+                        }
+                        st.st_size = offset;
+                        break;
+                }
+                if (record.state == CATALOG_LIVE)
+                        live++;
+        }
+        idx_header.nr_slots = CATALOG_MIN_SLOTS;
+        while (idx_header.nr_slots < 4 * live)
+                idx_header.nr_slots *= 2;
+        if (ftruncate(fd_idx, 0) == -1 ||
+                ftruncate(fd_idx, SLOTS_OFFSET + idx_header.nr_slots *
+                sizeof(struct catalog_slot)) == -1) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                ret = -1;
+                goto out;
+        }
+        if (lseek(fd_idx, 0, SEEK_SET) == -1) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                ret = -1;
+                goto out;
+        }
+        ret = write_store_header(fd_idx, CATALOG_INDEX_MAGIC, 0, 0);
+        if (ret == -1)
+                goto out;
+        for (offset = STORE_HEADER_SIZE; offset + sizeof(record) <=
+                (uint64_t)st.st_size; offset += sizeof(record) +
+                record.key_len + record.stub_len) {
+                ret = read_record(offset, &record, key);
+                if (ret == -1)
+                        goto out;
+                if (record.state != CATALOG_LIVE) {
+                        idx_header.dead++;
+                        continue;
+                }
+                hash = catalog_hash(key, record.key_len);
+                ret = find_slot(key, hash, &slot_no, &slot);
+                if (ret == -1)
+                        goto out;
+                idx_header.live++;
+                if (ret == 0) {
+                        ret = mark_dead(slot.offset);
+                        if (ret == -1)
+                                goto out;
+                }
+                ret = write_slot(slot_no, hash, offset);
+                if (ret == -1)
+                        goto out;
+        }
+        idx_header.log_size = offset;
+        ret = write_index_header();
+out:
+        return ret;
+
+}
+
+/*Function to rewrite the log with its live records only and rebuild the
+index.
+Input:void
+Output:int
+*/
+static int
+compact_catalog()
+{
+
+        int             ret             =       -1;
+        int             fd              =       -1;
+        uint64_t        offset          =       STORE_HEADER_SIZE;
+        uint64_t        length          =        0;
+        char            *buffer         =       NULL;
+        char            log_path[1100];
+        char            tmp_path[1100];
+        struct catalog_record record;
+
+        sprintf(log_path, "%s/catalog.log", cat_dir);
+        sprintf(tmp_path, "%s/catalog.log.tmp", cat_dir);
+        buffer = (char *)malloc(sizeof(record) + PATH_MAX + NAME_MAX + 2);
+        fd = open(tmp_path, O_CREAT|O_TRUNC|O_RDWR, S_IRUSR|S_IWUSR);
+        if (buffer == NULL || fd == -1) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                goto out;
+        }
+        ret = write_store_header(fd, CATALOG_MAGIC, 0, 0);
+        if (ret == -1)
+                goto out;
+        for (offset = STORE_HEADER_SIZE; offset < idx_header.log_size;
+                offset += length) {
+                ret = read_record(offset, &record, buffer + sizeof(record));
+                if (ret == -1)
+                        goto out;
+                length = sizeof(record) + record.key_len + record.stub_len;
+                if (record.state != CATALOG_LIVE)
+                        continue;
+                if (pread(fd_log, buffer, length, offset) != (ssize_t)length
+                        || write(fd, buffer, length) != (ssize_t)length) {
+                        fprintf(stderr, "%s\n", strerror(errno));
+                        ret = -1;
+                        goto out;
+                }
+        }
+        if (fsync(fd) == -1 || rename(tmp_path, log_path) == -1) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                ret = -1;
+                goto out;
+        }
+        close(fd_log);
+        fd_log = fd;
+        fd = -1;
+        ret = rebuild_index();
+out:
+        clean_buff(&buffer);
+        if (fd != -1)
+                close(fd);
+        return ret;
+
+}
+
+/*Function to compact the catalog once enough of its log is dead.
+Input:void
+Output:int
+*/
+static int
+maybe_compact()
+{
+
+        if (idx_header.dead >= CATALOG_COMPACT_MIN &&
+                idx_header.dead > idx_header.live)
+                return compact_catalog();
+        return 0;
+
+}
+
+/*Function to add a record for key to the log and the index, replacing a
+live record of the same key. The record goes to the log before the index
+points at it, a crash in between leaves an index that is rebuilt.
+Input:char *key,struct catalog_entry *entry
+Output:int
+*/
+static int
+catalog_put(char *key, struct catalog_entry *entry)
+{
+
+        int             ret             =       -1;
+        uint64_t        hash            =        0;
+        uint64_t        slot_no         =        0;
+        uint64_t        offset          =        0;
+        size_t          key_len         =        0;
+        struct catalog_record record;
+        struct catalog_slot slot;
+        struct iovec    iov[3];
+
+        key_len = strlen(key);
+        if (key_len > PATH_MAX) {
+                fprintf(stderr, "%s: %s\n", key, strerror(ENAMETOOLONG));
+                goto out;
+        }
+        if ((idx_header.live + idx_header.tombs + 1) * 2 >
+                idx_header.nr_slots) {
+                ret = rebuild_index();
+                if (ret == -1)
+                        goto out;
+        }
+        memset(&record, 0, sizeof(record));
+        record.key_len = key_len;
+        record.stub_len = strlen(entry->stub);
+        record.state = CATALOG_LIVE;
+        record.size = entry->size;
+        record.chunks = entry->chunks;
+        record.unique_bytes = entry->unique_bytes;
+        iov[0].iov_base = &record;
+        iov[0].iov_len = sizeof(record);
+        iov[1].iov_base = key;
+        iov[1].iov_len = record.key_len;
+        iov[2].iov_base = entry->stub;
+        iov[2].iov_len = record.stub_len;
+        offset = idx_header.log_size;
+        if (pwritev(fd_log, iov, 3, offset) != (ssize_t)(sizeof(record) +
+                record.key_len + record.stub_len)) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                ret = -1;
+                goto out;
+        }
+        hash = catalog_hash(key, key_len);
+        ret = find_slot(key, hash, &slot_no, &slot);
+        if (ret == -1)
+                goto out;
+        idx_header.live++;
+        if (ret == 0) {
+                ret = mark_dead(slot.offset);
+                if (ret == -1)
+                        goto out;
+        }
+        ret = write_slot(slot_no, hash, offset);
+        if (ret == -1)
+                goto out;
+        idx_header.log_size = offset + iov[0].iov_len + iov[1].iov_len +
+                iov[2].iov_len;
+        ret = write_index_header();
+        if (ret == -1)
+                goto out;
+        ret = maybe_compact();
+out:
+        return ret;
+
+}
+
+/*Function to move the entries of a catalog of the old format, a list of
+length prefixed paths, into the log.
+Input:char *filename
+Output:int
+*/
+static int
+import_old_catalog(char *filename)
+{
+
+        int     ret             =       -1;
+        int     fd              =       -1;
+        int     length          =        0;
+        char    *ts1            =       NULL;
+        char    key[PATH_MAX + 1];
+        struct catalog_entry entry;
+
+        fd = open(filename, O_RDONLY);
+        if (fd == -1) {
+                if (errno == ENOENT)
+                        ret = 0;
+                else
+                        fprintf(stderr, "%s\n", strerror(errno));
+                goto out;
+        }
+        while ((ret = read(fd, &length, int_size)) == int_size) {
+                if (length < 0 || length > PATH_MAX ||
+                        read(fd, key, length) != length) {
+                        fprintf(stderr, "%s is corrupt\n", filename);
+                        ret = -1;
+                        goto out;
+                }
+                key[length] = '\0';
+                ts1 = strdup(key);
+                if (ts1 == NULL) {
+                        fprintf(stderr, "%s\n", strerror(errno));
+                        ret = -1;
+                        goto out;
+                }
+                memset(&entry, 0, sizeof(entry));
+                snprintf(entry.stub, sizeof(entry.stub), "%s",
+                        basename(ts1));
+                clean_buff(&ts1);
+                ret = catalog_put(key, &entry);
+                if (ret == -1)
+                        goto out;
+        }
+        if (ret == -1) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                goto out;
+        }
+        ret = remove(filename);
+        if (ret == -1)
+                fprintf(stderr, "%s\n", strerror(errno));
+out:
+        if (fd != -1)
+                close(fd);
+        return ret;
+
+}
 
 /*Function to create catalog file.
 Input:void
@@ -14,9 +475,12 @@ init_catalog_store(char *path)
         int ret         =       -1;
         DIR *dp = NULL;
         char filename[1024],cat_path[1024];
+        struct stat st;
+        struct store_header header;
 
         strcpy(cat_path,path);
         sprintf(cat_path, "%s/catalogs", cat_path);
+        strcpy(cat_dir, cat_path);
         dp = opendir(cat_path);
         if (NULL == dp) {
                 ret = mkdir(cat_path, 0777);
@@ -25,13 +489,43 @@ init_catalog_store(char *path)
                         goto out;
                 }
         }
-        sprintf (filename,"%s/filecatalog.txt",cat_path);
-        fd_cat = open(filename, O_APPEND|O_CREAT|O_RDWR,
-                S_IRUSR|S_IWUSR);
-        if (fd_cat < 1) {
+        sprintf (filename,"%s/catalog.log",cat_path);
+        fd_log = open(filename, O_CREAT|O_RDWR, S_IRUSR|S_IWUSR);
+        sprintf (filename,"%s/catalog.idx",cat_path);
+        fd_idx = open(filename, O_CREAT|O_RDWR, S_IRUSR|S_IWUSR);
+        if (fd_log == -1 || fd_idx == -1 || fstat(fd_log, &st) == -1) {
                 fprintf(stderr, "%s\n", strerror(errno));
+                ret = -1;
                 goto out;
         }
+        if (st.st_size == 0) {
+                ret = write_store_header(fd_log, CATALOG_MAGIC, 0, 0);
+                if (ret == -1)
+                        goto out;
+                st.st_size = STORE_HEADER_SIZE;
+        } else {
+                ret = read_store_header(fd_log, CATALOG_MAGIC, &header);
+                if (ret != 0) {
+                        ret = -1;
+                        goto out;
+                }
+        }
+        if (pread(fd_idx, &header, STORE_HEADER_SIZE, 0) != STORE_HEADER_SIZE
+                || memcmp(header.magic, CATALOG_INDEX_MAGIC, MAGIC_LEN) != 0
+                || header.version != STORE_FORMAT_VERSION ||
+                pread(fd_idx, &idx_header, sizeof(idx_header),
+                INDEX_HEADER_OFFSET) != sizeof(idx_header) ||
+                idx_header.log_size != (uint64_t)st.st_size ||
+                idx_header.nr_slots < CATALOG_MIN_SLOTS ||
+                (idx_header.nr_slots & (idx_header.nr_slots - 1)) != 0) {
+                ret = rebuild_index();
+                if (ret == -1)
+                        goto out;
+        }
+        sprintf (filename,"%s/filecatalog.txt",cat_path);
+        ret = import_old_catalog(filename);
+        if (ret == -1)
+                goto out;
         ret = 0;
 out:
         if (dp != NULL)
@@ -40,34 +534,124 @@ out:
 
 }
 
-/*Function to write contents to a catalog file.
-Input:char* filename
-Output:int
+/*Function to get the key a file is cataloged under, its logical name as
+given or else its absolute path. A file that does not exist, one deleted
+before it is restored, is resolved through its directory.
+Input:char *path,char *name
+Output:char *key - PATH_MAX + 1 bytes
 */
-int
-writecatalog(char *filename)
+static int
+catalog_key(char *path, char *name, char *key)
 {
 
         int ret                 =       -1;
-        char actualpath[PATH_MAX+1];
-        char *real_path         =       NULL;
-        int size_of_real_path   =       0;
+        char *tmp               =       NULL;
+        char dir[PATH_MAX + 1];
 
-        if (filename == '\0' || filename == NULL) {
+        if (name != NULL) {
+                if (strlen(name) > PATH_MAX)
+                        goto out;
+                strcpy(key, name);
+                ret = 0;
                 goto out;
         }
-        real_path = realpath(filename, actualpath);
-        if (real_path == NULL) {
-                fprintf(stderr, "%s\n", strerror(errno));
+        if (path == NULL || *path == '\0')
+                goto out;
+        if (realpath(path, key) != NULL) {
+                ret = 0;
                 goto out;
         }
-        size_of_real_path = strlen(real_path);
-        if (-1 == write(fd_cat, &size_of_real_path, int_size)) {
+        tmp = strdup(path);
+        if (tmp == NULL)
+                goto out;
+        if (errno != ENOENT || realpath(dirname(tmp), dir) == NULL) {
                 fprintf(stderr, "%s\n", strerror(errno));
                 goto out;
         }
-        if (-1 == write(fd_cat, real_path, size_of_real_path)) {
+        strcpy(tmp, path);
+        if (snprintf(key, PATH_MAX + 1, "%s/%s", strcmp(dir, "/") == 0 ?
+                "" : dir, basename(tmp)) > PATH_MAX)
+                goto out;
+        ret = 0;
+out:
+        free(tmp);
+        return ret;
+
+}
+
+/*Function to write contents to a catalog file.
+Input:char* filename,struct catalog_entry *entry
+Output:int
+*/
+int
+writecatalog(char *filename, struct catalog_entry *entry)
+{
+
+        int ret                 =       -1;
+        char key[PATH_MAX + 1];
+
+        ret = catalog_key(filename, NULL, key);
+        if (ret == -1)
+                goto out;
+        ret = catalog_put(key, entry);
+out:
+        return ret;
+
+}
+
+/*Function to write a name to a catalog file as given.
+Input:char *name,struct catalog_entry *entry
+Output:int
+*/
+int
+writecatalog_name(char *name, struct catalog_entry *entry)
+{
+
+        int ret                 =       -1;
+        char key[PATH_MAX + 1];
+
+        ret = catalog_key(NULL, name, key);
+        if (ret == -1)
+                goto out;
+        ret = catalog_put(key, entry);
+out:
+        return ret;
+
+}
+
+/*Function to look up a file in the catalog index.
+Input:char *path,char *name
+Output:struct catalog_entry *entry
+*/
+int
+read_catalog_entry(char *path, char *name, struct catalog_entry *entry)
+{
+
+        int ret         =       -1;
+        uint64_t slot_no =       0;
+        char key[PATH_MAX + 1];
+        char stored[PATH_MAX + 1];
+        struct catalog_record record;
+        struct catalog_slot slot;
+
+        ret = catalog_key(path, name, key);
+        if (ret == -1)
+                goto out;
+        ret = find_slot(key, catalog_hash(key, strlen(key)), &slot_no,
+                &slot);
+        if (ret != 0 || entry == NULL)
+                goto out;
+        ret = read_record(slot.offset, &record, stored);
+        if (ret == -1)
+                goto out;
+        memset(entry, 0, sizeof(*entry));
+        entry->size = record.size;
+        entry->chunks = record.chunks;
+        entry->unique_bytes = record.unique_bytes;
+        if (pread(fd_log, entry->stub, record.stub_len, slot.offset +
+                sizeof(record) + record.key_len) != (ssize_t)record.stub_len) {
                 fprintf(stderr, "%s\n", strerror(errno));
+                ret = -1;
                 goto out;
         }
         ret = 0;
@@ -84,191 +668,91 @@ int
 readfilecatalog()
 {
 
-        struct stat              st;
         int ret          =       -1;
-        char *buffer     =      NULL;
-        int size         =       0;
-        int length       =       0;
-
-        fstat(fd_cat, &st);
-        size = st.st_size;
-        if (size > 0) {
-                if (-1 == lseek(fd_cat, 0, SEEK_SET)) {
-                        fprintf(stderr, "%s\n", strerror(errno));
-                        goto out;
-                }
-        } else {
+        uint64_t offset  =       STORE_HEADER_SIZE;
+        char key[PATH_MAX + 1];
+        char stub[NAME_MAX + 1];
+        struct catalog_record record;
+
+        if (idx_header.live == 0) {
                 printf("This namespace dose not continue any files\n");
+                ret = 0;
                 goto out;
         }
         printf("\nAbsolute path of deduped files are:\n");
-        while (size > 0) {
-                ret = read(fd_cat, &length, int_size);
-                if (ret == -1) {
-                        fprintf(stderr, "%s\n", strerror(errno));
+        for (offset = STORE_HEADER_SIZE; offset < idx_header.log_size;
+                offset += sizeof(record) + record.key_len + record.stub_len) {
+                ret = read_record(offset, &record, key);
+                if (ret == -1)
                         goto out;
-                }
-                buffer = (char *)calloc(1, length + 1);
-                ret = read(fd_cat, buffer, length);
-                if (ret == -1) {
+                if (record.state != CATALOG_LIVE)
+                        continue;
+                if (pread(fd_log, stub, record.stub_len, offset +
+                        sizeof(record) + record.key_len) !=
+                        (ssize_t)record.stub_len) {
                         fprintf(stderr, "%s\n", strerror(errno));
+                        ret = -1;
                         goto out;
                 }
-                buffer[length] = '\0';
-                printf("\n%s\n", buffer);
-                size -= (length + int_size);
-                memset(buffer, 0, length+1);
-                clean_buff(&buffer);
-                ret = 1;
+                stub[record.stub_len] = '\0';
+                printf("\n%s\n", key);
+                printf("  %lu bytes, %lu chunks, %lu unique bytes, "
+                        "stub %s\n", (unsigned long)record.size,
+                        (unsigned long)record.chunks,
+                        (unsigned long)record.unique_bytes, stub);
         }
         printf("\n");
+        ret = 0;
 out:
         return ret;
 
 }
 
-/*Function to reset all deduped files from a catalog file.
-Input:void
+/*Function to delete a file from the catalog.
+Input:char *file_path,char *name
 Output:int
 */
 int
-reset_catalog(char *file_path, char *path)
+reset_catalog(char *file_path, char *name)
 {
 
-        struct stat             st;
-        int     size                    =          0;
-        int     length                  =          0;
         int     ret                     =         -1;
-        char    *buffer                 =       NULL;
-        DIR     *dp                     =       NULL;
-        int     fd                      =          0;
-        char filename[1024], cat_path[1024], temp_filename[1024];
+        uint64_t slot_no                =          0;
+        char key[PATH_MAX + 1];
+        struct catalog_slot slot;
 
-        strcpy(cat_path, path);
-        sprintf(cat_path, "%s/store_block/catalogs", cat_path);
-
-        dp = opendir(cat_path);
-        if (NULL == dp) {
-                fprintf(stderr, "%s\n", strerror(errno));
+        ret = catalog_key(file_path, name, key);
+        if (ret == -1)
                 goto out;
-        }
-        sprintf (filename,"%s/filecatalog.txt",cat_path);
-        sprintf (temp_filename,"%s/temp_filecatalog.txt",cat_path);
-        fd = open(temp_filename, O_RDONLY | O_WRONLY | O_TRUNC | O_CREAT,
-                S_IRUSR|S_IWUSR);
-        if (fd < 1) {
-                fprintf(stderr, "%s\n", strerror(errno));
+        ret = find_slot(key, catalog_hash(key, strlen(key)), &slot_no,
+                &slot);
+        if (ret != 0)
                 goto out;
-        }
-
-        fstat(fd_cat, &st);
-        size = st.st_size;
-        /*rewind the stream pointer to the start of catalog file*/
-        if (size > 0) {
-                if (-1 == lseek(fd_cat, 0, SEEK_SET)) {
-                        fprintf(stderr, "%s\n", strerror(errno));
-                        goto out;
-                }
-        }
-        if (size == 0) {
-                ret = 1;
+        ret = mark_dead(slot.offset);
+        if (ret == -1)
                 goto out;
-        }
-        while (size > 0) {
-                ret = read(fd_cat, &length, int_size);
-                if (ret == -1) {
-                        fprintf(stderr, "%s\n", strerror(errno));
-                        goto out;
-                }
-                buffer = (char *)calloc(1, length+1);
-                ret = read(fd_cat, buffer, length);
-                if (ret == -1) {
-                        fprintf(stderr, "%s\n", strerror(errno));
-                        goto out;
-                }
-                buffer[length] = '\0';
-                if (strcmp(file_path, buffer) != 0) {
-                        if (-1 == write(fd, &length, int_size)) {
-                                fprintf(stderr, "%s\n", strerror(errno));
-                                goto out;
-                        }
-                        if (-1 == write(fd, buffer, length)) {
-                                fprintf(stderr, "%s\n", strerror(errno));
-                                goto out;
-                        }
-                }
-                size -= (length + int_size);
-                memset(buffer, 0, length+1);
-                clean_buff(&buffer);
-        }
-        ret = remove(filename);
-        if (ret < 0)
+        ret = write_slot(slot_no, slot.hash, CATALOG_TOMBSTONE);
+        if (ret == -1)
                 goto out;
-        ret = rename(temp_filename,filename);
-        if (ret < 0)
+        idx_header.tombs++;
+        ret = write_index_header();
+        if (ret == -1)
                 goto out;
-        ret = 0;
+        ret = maybe_compact();
 out:
-        if(fd != -1)
-                close(fd);
-        if (dp != NULL)
-                closedir(dp);
         return ret;
 
 }
 
 /*Function to compare absolute path of file in file catalog.
-Input:char out[],int fd_cat
+Input:char out[]
 Output:int
 */
 int
 comparepath(char out[])
 {
 
-        struct stat             st;
-        int     size    =               0;
-        size_t  length  =               0;
-        int     ret     =               -1;
-        char    *buffer  =               NULL;
-
-        fstat(fd_cat, &st);
-        size = st.st_size;
-        /*rewind the stream pointer to the start of catalog file*/
-        if (size > 0) {
-                if (-1 == lseek(fd_cat, 0, SEEK_SET)) {
-                        fprintf(stderr, "%s\n", strerror(errno));
-                        goto out;
-                }
-        }
-        if (size == 0) {
-                ret = 1;
-                goto out;
-        }
-        while (size > 0) {
-                ret = read(fd_cat, &length, int_size);
-                if (ret == -1) {
-                        fprintf(stderr, "%s\n", strerror(errno));
-                        goto out;
-                }
-                buffer = (char *)calloc(1, length+1);
-                ret = read(fd_cat, buffer, length);
-                if (ret == -1) {
-                        fprintf(stderr, "%s\n", strerror(errno));
-                        goto out;
-                }
-                buffer[length] = '\0';
-                if (strcmp(out, buffer) == 0) {
-                        ret = 0;
-                        clean_buff(&buffer);
-                        break;
-                }
-                size -= (length + int_size);
-                memset(buffer, 0, length+1);
-                clean_buff(&buffer);
-                ret = 1;
-        }
-out:
-        return ret;
+        return read_catalog_entry(out, NULL, NULL);
 
 }
 
@@ -279,16 +763,16 @@ int
 fini_catalog_store()
 {
 
-        int ret         =       -1;
+        int ret         =       0;
 
-        if (fd_cat != -1)
-                ret = close(fd_cat);
-        if (ret == -1) {
+        if (fd_log != -1 && close(fd_log) == -1)
+                ret = -1;
+        if (fd_idx != -1 && close(fd_idx) == -1)
+                ret = -1;
+        fd_log = -1;
+        fd_idx = -1;
+        if (ret == -1)
                 fprintf(stderr, "%s\n", strerror(errno));
-                goto out;
-        }
-        ret = 0;
-out:
-return ret;
+        return ret;
 
 }
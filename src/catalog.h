@@ -8,6 +8,10 @@
 #include<sys/stat.h>
 #include<sys/types.h>
 #include<fcntl.h>
+#include<stdint.h>
+#include<stddef.h>
+#include<limits.h>
+#include<sys/uio.h>
 #include<time.h> 
 #include <libgen.h> 
 #include<openssl/md5.h>
@@ -23,19 +27,116 @@
 #define block 10
 #define NAME_SIZE 100
 #define int_size sizeof(int)
+#include "store_format.h"
+/* File path standing for stdin when deduping and stdout when restoring */
+#define STREAM_PATH "-"
 
+#define CATALOG_MAGIC           "YDLN"
+#define CATALOG_INDEX_MAGIC     "YDLK"
+/* Slots of the smallest catalog index, a power of two */
+#define CATALOG_MIN_SLOTS       1024
+/* Deleted entries a catalog keeps before it is compacted, compaction also
+ * waits for them to outnumber the live entries */
+#define CATALOG_COMPACT_MIN     64
+#define CATALOG_DEAD            0
+#define CATALOG_LIVE            1
+/* Offset of a slot whose entry was deleted, lookups probe past it */
+#define CATALOG_TOMBSTONE       UINT64_MAX
 
-/*@description:Function to create catalogstore
-@in: void
+/*What the catalog knows about a deduped file.
+        size         : Bytes of the file
+        chunks       : Chunks of the file
+        unique_bytes : Bytes of the chunks the file added to the store
+        stub         : Name of the stub of the file in store_block/stubs
+*/
+struct catalog_entry
+{
+        uint64_t        size;
+        uint64_t        chunks;
+        uint64_t        unique_bytes;
+        char            stub[NAME_MAX + 1];
+};
+
+/*Record of the catalog log, catalogs/catalog.log. The log is a store
+header with CATALOG_MAGIC and records appended in the order files are
+deduped, each followed by key_len bytes of key and stub_len bytes of stub
+name. A deleted or replaced record is marked CATALOG_DEAD in place and
+dropped when the log is compacted.
+        state : CATALOG_LIVE or CATALOG_DEAD
+*/
+struct catalog_record
+{
+        uint32_t        key_len;
+        uint32_t        stub_len;
+        uint32_t        state;
+        uint32_t        reserved;
+        uint64_t        size;
+        uint64_t        chunks;
+        uint64_t        unique_bytes;
+};
+
+/*Header of the catalog index, catalogs/catalog.idx, after its store
+header with CATALOG_INDEX_MAGIC. The slots of an open addressing table
+keyed by the hash of the key follow it. An index whose log_size is not the
+size of the log is rebuilt from the log.
+        nr_slots : Slots of the table, a power of two
+        live     : Live records of the log
+        dead     : Dead records of the log
+        tombs    : Slots of deleted records
+        log_size : Size of the log the index was written for
+*/
+struct catalog_index_header
+{
+        uint64_t        nr_slots;
+        uint64_t        live;
+        uint64_t        dead;
+        uint64_t        tombs;
+        uint64_t        log_size;
+};
+
+/*Slot of the catalog index.
+        hash   : Hash of the key
+        offset : Offset of the record in the log, 0 for an empty slot and
+                 CATALOG_TOMBSTONE for a deleted one
+*/
+struct catalog_slot
+{
+        uint64_t        hash;
+        uint64_t        offset;
+};
+
+/*@description:Function to open the catalog store, the index is rebuilt
+if it is missing or out of date and a catalog of the old format is moved
+into the log
+@in: char *path-path of store_block of the namespace
 @out: int 
 @return: -1 for error and 0 if created successfully */
 int init_catalog_store(char *path);
 
-/*@description:Function to write the full path of file to catalog
-@in: char* filename-filename of file that has been deduped
+/*@description:Function to write the full path of file to catalog, an entry
+of the same path is replaced. Every path taken by the catalog is made
+absolute the same way, so a file is found however it is named.
+@in: char* filename-filename of file that has been deduped,
+struct catalog_entry *entry-what is known about the file
+@out: int 
+@return: -1 for error and 0 if inserted successfully */
+int writecatalog(char* filename, struct catalog_entry *entry);
+
+/*@description:Function to write the logical name of a file deduped from a
+stream to catalog, the name is written as given
+@in: char* name-name the stream is deduped under,
+struct catalog_entry *entry-what is known about the file
 @out: int 
 @return: -1 for error and 0 if inserted successfully */
-int writecatalog(char* filename);
+int writecatalog_name(char *name, struct catalog_entry *entry);
+
+/*@description:Function to look up a file in the catalog
+@in: char *path-path of the file, char *name-logical name of the file,
+NULL to look it up by path
+@out: struct catalog_entry *entry-what is known about the file, NULL if
+not needed
+@return: -1 for error, 1 if the file is not cataloged and 0 if found */
+int read_catalog_entry(char *path, char *name, struct catalog_entry *entry);
 
 /*@description:Function to read all deduped files from a catalog file.
 @in: void
@@ -46,14 +147,20 @@ int readfilecatalog();
 /*@description:Function to compare absolute path of file in file catalog.
 @in: char out[]-path of file.
 @out: int 
-@return: -1 for error and 0 if created successfully */
+@return: -1 for error, 1 if not found and 0 if found */
 int comparepath(char out[]);
 
-int reset_catalog(char *file_path, char *path);
+/*@description:Function to delete a file from the catalog. Its record is
+marked dead and the log is compacted once dead records outnumber the live
+ones.
+@in: char *file_path-path of file, char *name-logical name of the file,
+NULL to delete it by path
+@out: int 
+@return: -1 for error, 1 if not found and 0 if deleted */
+int reset_catalog(char *file_path, char *name);
 
 /*@description:Function to close filedescriptor of catalogstore
 @in: void
 @out: int 
 @return: -1 for error and 0 if closed successfully */
 int fini_catalog_store();
-
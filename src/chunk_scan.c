@@ -0,0 +1,331 @@
+#include <pthread.h>
+#include "chunk_scan.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define HAVE_SCAN_AVX2 1
+#endif
+
+typedef size_t (*scan_fn)(const struct rabin_config *config,
+        const unsigned char *data, size_t from, size_t to, rabin_poly mask);
+
+static scan_fn scan_kernel;
+static const char *scan_kernel_name;
+static pthread_once_t scan_once = PTHREAD_ONCE_INIT;
+
+/*Function to find the first boundary candidate one position at a time.
+ The window before from is hashed without cancelling bytes, the fingerprint
+ of the first window bytes does not depend on anything before them.
+Input:
+        struct rabin_config *config : Window and lookup tables
+        unsigned char *data     : Chunk bytes
+        size_t from             : First position to check
+        size_t to               : End of the positions to check
+        rabin_poly mask         : Bits that have to be zero
+Output:
+        size_t                  : Position of the candidate, to if none
+*/
+static size_t
+scan_scalar(const struct rabin_config *config, const unsigned char *data,
+        size_t from, size_t to, rabin_poly mask)
+{
+
+        const rabin_poly *out_table     =       config->out_table;
+        const rabin_poly *mod_table     =       config->mod_table;
+        size_t          window          =       config->params.window;
+        size_t          i               =       0;
+        rabin_poly      digest          =       0;
+
+        if (from >= to)
+                return to;
+        for (i = from + 1 - window; i <= from; i++)
+                digest = ((digest << 8) | data[i]) ^
+                        mod_table[digest >> RABIN_POLY_SHIFT];
+        if ((digest & mask) == 0)
+                return from;
+        for (i = from + 1; i < to; i++) {
+                digest ^= out_table[data[i - window]];
+                digest = ((digest << 8) | data[i]) ^
+                        mod_table[digest >> RABIN_POLY_SHIFT];
+                if ((digest & mask) == 0)
+                        return i;
+        }
+        return to;
+
+}
+
+#ifdef HAVE_SCAN_AVX2
+/*Function to load 8 bytes of a lane, byte t lands in bits 8t..8t+7.
+Input:
+        unsigned char *p        : First byte
+Output:
+        long long               : Bytes
+*/
+static inline long long
+load_lane(const unsigned char *p)
+{
+
+        uint64_t        v       =       0;
+
+        memcpy(&v, p, sizeof(v));
+        return (long long)v;
+
+}
+
+/*Function to find the first boundary candidate with AVX2. The Rabin
+ fingerprint has a serial dependency from byte to byte, so the positions are
+ split into SCAN_LANES contiguous segments instead and each 64 bit lane rolls
+ through one of them, the table lookups become gathers. The mod_table gather
+ sits on the dependency chain, two registers keep two chains in flight.
+ A lane only remembers the group of SCAN_GROUP positions it first hit in,
+ the scalar kernel finds the exact position in the lowest lane that hit.
+ Lane 0 hitting ends the segments early, a later lane can only win once all
+ lanes before it are done.
+Input:
+        struct rabin_config *config : Window and lookup tables
+        unsigned char *data     : Chunk bytes
+        size_t from             : First position to check
+        size_t to               : End of the positions to check
+        rabin_poly mask         : Bits that have to be zero
+Output:
+        size_t                  : Position of the candidate, to if none
+*/
+__attribute__((target("avx2")))
+static size_t
+scan_avx2(const struct rabin_config *config, const unsigned char *data,
+        size_t from, size_t to, rabin_poly mask)
+{
+
+        const long long *out_table      =
+                (const long long *)config->out_table;
+        const long long *mod_table      =
+                (const long long *)config->mod_table;
+        const rabin_poly *mod_scalar    =       config->mod_table;
+        size_t          window          =       config->params.window;
+        size_t          lane_min        =       0;
+        size_t          lane_len        =       0;
+        size_t          start[SCAN_LANES];
+        size_t          hit_from[SCAN_LANES];
+        size_t          hit_to[SCAN_LANES];
+        rabin_poly      warm[SCAN_LANES];
+        size_t          i               =       0;
+        size_t          j               =       0;
+        int             k               =       0;
+        int             t               =       0;
+        int             seen            =       0;
+        int             hits            =       0;
+        __m256i         a, b, in_a, in_b, out_a, out_b, acc_a, acc_b;
+        __m256i         top, byte_mask, zero, mask_v;
+
+        byte_mask = _mm256_set1_epi64x(0xff);
+        zero = _mm256_setzero_si256();
+        mask_v = _mm256_set1_epi64x((long long)mask);
+        /* Every lane hashes a window before its first position, segments
+         * much shorter than that are cheaper for the scalar kernel */
+        lane_min = 2 * window;
+        if (lane_min < 4 * SCAN_GROUP + 1)
+                lane_min = 4 * SCAN_GROUP + 1;
+        while (to - from >= SCAN_LANES * lane_min) {
+                /* Lanes much longer than the expected distance between
+                 * candidates mostly hash positions past the first one */
+                lane_len = (to - from) / SCAN_LANES;
+                if (lane_len > (mask + 1) / SCAN_LANES)
+                        lane_len = (mask + 1) / SCAN_LANES;
+                if (lane_len > SCAN_LANE_MAX)
+                        lane_len = SCAN_LANE_MAX;
+                if (lane_len < lane_min)
+                        lane_len = lane_min;
+                lane_len = (lane_len - 1) / SCAN_GROUP * SCAN_GROUP + 1;
+                for (k = 0; k < SCAN_LANES; k++) {
+                        start[k] = from + k * lane_len;
+                        warm[k] = 0;
+                }
+                for (i = window; i > 0; i--)
+                        for (k = 0; k < SCAN_LANES; k++)
+                                warm[k] = ((warm[k] << 8) |
+                                        data[start[k] + 1 - i]) ^
+                                        mod_scalar[warm[k] >>
+                                        RABIN_POLY_SHIFT];
+                a = _mm256_set_epi64x(warm[3], warm[2], warm[1], warm[0]);
+                b = _mm256_set_epi64x(warm[7], warm[6], warm[5], warm[4]);
+                seen = 0;
+                for (k = 0; k < SCAN_LANES; k++) {
+                        if ((warm[k] & mask) == 0) {
+                                seen |= 1 << k;
+                                hit_from[k] = start[k];
+                                hit_to[k] = start[k] + 1;
+                        }
+                }
+                for (j = 1; j < lane_len && !(seen & 1); j += SCAN_GROUP) {
+                        in_a = _mm256_set_epi64x(
+                                load_lane(data + start[3] + j),
+                                load_lane(data + start[2] + j),
+                                load_lane(data + start[1] + j),
+                                load_lane(data + start[0] + j));
+                        in_b = _mm256_set_epi64x(
+                                load_lane(data + start[7] + j),
+                                load_lane(data + start[6] + j),
+                                load_lane(data + start[5] + j),
+                                load_lane(data + start[4] + j));
+                        out_a = _mm256_set_epi64x(
+                                load_lane(data + start[3] + j - window),
+                                load_lane(data + start[2] + j - window),
+                                load_lane(data + start[1] + j - window),
+                                load_lane(data + start[0] + j - window));
+                        out_b = _mm256_set_epi64x(
+                                load_lane(data + start[7] + j - window),
+                                load_lane(data + start[6] + j - window),
+                                load_lane(data + start[5] + j - window),
+                                load_lane(data + start[4] + j - window));
+                        acc_a = zero;
+                        acc_b = zero;
+                        for (t = 0; t < SCAN_GROUP; t++) {
+                                a = _mm256_xor_si256(a,
+                                        _mm256_i64gather_epi64(out_table,
+                                        _mm256_and_si256(out_a, byte_mask),
+                                        8));
+                                b = _mm256_xor_si256(b,
+                                        _mm256_i64gather_epi64(out_table,
+                                        _mm256_and_si256(out_b, byte_mask),
+                                        8));
+                                top = _mm256_srli_epi64(a, RABIN_POLY_SHIFT);
+                                a = _mm256_or_si256(_mm256_slli_epi64(a, 8),
+                                        _mm256_and_si256(in_a, byte_mask));
+                                a = _mm256_xor_si256(a,
+                                        _mm256_i64gather_epi64(mod_table,
+                                        top, 8));
+                                top = _mm256_srli_epi64(b, RABIN_POLY_SHIFT);
+                                b = _mm256_or_si256(_mm256_slli_epi64(b, 8),
+                                        _mm256_and_si256(in_b, byte_mask));
+                                b = _mm256_xor_si256(b,
+                                        _mm256_i64gather_epi64(mod_table,
+                                        top, 8));
+                                acc_a = _mm256_or_si256(acc_a,
+                                        _mm256_cmpeq_epi64(_mm256_and_si256(
+                                        a, mask_v), zero));
+                                acc_b = _mm256_or_si256(acc_b,
+                                        _mm256_cmpeq_epi64(_mm256_and_si256(
+                                        b, mask_v), zero));
+                                in_a = _mm256_srli_epi64(in_a, 8);
+                                in_b = _mm256_srli_epi64(in_b, 8);
+                                out_a = _mm256_srli_epi64(out_a, 8);
+                                out_b = _mm256_srli_epi64(out_b, 8);
+                        }
+                        hits = _mm256_movemask_pd(_mm256_castsi256_pd(acc_a)) |
+                                (_mm256_movemask_pd(
+                                _mm256_castsi256_pd(acc_b)) << 4);
+                        hits &= ~seen;
+                        for (k = 0; hits != 0; k++, hits >>= 1) {
+                                if (hits & 1) {
+                                        seen |= 1 << k;
+                                        hit_from[k] = start[k] + j;
+                                        hit_to[k] = start[k] + j + SCAN_GROUP;
+                                }
+                        }
+                }
+                if (seen != 0) {
+                        k = __builtin_ctz(seen);
+                        return scan_scalar(config, data, hit_from[k],
+                                hit_to[k], mask);
+                }
+                from += SCAN_LANES * lane_len;
+        }
+        return scan_scalar(config, data, from, to, mask);
+
+}
+#endif
+
+/*Function to select the boundary scan kernel.
+Input:
+        int kernel              : scan_kernel
+Output:
+        int                     : 0 on success, -1 if the CPU lacks it
+*/
+int
+chunk_scan_set_kernel(int kernel)
+{
+
+        int     ret     =       -1;
+
+        switch (kernel) {
+        case SCAN_AUTO:
+#ifdef HAVE_SCAN_AVX2
+                if (__builtin_cpu_supports("avx2")) {
+                        ret = chunk_scan_set_kernel(SCAN_AVX2);
+                        break;
+                }
+#endif
+                ret = chunk_scan_set_kernel(SCAN_SCALAR);
+                break;
+        case SCAN_SCALAR:
+                scan_kernel = scan_scalar;
+                scan_kernel_name = "scalar";
+                ret = 0;
+                break;
+#ifdef HAVE_SCAN_AVX2
+        case SCAN_AVX2:
+                if (!__builtin_cpu_supports("avx2"))
+                        break;
+                scan_kernel = scan_avx2;
+                scan_kernel_name = "avx2";
+                ret = 0;
+                break;
+#endif
+        default:
+                break;
+        }
+        return ret;
+
+}
+
+/*Function to pick the fastest kernel on first use, chunkers on several
+ threads may race to it. A kernel set explicitly before is kept.
+Input:
+        None
+Output:
+        None
+*/
+static void
+scan_select(void)
+{
+
+        if (scan_kernel == NULL)
+                chunk_scan_set_kernel(SCAN_AUTO);
+
+}
+
+/*Function to get the name of the selected scan kernel.
+Input:
+        None
+Output:
+        const char *            : Name of the kernel
+*/
+const char *
+chunk_scan_kernel_name(void)
+{
+
+        pthread_once(&scan_once, scan_select);
+        return scan_kernel_name;
+
+}
+
+/*Function to find the first chunk boundary candidate with the selected
+ kernel.
+Input:
+        struct rabin_config *config : Window and lookup tables
+        unsigned char *data     : Chunk bytes
+        size_t from             : First position to check
+        size_t to               : End of the positions to check
+        rabin_poly mask         : Bits that have to be zero
+Output:
+        size_t                  : Position of the candidate, to if none
+*/
+size_t
+chunk_scan(const struct rabin_config *config, const unsigned char *data,
+        size_t from, size_t to, rabin_poly mask)
+{
+
+        pthread_once(&scan_once, scan_select);
+        return scan_kernel(config, data, from, to, mask);
+
+}
@@ -0,0 +1,46 @@
+#ifndef __CHUNK_SCAN_H__
+#define __CHUNK_SCAN_H__
+
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<stdint.h>
+#include "Rabin_Karp.h"
+
+/* Positions of one lane the vector kernel checks between two looks at the
+ * hit mask, the lane loads its bytes 8 at a time */
+#define SCAN_GROUP              8
+/* Longest segment a lane scans before the lanes are re-split */
+#define SCAN_LANE_MAX           (2048 + 1)
+/* Fingerprints computed side by side by the AVX2 kernel, two registers of
+ * four */
+#define SCAN_LANES              8
+
+enum scan_kernel {SCAN_AUTO, SCAN_SCALAR, SCAN_AVX2};
+
+/*@description:Function to select the boundary scan kernel. SCAN_AUTO picks
+the fastest one the CPU supports.
+@in: int kernel-scan_kernel
+@out: int
+@return: -1 if the CPU does not support the kernel and 0 otherwise */
+int chunk_scan_set_kernel(int kernel);
+
+/*@description:Function to get the name of the selected scan kernel
+@in: void
+@out: const char *
+@return: name of the kernel */
+const char *chunk_scan_kernel_name(void);
+
+/*@description:Function to find the first chunk boundary candidate. The
+fingerprint at position i covers data[i - window + 1 .. i], so every kernel
+returns the same position whatever order it computes them in.
+@in: struct rabin_config *config-window and tables, unsigned char *data-chunk
+bytes, size_t from-first position to check, at least window - 1, size_t to-
+end of the positions to check, rabin_poly mask-bits that have to be zero
+@out: size_t
+@return: first position in [from, to) whose fingerprint has no bit of mask
+set, to if there is none */
+size_t chunk_scan(const struct rabin_config *config, const unsigned char *data,
+        size_t from, size_t to, rabin_poly mask);
+
+#endif
@@ -0,0 +1,137 @@
+#include "chunk_scan.h"
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define BENCH_SIZE      (64 << 20)
+#define BENCH_ROUNDS    5
+
+/*Function to read the time stamp counter.
+Input:
+        None
+Output:
+        uint64_t                : Cycles, 0 where there is no counter
+*/
+static uint64_t
+read_cycles(void)
+{
+
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return 0;
+#endif
+
+}
+
+/*Function to cut the buffer into chunks the way chunker_next() does,
+ mask_s up to avg_size, mask_l up to max_size.
+Input:
+        struct rabin_config *config : Parameters, masks and lookup tables
+        unsigned char *data     : Bytes to chunk
+        size_t size             : Number of bytes
+        size_t *count           : Pointer to return number of chunks
+Output:
+        uint64_t                : Sum of the chunk end positions
+*/
+static uint64_t
+scan_all(const struct rabin_config *config, const unsigned char *data,
+        size_t size, size_t *count)
+{
+
+        size_t          start   =       0;
+        size_t          from    =       0;
+        size_t          avg     =       0;
+        size_t          end     =       0;
+        size_t          pos     =       0;
+        uint64_t        sum     =       0;
+
+        *count = 0;
+        while (start + config->params.max_size <= size) {
+                from = start + config->params.min_size - 1;
+                avg = start + config->params.avg_size - 1;
+                end = start + config->params.max_size - 1;
+                pos = chunk_scan(config, data, from, avg, config->mask_s);
+                if (pos == avg)
+                        pos = chunk_scan(config, data, avg, end,
+                                config->mask_l);
+                start = pos + 1;
+                sum += start;
+                (*count)++;
+        }
+        return sum;
+
+}
+
+/*Microbenchmark of the chunk boundary scan kernels. Every kernel the CPU
+ supports scans the same random buffer, the boundaries have to match the
+ scalar kernel.*/
+int
+main (int argc, char *argv[])
+{
+
+        int             ret             =       -1;
+        int             kernel          =       0;
+        int             round           =       0;
+        size_t          i               =       0;
+        size_t          count           =       0;
+        size_t          ref_count       =       0;
+        uint64_t        sum             =       0;
+        uint64_t        ref_sum         =       0;
+        uint64_t        cycles          =       0;
+        uint64_t        best            =       0;
+        double          secs            =       0;
+        double          best_secs       =       0;
+        unsigned char   *data           =       NULL;
+        struct timespec t0, t1;
+        struct rabin_config config;
+        const int       kernels[]       =       {SCAN_SCALAR, SCAN_AVX2};
+
+        if (init_rabin_config(&config, NULL) == -1)
+                goto out;
+        data = (unsigned char *)malloc(BENCH_SIZE);
+        if (data == NULL) {
+                fprintf(stderr, "Error in buffer allocation\n");
+                goto out;
+        }
+        srandom(argc > 1 ? atoi(argv[1]) : 1);
+        for (i = 0; i < BENCH_SIZE; i++)
+                data[i] = random();
+        for (kernel = 0; kernel < 2; kernel++) {
+                if (chunk_scan_set_kernel(kernels[kernel]) == -1)
+                        continue;
+                best = 0;
+                best_secs = 0;
+                for (round = 0; round < BENCH_ROUNDS; round++) {
+                        clock_gettime(CLOCK_MONOTONIC, &t0);
+                        cycles = read_cycles();
+                        sum = scan_all(&config, data, BENCH_SIZE, &count);
+                        cycles = read_cycles() - cycles;
+                        clock_gettime(CLOCK_MONOTONIC, &t1);
+                        secs = (t1.tv_sec - t0.tv_sec) +
+                                (t1.tv_nsec - t0.tv_nsec) / 1e9;
+                        if (best_secs == 0 || secs < best_secs) {
+                                best = cycles;
+                                best_secs = secs;
+                        }
+                }
+                if (kernels[kernel] == SCAN_SCALAR) {
+                        ref_sum = sum;
+                        ref_count = count;
+                } else if (sum != ref_sum || count != ref_count) {
+                        fprintf(stderr, "%s: boundaries differ from scalar\n",
+                                chunk_scan_kernel_name());
+                        goto out;
+                }
+                printf("%-8s %8zu chunks %6.3f bytes/cycle %8.1f MB/s\n",
+                        chunk_scan_kernel_name(), count,
+                        best ? (double)BENCH_SIZE / best : 0,
+                        BENCH_SIZE / best_secs / (1 << 20));
+        }
+        ret = 0;
+out:
+        free(data);
+        return ret ? 1 : 0;
+
+}
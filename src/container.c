@@ -0,0 +1,610 @@
+#include "container.h"
+#include "clean_buff.h"
+#include "vector.h"
+
+/* Locality cache slot, holds the sorted fingerprints of one container */
+struct container_cache_slot
+{
+        uint64_t id;
+        uint32_t nr_chunks;
+        DIGEST *digests;
+        unsigned long used;
+};
+
+static char container_path[1024];
+static int digest_len;
+static int (*index_chunk)(DIGEST *, uint64_t);
+
+/* Id after the last one handed out, kept in CONTAINER_NEXT_ID so that the
+ * id of a container lost before it was sealed is never used again */
+static int fd_next = -1;
+static uint64_t next_id;
+
+/* Container being filled, it is written out when sealed. Its fingerprints
+ * are found through open_slots until then, they are not in the index. */
+static uint64_t open_id;
+static char *data;
+static size_t data_size;
+static size_t data_alloc;
+static DIGEST *meta;
+static uint32_t nr_chunks;
+static uint32_t meta_alloc;
+static uint32_t *open_slots;
+static uint32_t nr_slots;
+
+/* Container restores read from, chunks of a file mostly share containers.
+ * Every restore thread keeps its own. */
+static __thread int read_fd = -1;
+static __thread uint64_t read_id;
+
+static struct container_cache_slot cache[CONTAINER_CACHE_SLOTS];
+static unsigned long cache_clock;
+
+static int
+digest_compare(const void *a, const void *b)
+{
+
+        return memcmp(a, b, digest_len);
+
+}
+
+/*Function to find the slot of a fingerprint in the open container.
+Input:DIGEST *digest
+Output:uint32_t* - slot holding the chunk index + 1, or the empty slot
+*/
+static uint32_t *
+open_slot(DIGEST *digest)
+{
+
+        uint32_t        slot    =       0;
+        uint64_t        key     =       0;
+        size_t          record  =       digest_len + sizeof(uint32_t);
+
+        memcpy(&key, digest, sizeof(key));
+        slot = key & (nr_slots - 1);
+        while (open_slots[slot] != 0 && memcmp(meta + (size_t)
+                (open_slots[slot] - 1) * record, digest, digest_len) != 0)
+                slot = (slot + 1) & (nr_slots - 1);
+        return &open_slots[slot];
+
+}
+
+/*Function to make room in open_slots for one more chunk, the table is kept
+at most half full.
+Input:void
+Output:int
+*/
+static int
+grow_open_slots()
+{
+
+        uint32_t        index   =       0;
+        uint32_t        *tmp    =       NULL;
+
+        if ((nr_chunks + 1) * 2 <= nr_slots)
+                return 0;
+        tmp = (uint32_t *)calloc(nr_slots ? nr_slots * 2 : 2048,
+                sizeof(uint32_t));
+        if (tmp == NULL) {
+                fprintf(stderr, "Error in container allocation\n");
+                return -1;
+        }
+        free(open_slots);
+        open_slots = tmp;
+        nr_slots = nr_slots ? nr_slots * 2 : 2048;
+        for (index = 0; index < nr_chunks; index++)
+                *open_slot(meta + (size_t)index * (digest_len +
+                        sizeof(uint32_t))) = index + 1;
+        return 0;
+
+}
+
+/*Function to reserve the id of the open container before its first chunk
+is handed out.
+Input:void
+Output:int
+*/
+static int
+reserve_container_id()
+{
+
+        if (open_id < next_id)
+                return 0;
+        next_id = open_id + 1;
+        if (pwrite(fd_next, &next_id, sizeof(next_id), 0) !=
+                sizeof(next_id) || fdatasync(fd_next) == -1) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                return -1;
+        }
+        return 0;
+
+}
+
+/*Function to write the open container to its file and start a new one.
+The fingerprints of the container go to the index once the file is synced.
+Input:void
+Output:int
+*/
+static int
+seal_container()
+{
+
+        int ret         =       -1;
+        int fd          =       -1;
+        uint32_t index  =        0;
+        uint32_t offset =        0;
+        size_t record   =       digest_len + sizeof(uint32_t);
+        char filename[1024];
+        struct container_header header;
+
+        if (nr_chunks == 0)
+                return 0;
+        sprintf(filename, "%s/%lu.ctr", container_path,
+                (unsigned long)open_id);
+        fd = open(filename, O_CREAT|O_WRONLY|O_TRUNC, S_IRUSR|S_IWUSR);
+        if (fd == -1) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                goto out;
+        }
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, CONTAINER_MAGIC, MAGIC_LEN);
+        header.version = STORE_FORMAT_VERSION;
+        header.digest_len = digest_len;
+        header.nr_chunks = nr_chunks;
+        header.id = open_id;
+        header.data_size = data_size;
+        if (write(fd, &header, sizeof(header)) != sizeof(header) ||
+                write(fd, data, data_size) != (ssize_t)data_size ||
+                write(fd, meta, (size_t)nr_chunks * (digest_len +
+                sizeof(uint32_t))) != (ssize_t)((size_t)nr_chunks *
+                (digest_len + sizeof(uint32_t)))) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                goto out;
+        }
+        if (fsync(fd) == -1) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                goto out;
+        }
+        for (index = 0; index < nr_chunks; index++) {
+                memcpy(&offset, meta + (size_t)index * record + digest_len,
+                        sizeof(offset));
+                ret = index_chunk(meta + (size_t)index * record,
+                        open_id * CONTAINER_SIZE + offset);
+                if (ret == -1)
+                        goto out;
+        }
+        open_id++;
+        data_size = 0;
+        nr_chunks = 0;
+        memset(open_slots, 0, (size_t)nr_slots * sizeof(uint32_t));
+        ret = 0;
+out:
+        if (fd != -1)
+                close(fd);
+        return ret;
+
+}
+
+/*Function to create the container store. New containers are numbered after
+the highest id ever handed out.
+Input:char *path,int length,int (*index)(DIGEST *, uint64_t)
+Output:int
+*/
+int
+init_container_store(char *path, int length,
+        int (*index)(DIGEST *, uint64_t))
+{
+
+        int ret         =       -1;
+        uint64_t id     =        0;
+        DIR *dp         =       NULL;
+        struct dirent *entry = NULL;
+        char filename[1024];
+
+        sprintf(container_path, "%s/containers", path);
+        dp = opendir(container_path);
+        if (NULL == dp) {
+                ret = mkdir(container_path, 0777);
+                if (ret < 0) {
+                        fprintf(stderr, "%s\n", strerror(errno));
+                        goto out;
+                }
+                dp = opendir(container_path);
+                if (NULL == dp) {
+                        fprintf(stderr, "%s\n", strerror(errno));
+                        ret = -1;
+                        goto out;
+                }
+        }
+        digest_len = length;
+        index_chunk = index;
+        open_id = 0;
+        while ((entry = readdir(dp)) != NULL) {
+                if (strstr(entry->d_name, ".ctr") == NULL)
+                        continue;
+                id = strtoull(entry->d_name, NULL, 10);
+                if (id >= open_id)
+                        open_id = id + 1;
+        }
+        sprintf(filename, "%s/%s", container_path, CONTAINER_NEXT_ID);
+        fd_next = open(filename, O_CREAT|O_RDWR, S_IRUSR|S_IWUSR);
+        if (fd_next == -1) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                ret = -1;
+                goto out;
+        }
+        next_id = 0;
+        if (pread(fd_next, &next_id, sizeof(next_id), 0) != sizeof(next_id))
+                next_id = 0;
+        if (next_id > open_id)
+                open_id = next_id;
+        data_size = 0;
+        nr_chunks = 0;
+        ret = 0;
+out:
+        if (dp != NULL)
+                closedir(dp);
+        return ret;
+
+}
+
+/*Function to append a chunk to the open container.
+Input:vector_ptr list,size_t length,DIGEST *digest
+Output:uint64_t *location
+*/
+int
+insert_block_to_container(vector_ptr list, size_t length, DIGEST *digest,
+uint64_t *location)
+{
+
+        int ret                 =       -1;
+        uint32_t offset         =        0;
+        uint32_t block_length   =        0;
+        size_t need             =        0;
+        char *tmp               =       NULL;
+        int i                   =        0;
+
+        if (length <= 0 || list == NULL)
+                goto out;
+        need = CONTAINER_RECORD_HEADER + length;
+        if (data_size > 0 && data_size + need > CONTAINER_SIZE) {
+                ret = seal_container();
+                if (ret == -1)
+                        goto out;
+        }
+        ret = reserve_container_id();
+        if (ret == -1)
+                goto out;
+        ret = grow_open_slots();
+        if (ret == -1)
+                goto out;
+        ret = -1;
+        /* A chunk larger than a container gets a container of its own */
+        if (data_size + need > data_alloc) {
+                tmp = realloc(data, data_size + need > CONTAINER_SIZE ?
+                        data_size + need : CONTAINER_SIZE);
+                if (tmp == NULL) {
+                        fprintf(stderr, "Error in container allocation\n");
+                        ret = -1;
+                        goto out;
+                }
+                data = tmp;
+                data_alloc = data_size + need > CONTAINER_SIZE ?
+                        data_size + need : CONTAINER_SIZE;
+        }
+        if (nr_chunks == meta_alloc) {
+                tmp = realloc(meta, (size_t)(meta_alloc ? meta_alloc * 2 :
+                        1024) * (digest_len + sizeof(uint32_t)));
+                if (tmp == NULL) {
+                        fprintf(stderr, "Error in container allocation\n");
+                        ret = -1;
+                        goto out;
+                }
+                meta = (DIGEST *)tmp;
+                meta_alloc = meta_alloc ? meta_alloc * 2 : 1024;
+        }
+        offset = data_size;
+        block_length = length;
+        memcpy(data + data_size, &block_length, CONTAINER_RECORD_HEADER);
+        data_size += CONTAINER_RECORD_HEADER;
+        for (i = 0; i < list->count; i++) {
+                memcpy(data + data_size, list->iov[i].iov_base,
+                        list->iov[i].iov_len);
+                data_size += list->iov[i].iov_len;
+        }
+        memcpy(meta + (size_t)nr_chunks * (digest_len + sizeof(uint32_t)),
+                digest, digest_len);
+        memcpy(meta + (size_t)nr_chunks * (digest_len + sizeof(uint32_t)) +
+                digest_len, &offset, sizeof(offset));
+        *open_slot(digest) = nr_chunks + 1;
+        nr_chunks++;
+        *location = open_id * CONTAINER_SIZE + offset;
+        ret = 0;
+out:
+        return ret;
+
+}
+
+/*Function to check the open container and the locality cache for a
+fingerprint.
+Input:DIGEST *digest
+Output:int
+*/
+int
+container_cache_lookup(DIGEST *digest)
+{
+
+        int ret         =       1;
+        int slot        =       0;
+
+        if (nr_chunks > 0 && *open_slot(digest) != 0)
+                return 0;
+        for (slot = 0; slot < CONTAINER_CACHE_SLOTS; slot++) {
+                if (cache[slot].digests == NULL)
+                        continue;
+                if (bsearch(digest, cache[slot].digests, cache[slot].nr_chunks,
+                        digest_len, digest_compare) != NULL) {
+                        cache[slot].used = ++cache_clock;
+                        ret = 0;
+                        break;
+                }
+        }
+        return ret;
+
+}
+
+/*Function to load the metadata section of the container holding a location
+into the least recently used slot of the locality cache, so that the
+chunks written after it in the original stream are found without asking
+the index.
+Input:uint64_t location
+Output:int
+*/
+int
+container_prefetch(uint64_t location)
+{
+
+        int ret         =       -1;
+        int fd          =       -1;
+        int slot        =        0;
+        int victim      =        0;
+        uint32_t index  =        0;
+        size_t record   =        0;
+        uint64_t id     =       location / CONTAINER_SIZE;
+        DIGEST *buf     =       NULL;
+        DIGEST *digests =       NULL;
+        char filename[1024];
+        struct container_header header;
+
+        /* Fingerprints of the open container are found in open_slots */
+        if (id == open_id)
+                return 0;
+        for (slot = 0; slot < CONTAINER_CACHE_SLOTS; slot++) {
+                if (cache[slot].digests != NULL && cache[slot].id == id) {
+                        cache[slot].used = ++cache_clock;
+                        return 0;
+                }
+                if (cache[slot].used < cache[victim].used)
+                        victim = slot;
+        }
+        sprintf(filename, "%s/%lu.ctr", container_path, (unsigned long)id);
+        fd = open(filename, O_RDONLY);
+        if (fd == -1) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                goto out;
+        }
+        if (pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+                memcmp(header.magic, CONTAINER_MAGIC, MAGIC_LEN) != 0 ||
+                header.digest_len != (uint32_t)digest_len) {
+                fprintf(stderr, "Invalid container %s\n", filename);
+                goto out;
+        }
+        record = digest_len + sizeof(uint32_t);
+        buf = (DIGEST *)malloc(header.nr_chunks * record);
+        digests = (DIGEST *)malloc(header.nr_chunks * digest_len);
+        if (buf == NULL || digests == NULL) {
+                fprintf(stderr, "Error in container allocation\n");
+                goto out;
+        }
+        if (pread(fd, buf, header.nr_chunks * record, sizeof(header) +
+                header.data_size) != (ssize_t)(header.nr_chunks * record)) {
+                fprintf(stderr, "Invalid container %s\n", filename);
+                goto out;
+        }
+        for (index = 0; index < header.nr_chunks; index++)
+                memcpy(digests + index * digest_len, buf + index * record,
+                        digest_len);
+        qsort(digests, header.nr_chunks, digest_len, digest_compare);
+        free(cache[victim].digests);
+        cache[victim].id = id;
+        cache[victim].nr_chunks = header.nr_chunks;
+        cache[victim].digests = digests;
+        cache[victim].used = ++cache_clock;
+        digests = NULL;
+        ret = 0;
+out:
+        if (fd != -1)
+                close(fd);
+        free(buf);
+        free(digests);
+        return ret;
+
+}
+
+/*Function to open a container for reading, the container read last stays
+open.
+Input:uint64_t id
+Output:int
+*/
+static int
+open_reader(uint64_t id)
+{
+
+        char filename[1024];
+
+        if (read_fd != -1 && read_id == id)
+                return 0;
+        if (read_fd != -1)
+                close(read_fd);
+        sprintf(filename, "%s/%lu.ctr", container_path, (unsigned long)id);
+        read_fd = open(filename, O_RDONLY);
+        if (read_fd == -1) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                return -1;
+        }
+        read_id = id;
+        return 0;
+
+}
+
+/*Function to read bytes of the data section of a container.
+Input:uint64_t id,uint64_t offset,char *buffer,size_t length
+Output:int
+*/
+int
+read_container_region(uint64_t id, uint64_t offset, char *buffer,
+        size_t length)
+{
+
+        if (id == open_id && nr_chunks > 0) {
+                if (offset + length > data_size) {
+                        fprintf(stderr, "Error while reading container\n");
+                        return -1;
+                }
+                memcpy(buffer, data + offset, length);
+                return 0;
+        }
+        if (open_reader(id) == -1)
+                return -1;
+        if (pread(read_fd, buffer, length, offset +
+                sizeof(struct container_header)) != (ssize_t)length) {
+                fprintf(stderr, "Error while reading container\n");
+                return -1;
+        }
+        return 0;
+
+}
+
+/*Function to copy bytes of the data section of a container into a file in
+the kernel.
+Input:uint64_t id,uint64_t offset,int fd_out,uint64_t out_offset,
+size_t length
+Output:int
+*/
+int
+copy_container_region(uint64_t id, uint64_t offset, int fd_out,
+        uint64_t out_offset, size_t length)
+{
+
+        if (id == open_id && nr_chunks > 0) {
+                if (offset + length > data_size ||
+                        pwrite(fd_out, data + offset, length, out_offset) !=
+                        (ssize_t)length) {
+                        fprintf(stderr, "Error while copying chunk\n");
+                        return -1;
+                }
+                return 0;
+        }
+        if (open_reader(id) == -1)
+                return -1;
+        return copy_file_region(read_fd, offset +
+                sizeof(struct container_header), fd_out, out_offset, length);
+
+}
+
+/*Function to get a chunk from the container store.
+Input:uint64_t location
+Output:int *length
+*/
+char *
+get_block_from_container(uint64_t location, int *length)
+{
+
+        int ret                 =       -1;
+        uint32_t block_length   =        0;
+        uint64_t id             =       location / CONTAINER_SIZE;
+        uint64_t offset         =       location % CONTAINER_SIZE;
+        char *buffer            =       NULL;
+
+        if (id == open_id && nr_chunks > 0) {
+                memcpy(&block_length, data + offset, CONTAINER_RECORD_HEADER);
+                buffer = (char *)calloc(1, block_length + 1);
+                if (buffer == NULL)
+                        goto out;
+                memcpy(buffer, data + offset + CONTAINER_RECORD_HEADER,
+                        block_length);
+                *length = block_length;
+                ret = 0;
+                goto out;
+        }
+        if (open_reader(id) == -1)
+                goto out;
+        offset += sizeof(struct container_header);
+        if (pread(read_fd, &block_length, CONTAINER_RECORD_HEADER, offset) !=
+                CONTAINER_RECORD_HEADER) {
+                fprintf(stderr, "Error while reading container\n");
+                goto out;
+        }
+        buffer = (char *)calloc(1, block_length + 1);
+        if (buffer == NULL)
+                goto out;
+        if (pread(read_fd, buffer, block_length, offset +
+                CONTAINER_RECORD_HEADER) != (ssize_t)block_length) {
+                fprintf(stderr, "Error while reading container\n");
+                goto out;
+        }
+        *length = block_length;
+        ret = 0;
+out:
+        if (ret == -1)
+                clean_buff(&buffer);
+        return buffer;
+
+}
+
+/*Function to seal the open container and close the store.
+Input:void
+Output:int
+*/
+int
+fini_container_store()
+{
+
+        int ret         =       -1;
+        int slot        =        0;
+
+        ret = seal_container();
+        clean_buff(&data);
+        clean_buff((char **)&meta);
+        clean_buff((char **)&open_slots);
+        data_alloc = 0;
+        meta_alloc = 0;
+        nr_slots = 0;
+        nr_chunks = 0;
+        data_size = 0;
+        if (fd_next != -1) {
+                close(fd_next);
+                fd_next = -1;
+        }
+        for (slot = 0; slot < CONTAINER_CACHE_SLOTS; slot++)
+                clean_buff((char **)&cache[slot].digests);
+        memset(cache, 0, sizeof(cache));
+        container_release_reader();
+        return ret;
+
+}
+
+/*Function to close the container the calling thread read last.
+Input:void
+Output:void
+*/
+void
+container_release_reader()
+{
+
+        if (read_fd != -1) {
+                close(read_fd);
+                read_fd = -1;
+        }
+
+}
@@ -0,0 +1,115 @@
+#ifndef __CONTAINER_H__
+#define __CONTAINER_H__
+
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<unistd.h>
+#include<dirent.h>
+#include<errno.h>
+#include<stdint.h>
+#include<sys/stat.h>
+#include<sys/types.h>
+#include<fcntl.h>
+#include "store_format.h"
+
+#define CONTAINER_MAGIC         "YDLC"
+#define CONTAINER_SIZE          (4 << 20)
+#define CONTAINER_CACHE_SLOTS   16
+#define CONTAINER_RECORD_HEADER sizeof(uint32_t)
+#define CONTAINER_NEXT_ID       "next_id"
+
+typedef struct vector *vector_ptr;
+
+typedef unsigned char DIGEST;
+
+/*Header of a container file. The data section follows it, chunks are kept
+in stream order as uint32_t length, payload. The metadata section follows
+the data section and holds one digest[digest_len] uint32_t offset record
+per chunk.
+A chunk is located by id * CONTAINER_SIZE + offset in the data section.
+*/
+struct container_header
+{
+        char magic[MAGIC_LEN];
+        uint32_t version;
+        uint32_t digest_len;
+        uint32_t nr_chunks;
+        uint64_t id;
+        uint64_t data_size;
+};
+
+/*@description:Function to create the container store. The fingerprints of
+a container are handed to index only once the container is sealed and
+synced, so the index never points into a container that is not on disk.
+@in: char *path-path of store_block, int digest_len-length of fingerprints,
+int (*index)(DIGEST *, uint64_t)-function to record the location of a
+fingerprint
+@out: int
+@return: -1 for error and 0 if created successfully */
+int init_container_store(char *path, int digest_len,
+        int (*index)(DIGEST *, uint64_t));
+
+/*@description:Function to append a chunk to the open container, the
+container is sealed once it is full
+@in: vector_ptr list-chunk, size_t length-size of chunk, DIGEST *digest-
+fingerprint of chunk
+@out: uint64_t *location-location of the chunk
+@return: -1 for error and 0 if inserted successfully */
+int insert_block_to_container(vector_ptr list, size_t length, DIGEST *digest,
+        uint64_t *location);
+
+/*@description:Function to check the open container and the locality cache
+for a fingerprint
+@in: DIGEST *digest-fingerprint of chunk
+@out: int
+@return: 0 if the fingerprint is found and 1 otherwise */
+int container_cache_lookup(DIGEST *digest);
+
+/*@description:Function to load the fingerprints of the container holding a
+location into the locality cache
+@in: uint64_t location-location of a chunk
+@out: int
+@return: -1 for error and 0 otherwise */
+int container_prefetch(uint64_t location);
+
+/*@description:Function to get a chunk from the container store
+@in: uint64_t location-location of the chunk
+@out: int *length-size of chunk
+@return: NULL for error and chunk otherwise */
+char *get_block_from_container(uint64_t location, int *length);
+
+/*@description:Function to read bytes of the data section of a container in
+one go, the records of many chunks are read together this way
+@in: uint64_t id-container, uint64_t offset-offset in the data section,
+size_t length-bytes to read
+@out: char *buffer-bytes read
+@return: -1 for error and 0 on success */
+int read_container_region(uint64_t id, uint64_t offset, char *buffer,
+        size_t length);
+
+/*@description:Function to copy bytes of the data section of a container
+into a file without reading them into memory
+@in: uint64_t id-container, uint64_t offset-offset in the data section,
+int fd_out-file written, uint64_t out_offset-offset in fd_out,
+size_t length-bytes to copy
+@out: int
+@return: -1 for error and 0 on success */
+int copy_container_region(uint64_t id, uint64_t offset, int fd_out,
+        uint64_t out_offset, size_t length);
+
+/*@description:Function to close the container the calling thread read
+chunks from, every thread that called get_block_from_container calls it
+before it exits
+@in: void
+@out: void
+@return: void */
+void container_release_reader();
+
+/*@description:Function to seal the open container and close the store
+@in: void
+@out: int
+@return: -1 for error and 0 if closed successfully */
+int fini_container_store();
+
+#endif
@@ -0,0 +1,353 @@
+#include "convert.h"
+#include "store_format.h"
+#include "parsing.h"
+
+/*Function to check whether a store file still has to be converted.
+Input:char *filename,const char *magic
+Output:int - 1 if file is in old format, 0 if not, -1 on error
+*/
+static int
+needs_conversion(char *filename, const char *magic)
+{
+
+        int ret         =       -1;
+        int fd          =       -1;
+        char buffer[MAGIC_LEN];
+
+        fd = open(filename, O_RDONLY);
+        if (fd == -1) {
+                if (errno == ENOENT)
+                        ret = 0;
+                else
+                        fprintf(stderr, "%s\n", strerror(errno));
+                goto out;
+        }
+        ret = read(fd, buffer, MAGIC_LEN);
+        if (ret == -1) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                goto out;
+        }
+        if (ret == MAGIC_LEN && memcmp(buffer, magic, MAGIC_LEN) == 0)
+                ret = 0;
+        else
+                ret = 1;
+out:
+        if (fd != -1)
+                close(fd);
+        return ret;
+
+}
+
+/*Function to open the temporary file a store is converted into.
+Input:char *filename,char *temp_filename
+Output:FILE*
+*/
+static FILE *
+open_converted(char *filename, char *temp_filename)
+{
+
+        FILE *fp        =       NULL;
+
+        sprintf(temp_filename, "%s.convert", filename);
+        fp = fopen(temp_filename, "w");
+        if (fp == NULL)
+                fprintf(stderr, "%s: %s\n", temp_filename, strerror(errno));
+        return fp;
+
+}
+
+/*Function to write the header of a converted store.
+Input:FILE *fp,const char *magic,uint32_t digest_len,uint32_t store_type
+Output:int
+*/
+static int
+put_header(FILE *fp, const char *magic, uint32_t digest_len,
+uint32_t store_type)
+{
+
+        struct store_header header;
+
+        memset(&header, 0, STORE_HEADER_SIZE);
+        memcpy(header.magic, magic, MAGIC_LEN);
+        header.version = STORE_FORMAT_VERSION;
+        header.digest_len = digest_len;
+        header.store_type = store_type;
+        if (fwrite(&header, STORE_HEADER_SIZE, 1, fp) != 1)
+                return -1;
+        return 0;
+
+}
+
+/*Function to replace a store file with its converted copy.
+Input:FILE *fp,char *temp_filename,char *filename
+Output:int
+*/
+static int
+finish_converted(FILE *fp, char *temp_filename, char *filename)
+{
+
+        int ret         =       -1;
+
+        if (fclose(fp) != 0) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                goto out;
+        }
+        ret = rename(temp_filename, filename);
+        if (ret == -1) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                goto out;
+        }
+        printf("Converted %s\n", filename);
+out:
+        return ret;
+
+}
+
+/*Function to convert the block store. Block records keep their layout, the
+file only gains a header.
+Input:char *filename
+Output:int
+*/
+static int
+convert_block_store(char *filename)
+{
+
+        int ret                 =       -1;
+        size_t length           =        0;
+        char temp_filename[1024];
+        char buffer[65536];
+        FILE *in                =       NULL;
+        FILE *out_fp            =       NULL;
+
+        ret = needs_conversion(filename, BLOCK_STORE_MAGIC);
+        if (ret != 1)
+                goto out;
+        ret = -1;
+        in = fopen(filename, "r");
+        if (in == NULL) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                goto out;
+        }
+        out_fp = open_converted(filename, temp_filename);
+        if (out_fp == NULL)
+                goto out;
+        if (put_header(out_fp, BLOCK_STORE_MAGIC, 0, 0) == -1)
+                goto write_error;
+        while ((length = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+                if (fwrite(buffer, 1, length, out_fp) != length)
+                        goto write_error;
+        }
+        if (ferror(in)) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                goto out;
+        }
+        ret = finish_converted(out_fp, temp_filename, filename);
+        out_fp = NULL;
+        goto out;
+write_error:
+        fprintf(stderr, "%s\n", strerror(errno));
+out:
+        if (in != NULL)
+                fclose(in);
+        if (out_fp != NULL) {
+                fclose(out_fp);
+                remove(temp_filename);
+        }
+        return ret;
+
+}
+
+/*Function to convert the hash store to fixed width binary records whose
+offsets point to the start of the block record.
+Input:char *filename,int digest_len
+Output:int
+*/
+static int
+convert_hash_store(char *filename, int digest_len)
+{
+
+        int ret                 =       -1;
+        int length              =        0;
+        int position            =        0;
+        uint64_t offset         =        0;
+        char hash[MAX_DIGEST_LEN * 2 + 1];
+        DIGEST *digest          =       NULL;
+        char temp_filename[1024];
+        FILE *in                =       NULL;
+        FILE *out_fp            =       NULL;
+
+        ret = needs_conversion(filename, HASH_STORE_MAGIC);
+        if (ret != 1)
+                goto out;
+        ret = -1;
+        in = fopen(filename, "r");
+        if (in == NULL) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                goto out;
+        }
+        out_fp = open_converted(filename, temp_filename);
+        if (out_fp == NULL)
+                goto out;
+        if (put_header(out_fp, HASH_STORE_MAGIC, digest_len, 0) == -1)
+                goto write_error;
+        while (fread(&length, OLD_INT_SIZE, 1, in) == 1) {
+                if (length != digest_len * 2 ||
+                        fread(hash, 1, length, in) != length ||
+                        fread(&position, OLD_INT_SIZE, 1, in) != 1) {
+                        fprintf(stderr, "%s: unexpected record\n", filename);
+                        goto out;
+                }
+                hash[length] = '\0';
+                digest = unparse(hash, digest_len);
+                offset = position - OLD_POSITION_BIAS + STORE_HEADER_SIZE;
+                if (fwrite(digest, 1, digest_len, out_fp) != digest_len ||
+                        fwrite(&offset, sizeof(offset), 1, out_fp) != 1)
+                        goto write_error;
+                free(digest);
+                digest = NULL;
+        }
+        ret = finish_converted(out_fp, temp_filename, filename);
+        out_fp = NULL;
+        goto out;
+write_error:
+        fprintf(stderr, "%s\n", strerror(errno));
+out:
+        free(digest);
+        if (in != NULL)
+                fclose(in);
+        if (out_fp != NULL) {
+                fclose(out_fp);
+                remove(temp_filename);
+        }
+        return ret;
+
+}
+
+/*Function to convert a stub to fixed width binary records. Stubs written by
+min hash dedup share the directory but have another layout, they are
+recognised by their first record and skipped.
+Input:char *filename,int digest_len
+Output:int
+*/
+static int
+convert_stub(char *filename, int digest_len)
+{
+
+        int ret                 =       -1;
+        int store_type          =       -1;
+        int length              =        0;
+        int b_offset            =        0;
+        int e_offset            =        0;
+        uint64_t offset         =        0;
+        char hash[MAX_DIGEST_LEN * 2 + 1];
+        DIGEST *digest          =       NULL;
+        char temp_filename[1024];
+        FILE *in                =       NULL;
+        FILE *out_fp            =       NULL;
+
+        ret = needs_conversion(filename, STUB_STORE_MAGIC);
+        if (ret != 1)
+                goto out;
+        ret = -1;
+        in = fopen(filename, "r");
+        if (in == NULL) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                goto out;
+        }
+        if (fread(&store_type, OLD_INT_SIZE, 1, in) != 1 ||
+                (store_type != 0 && store_type != 1) ||
+                fread(&length, OLD_INT_SIZE, 1, in) != 1 ||
+                length != digest_len * 2) {
+                printf("Skipping %s: not a dedup stub\n", filename);
+                ret = 0;
+                goto out;
+        }
+        out_fp = open_converted(filename, temp_filename);
+        if (out_fp == NULL)
+                goto out;
+        if (put_header(out_fp, STUB_STORE_MAGIC, digest_len, store_type) == -1)
+                goto write_error;
+        do {
+                if (length != digest_len * 2 ||
+                        fread(hash, 1, length, in) != length ||
+                        fread(&b_offset, OLD_INT_SIZE, 1, in) != 1 ||
+                        fread(&e_offset, OLD_INT_SIZE, 1, in) != 1) {
+                        fprintf(stderr, "%s: unexpected record\n", filename);
+                        goto out;
+                }
+                hash[length] = '\0';
+                digest = unparse(hash, digest_len);
+                if (fwrite(digest, 1, digest_len, out_fp) != digest_len)
+                        goto write_error;
+                offset = (uint32_t)b_offset;
+                if (fwrite(&offset, sizeof(offset), 1, out_fp) != 1)
+                        goto write_error;
+                offset = (uint32_t)e_offset;
+                if (fwrite(&offset, sizeof(offset), 1, out_fp) != 1)
+                        goto write_error;
+                free(digest);
+                digest = NULL;
+        } while (fread(&length, OLD_INT_SIZE, 1, in) == 1);
+        ret = finish_converted(out_fp, temp_filename, filename);
+        out_fp = NULL;
+        goto out;
+write_error:
+        fprintf(stderr, "%s\n", strerror(errno));
+out:
+        free(digest);
+        if (in != NULL)
+                fclose(in);
+        if (out_fp != NULL) {
+                fclose(out_fp);
+                remove(temp_filename);
+        }
+        return ret;
+
+}
+
+/*Function to upgrade all stores of a namespace to the versioned format.
+Input:char *store_path,int digest_len
+Output:int
+*/
+int
+convert_store(char *store_path, int digest_len)
+{
+
+        int ret                 =       -1;
+        DIR *dp                 =       NULL;
+        struct dirent *dir;
+        char filename[1024];
+
+        if (store_path == NULL || digest_len <= 0) {
+                printf("Invalid namespace\n");
+                goto out;
+        }
+        sprintf(filename, "%s/store_block/blocks/blockstore.txt", store_path);
+        ret = convert_block_store(filename);
+        if (ret == -1)
+                goto out;
+        sprintf(filename, "%s/store_block/hashs/filehashDedup.txt", store_path);
+        ret = convert_hash_store(filename, digest_len);
+        if (ret == -1)
+                goto out;
+        sprintf(filename, "%s/store_block/stubs", store_path);
+        dp = opendir(filename);
+        if (dp != NULL) {
+                while ((dir = readdir(dp)) != NULL) {
+                        if (strncmp(dir->d_name, "Stub_", 5) != 0 ||
+                                strstr(dir->d_name, ".convert") != NULL)
+                                continue;
+                        sprintf(filename, "%s/store_block/stubs/%s",
+                                store_path, dir->d_name);
+                        ret = convert_stub(filename, digest_len);
+                        if (ret == -1)
+                                goto out;
+                }
+        }
+        ret = 0;
+out:
+        if (dp != NULL)
+                closedir(dp);
+        return ret;
+
+}
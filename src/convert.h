@@ -0,0 +1,29 @@
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<unistd.h>
+#include<dirent.h>
+#include<errno.h>
+#include<stdint.h>
+#include<sys/stat.h>
+#include<sys/types.h>
+#include<fcntl.h>
+
+/*Layout of the stores written before the versioned format:
+        hash store  : int length, hex hash, int position
+        block store : int length, payload
+        stub        : int store_type, then int length, hex hash,
+                      int b_offset, int e_offset
+A position in the old hash store points one byte past the length of the
+block record.*/
+#define OLD_INT_SIZE sizeof(int)
+#define OLD_POSITION_BIAS (OLD_INT_SIZE + 1)
+
+/*@description:Function to upgrade the hash store, block store and stubs of a
+namespace to the versioned binary format. Stores already in the new format
+are left untouched.
+@in: char *store_path-store path of namespace, int digest_len-length of
+fingerprints of the namespace hash type
+@out: int
+@return: -1 for error and 0 if converted successfully */
+int convert_store(char *store_path, int digest_len);
@@ -7,52 +7,172 @@
 #include "namespace.h"
 #include "stub.h"
 #include "parsing.h"
+#include "filter.h"
+#include "container.h"
+#include "pack.h"
+#include "pipeline.h"
 
 #define NAME_SIZE 100
 
+/*State of the store stage of one file.
+        nr_chunks    : Chunks stored
+        bytes        : Bytes of the chunks stored
+        unique_bytes : Bytes of the chunks that were new to the store
+        mark         : Start of the per chunk scratch memory in arena
+*/
+struct dedup_session
+{
+        struct stub_writer *stub;
+        int             store_type;
+        char            *store_path;
+        FILE            *fp;
+        struct arena    *arena;
+        struct arena_mark mark;
+        uint64_t        nr_chunks;
+        uint64_t        bytes;
+        uint64_t        unique_bytes;
+};
+
 /*
-Function to dedup a file whose path is specified by the user.
-Input:char* filename,int chunk_type,int hash_type,int block_size
+Function to store a hashed chunk, called by the pipeline in file order.
+The scratch memory of the previous chunk goes back to the arena.
+Input:void *arg,vector_ptr chunk,uint64_t offset,DIGEST *digest,
+int h_length
+Output:int
+*/
+static int
+store_chunk(void *arg, vector_ptr chunk, uint64_t offset, DIGEST *digest,
+int h_length)
+{
+
+        struct dedup_session *session   =       (struct dedup_session *)arg;
+        int ret                         =       -1;
+
+        arena_release(session->arena, &session->mark);
+        ret = chunk_store(chunk, digest, chunk->length, h_length, offset,
+                offset + chunk->length - 1, session->stub,
+                session->store_type, session->store_path, session->arena);
+        if (ret == -1)
+                goto out;
+        if (ret == 1)
+                session->unique_bytes += chunk->length;
+        if (session->fp != NULL)
+                fprintf(session->fp, "%d\n", (int)chunk->length);
+        session->nr_chunks++;
+        session->bytes += chunk->length;
+        ret = 0;
+out:
+        return ret;
+
+}
+
+/*
+Function to fingerprint a whole file with the hash of the namespace and
+record its size and modification time. The file is mapped and hashed as a
+single piece.
+Input:const struct hash_provider *hash,int fd,struct stat *st
+Output:struct file_info *info
+*/
+static int
+whole_file_digest(const struct hash_provider *hash, int fd, struct stat *st,
+struct file_info *info)
+{
+
+        int ret                 =       -1;
+        void *data              =       MAP_FAILED;
+        struct vector list;
+
+        vector_init(&list);
+        memset(info, 0, sizeof(*info));
+        info->size = st->st_size;
+        info->mtime_sec = st->st_mtim.tv_sec;
+        info->mtime_nsec = st->st_mtim.tv_nsec;
+        info->digest_len = hash->digest_len;
+        if (st->st_size > 0) {
+                data = mmap(NULL, st->st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (data == MAP_FAILED) {
+                        fprintf(stderr, "%s\n", strerror(errno));
+                        goto out;
+                }
+                madvise(data, st->st_size, MADV_SEQUENTIAL);
+                ret = vector_append(&list, data, st->st_size);
+                if (ret == -1)
+                        goto out;
+        }
+        if (hash->digest(&list, info->digest) == NULL) {
+                ret = -1;
+                goto out;
+        }
+        ret = 0;
+out:
+        if (data != MAP_FAILED)
+                munmap(data, st->st_size);
+        vector_free(&list);
+        return ret;
+
+}
+
+/*
+Function to dedup a file whose path is specified by the user. A regular
+file is fingerprinted whole first. A file whose size and modification time
+did not change since it was deduped is skipped, a file identical to one
+deduped before gets a copy of its stub without chunking. A file is
+cataloged under its absolute path however it was named.
+Input:char* filename,int chunk_type,int hash_type,int block_size,
+char *name - catalog key of the file, NULL for its path
 Output:int
 */
 int
-dedup_file (namespace_dtl namespace_input, char *file_path)
+dedup_file (namespace_dtl namespace_input, char *file_path, char *name)
 {
 
         char *filename          =       NULL;
+        char *key               =       NULL;
         int chunk_type          =       0;
-        int hash_type           =       0;
+        const struct hash_provider *hash =      NULL;
         int block_size          =       0;
         int store_type          =       0;
         int ret                 =       -1;
         int fd_input            =       -1;
         int fd_stub             =       -1;
-        int length              =       0;
-        int h_length            =       0;
-        int b_offset            =       0;
-        int e_offset            =       0;
-        int size                =       0;
-        int chunk_flag          =       0;
-        int chunk_length        =       0;
+        int cataloged           =        0;
+        int whole               =        0;
         char confirm             =      -1;
-        char *hash              =       NULL;
         char *ts1               =       NULL;
         char *filename1         =       NULL;
-        char *buffer            =       NULL;
-        char *chunk_buffer      =       NULL;
         FILE *fp                =       NULL;
+        char twin[NAME_MAX + 1];
+        char real_path[PATH_MAX + 1];
         struct stat st;
-        vector_ptr list         =       NULL;
+        struct file_info info;
+        struct file_info twin_info;
+        struct catalog_entry entry;
+        struct chunk_params params;
+        struct chunker *chunker =       NULL;
+        struct dedup_session session;
+        struct stub_writer stub;
+        struct arena arena;
 
-        if (strcmp(namespace_input.hash_type, "md5") == 0)
-                hash_type = 0;
-        else
-                hash_type = 1;
+        memset(&session, 0, sizeof(session));
+        memset(&entry, 0, sizeof(entry));
+        memset(&stub, 0, sizeof(stub));
+        arena_init(&arena, 0);
+        hash = get_hash_provider(namespace_input.hash_type);
+        if (hash == NULL) {
+                fprintf(stderr, "Unknown hash type %s\n",
+                        namespace_input.hash_type);
+                goto out;
+        }
 
         if (strcmp(namespace_input.store_type, "default") == 0)
-                store_type = 0;
+                store_type = STORE_TYPE_DEFAULT;
+        else if (strcmp(namespace_input.store_type, "container") == 0)
+                store_type = STORE_TYPE_CONTAINER;
+        else if (namespace_input.object_layout != NULL &&
+                strcmp(namespace_input.object_layout, "pack") == 0)
+                store_type = STORE_TYPE_PACK;
         else
-                store_type = 1;
+                store_type = STORE_TYPE_OBJECT;
 
         if (strcmp(namespace_input.chunk_scheme, "fixed") == 0) {
                 chunk_type = 0;
@@ -63,18 +183,61 @@ dedup_file (namespace_dtl namespace_input, char *file_path)
         }
 
         filename = file_path;
-        ts1 = strdup(filename);
+        ts1 = arena_strdup(&arena, name != NULL ? name : filename);
+        if (ts1 == NULL)
+                goto out;
         filename1 = basename(ts1);
-        fd_input = open(filename, O_RDONLY, S_IRUSR|S_IWUSR);
-        if (fd_input < 1) {
+        /* Stdin is chunked as it arrives, its length is never needed */
+        if (strcmp(filename, STREAM_PATH) == 0) {
+                fd_input = STDIN_FILENO;
+        } else {
+                fd_input = open(filename, O_RDONLY, S_IRUSR|S_IWUSR);
+                if (fd_input < 1) {
+                        fprintf(stderr, "%s\n", strerror(errno));
+                        goto out;
+                }
+        }
+        if (name != NULL) {
+                key = name;
+        } else {
+                key = realpath(filename, real_path);
+                if (key == NULL) {
+                        fprintf(stderr, "%s\n", strerror(errno));
+                        ret = -1;
+                        goto out;
+                }
+        }
+        ret = read_catalog_entry(key, name, NULL);
+        if (ret == -1) {
+                goto out;
+        }
+        cataloged = ret == 0;
+        if (fstat(fd_input, &st) == -1) {
                 fprintf(stderr, "%s\n", strerror(errno));
+                ret = -1;
                 goto out;
         }
-        ret = comparepath(filename);
-        if (ret == -1) {
+        whole = fd_input != STDIN_FILENO && S_ISREG(st.st_mode);
+        if (cataloged && whole) {
+                ret = read_file_info(namespace_input.store_path, filename1,
+                        key, &info);
+                if (ret == -1)
+                        goto out;
+                if (ret == 0 && info.size == (uint64_t)st.st_size &&
+                        info.mtime_sec == st.st_mtim.tv_sec &&
+                        info.mtime_nsec == st.st_mtim.tv_nsec) {
+                        printf("\n%s is unchanged since it was deduped\n",
+                                key);
+                        goto out;
+                }
+        }
+        if (cataloged && fd_input == STDIN_FILENO) {
+                fprintf(stderr, "%s is already deduped, delete it before "
+                        "deduping it again from stdin\n", key);
+                ret = -1;
                 goto out;
         }
-        if (ret == 0) {
+        if (cataloged) {
                 printf("\nFile is already deduped."
                         "Do you want to overwrite?[Y/N]");
                 if (scanf("%c", &confirm) <= 0) {
@@ -84,220 +247,257 @@ dedup_file (namespace_dtl namespace_input, char *file_path)
                 if (confirm != 'y' && confirm != 'Y')
                         goto out;
         }
+        if (whole) {
+                ret = whole_file_digest(hash, fd_input, &st, &info);
+                if (ret == -1)
+                        goto out;
+                ret = find_whole_file(namespace_input.store_path, &info, twin,
+                        sizeof(twin));
+                if (ret == -1)
+                        goto out;
+                if (ret == 0) {
+                        ret = read_file_info(namespace_input.store_path, twin,
+                                NULL, &twin_info);
+                        if (ret == -1)
+                                goto out;
+                        info.chunks = twin_info.chunks;
+                }
+                /* The stub of the file is still current when only its
+                 * modification time changed, its stats are kept */
+                if (ret == 0 && strcmp(twin, filename1) == 0) {
+                        ret = read_catalog_entry(key, name, &entry);
+                        if (ret == -1)
+                                goto out;
+                        if (ret == 1) {
+                                entry.size = info.size;
+                                entry.chunks = info.chunks;
+                        }
+                        printf("\n%s is unchanged since it was deduped\n",
+                                key);
+                        goto record;
+                }
+                if (ret == 0) {
+                        ret = clone_stub(namespace_input.store_path, twin,
+                                filename1);
+                        if (ret == -1)
+                                goto out;
+                        entry.size = info.size;
+                        entry.chunks = info.chunks;
+                        printf("\n%s is identical to %s, its stub is "
+                                "copied\n", key, twin);
+                        goto record;
+                }
+        }
         printf("\nDeduplication in progress...\n");
         ret = init_stub_store(namespace_input.store_path, filename1, &fd_stub);
         if (ret < 0) {
                 fprintf(stderr, "%s\n", strerror(errno));
                 goto out;
         }
-        if (write (fd_stub, &store_type, int_size) == -1) {
-                fprintf(stderr, "%s\n", strerror(errno));
+        ret = stub_writer_open(&stub, fd_stub, store_type,
+                hash->digest_len);
+        if (ret == -1)
                 goto out;
-        }
-        fstat(fd_input, &st);
-        size = st.st_size;
         if (chunk_type == 0) {
-                while (1) {
-                        list = NULL;
-                        if (size <= block_size) {
-                                block_size = size;
-                        }
-                        b_offset = e_offset;
-                        ret = get_next_chunk(fd_input, chunk_type, block_size,
-                                &buffer, &length);
-                        if (ret <= 0)
-                                break;
-                        list = insert_vector_element(buffer, list, &ret,
-                                length);
-                        if (ret == -1)
-                                goto out;
-                        e_offset += length-1;
-                        size = size-length;
-                        ret = get_hash(hash_type, &hash, &h_length, list);
-                        if (ret == -1)
-                                goto out;
-                        ret = chunk_store(list, hash, length, h_length,
-                        b_offset, e_offset, fd_stub, store_type,
-                        namespace_input.store_path);
-                        if (ret == -1)
-                                goto out;
-                        e_offset++;
-                        if (size <= 0) {
-                                ret = 0;
-                                break;
-                        }
-                        clean_buff(&buffer);
-                        clean_buff(&hash);
-                }
+                chunker = create_fixed_chunker(block_size);
         } else {
+                ret = get_chunk_params(namespace_input, &params);
+                if (ret == -1)
+                        goto out;
+                chunker = create_chunker(&params);
                 fp      = fopen("./Rabin_Karp.csv", "w+");
                 if (fp == NULL) {
                         fprintf(stderr,
                                 "Error in creating file Rabin_Karp.csv\n");
+                        ret = -1;
                         goto out;
                 }
-
-                while (1) {
-                        b_offset = e_offset;
-                        list = NULL;
-                        chunk_flag = 0;
-                        while (chunk_flag == 0) {
-                                chunk_buffer = get_variable_chunk(fd_input,
-                                &ret, &size, &chunk_flag, &chunk_length);
-                                if (ret == -1) {
-                                        fprintf (stderr,
-                                                "Error in variable chunking\n");
-                                        goto out;
-                                }
-                                list = insert_vector_element(chunk_buffer, list,
-                                        &ret, chunk_length);
-                                length += chunk_length;
-                                if (ret == -1)
-                                        goto out;
-                        }
-                        e_offset += length - 1;
-                        ret = get_hash(hash_type, &hash, &h_length, list);
-                        if (ret == -1)
-                                goto out;
-                        ret = chunk_store(list, hash, length,
-                                h_length, b_offset, e_offset, fd_stub,
-                                store_type, namespace_input.store_path);
-                        if (ret == -1)
-                                goto out;
-                        fprintf(fp, "%d\n", length);
-                        e_offset++;
-                        clean_buff(&chunk_buffer);
-                        length = 0;
-                        if (size == 0)
-                                break;
-                }
         }
-        if (confirm == -1)
-                ret = writecatalog(filename);
+        if (chunker == NULL) {
+                ret = -1;
+                goto out;
+        }
+        chunker_feed(chunker, fd_input);
+        session.stub = &stub;
+        session.store_type = store_type;
+        session.store_path = namespace_input.store_path;
+        session.fp = fp;
+        session.arena = &arena;
+        arena_mark(&arena, &session.mark);
+        ret = run_pipeline(chunker, hash, namespace_input.threads,
+                store_chunk, &session);
+        if (ret == -1)
+                goto out;
+        ret = stub_writer_flush(&stub);
+        if (ret == -1)
+                goto out;
+        ret = write_stub_index(&stub, namespace_input.store_path, filename1);
+        if (ret == -1)
+                goto out;
+        printf("Dedup arena: %lu chunks, %lu allocations, %lu mallocs, "
+                "%lu bytes\n", (unsigned long)session.nr_chunks,
+                (unsigned long)arena.nr_alloc,
+                (unsigned long)arena.nr_malloc,
+                (unsigned long)arena.bytes);
+        info.chunks = session.nr_chunks;
+        entry.size = session.bytes;
+        entry.chunks = session.nr_chunks;
+        entry.unique_bytes = session.unique_bytes;
+record:
+        snprintf(entry.stub, sizeof(entry.stub), "%s", filename1);
+        if (whole) {
+                ret = write_file_info(namespace_input.store_path, filename1,
+                        key, &info);
+                if (ret == -1)
+                        goto out;
+        }
+        if (name != NULL)
+                ret = writecatalog_name(name, &entry);
+        else
+                ret = writecatalog(key, &entry);
         if (ret == -1)
                 goto out;
         ret = 0;
 out:
+        arena_destroy(&arena);
+        stub_writer_free(&stub);
+        destroy_chunker(&chunker);
         if (fp != NULL)
                 fclose(fp);
-        if (fd_input != -1)
+        if (fd_input != -1 && fd_input != STDIN_FILENO)
                 close(fd_input);
+        if (fd_stub != -1)
+                close(fd_stub);
         return ret;
 }
 
-/*
-Function to get next chunk from file.
-Input:int fd_input,int chunk_type,int block_size,char** buffer,
-int *length
-Output:int
-*/
-int
-get_next_chunk(int fd_input, int chunk_type, int block_size, char **buffer,
-int *length)
-{
-
-        int ret         =       -1;
-
-        *buffer = (char *)calloc(1, block_size+1);
-        ret = read(fd_input, *buffer, block_size);
-        if (ret < 1)
-                goto out;
-        *length = block_size;
-out:
-        return ret;
-
-}
-
 /*
 Function to get hash from a specific algorithm.
-Input:char *buffer,int length,int hash_type,char** hash,int *h_length
+Input:const struct hash_provider *hash,DIGEST *digest,int *h_length,
+vector_ptr list
 Output:int
 */
 int
-get_hash(int hash_type, char **hash, int *h_length, vector_ptr list)
+get_hash(const struct hash_provider *hash, DIGEST *digest, int *h_length,
+vector_ptr list)
 {
 
         int ret         =       -1;
-        char *buf       =       NULL;
-        char *buff      =       NULL;
-        DIGEST *digest  =     NULL;
+        DIGEST *buf     =     NULL;
 
-        switch (hash_type) {
-        case 0:
-                digest = str2md5(list);
-                buf = parse(digest, MD5_DIGEST_LENGTH);
-                *hash = buf;
-                *h_length = strlen(buf);
-                break;
-        case 1:
-                buff = sha1(list);
-                *hash = buff;
-                *h_length = strlen(buff);
-                break;
-        }
+        buf = hash->digest(list, digest);
+        *h_length = hash->digest_len;
+        if (buf == NULL)
+                goto out;
         ret = 0;
+out:
         return ret;
 
 }
 
 /*
 Function to store chunks in chunk store and hash in hash store.
-Input:char *buff,char *hash,int length,int h_length,int e_offset,
-int b_offset,int fd_stub
+Input:vector_ptr list,DIGEST *digest,int length,int h_length,
+uint64_t b_offset,uint64_t e_offset,struct stub_writer *stub,int store_type,
+char *store_path,struct arena *arena
 Output:int
 */
 int
-chunk_store(vector_ptr list, char *hash, int length, int h_length, int e_offset,
-int b_offset, int fd_stub, int store_type, char *store_path)
+chunk_store(vector_ptr list, DIGEST *digest, int length, int h_length,
+uint64_t b_offset, uint64_t e_offset, struct stub_writer *stub,
+int store_type, char *store_path, struct arena *arena)
 {
 
-        int off                 =       -1;
+        uint64_t off            =        0;
         int ret                 =       -1;
+        int stored              =        0;
+        char *hash              =       NULL;
 
-        if (store_type == 0) {
-                ret = searchhash(hash);
+        if (store_type == STORE_TYPE_DEFAULT ||
+                store_type == STORE_TYPE_CONTAINER) {
+                /* Chunks of a container read earlier in the stream are
+                 * found in the locality cache without asking the index */
+                ret = 1;
+                if (store_type == STORE_TYPE_CONTAINER)
+                        ret = container_cache_lookup(digest);
+                /* A fingerprint the filter has never seen is new, the
+                 * hash store is only asked when it may be a duplicate */
+                if (ret == 1 && filter_lookup(digest, h_length) == 1) {
+                        ret = searchhash(digest);
+                        if (ret == 0 && store_type == STORE_TYPE_CONTAINER) {
+                                ret = getposition(digest, &off);
+                                if (ret == -1)
+                                        goto out;
+                                ret = container_prefetch(off);
+                                if (ret == -1)
+                                        goto out;
+                        }
+                }
                 if (ret == -1) {
                         goto out;
                 }
                 if (ret == 0) {
-                        ret = write_to_stub(hash, h_length, fd_stub, b_offset,
-                                e_offset);
+                        ret = write_to_stub(digest, h_length, stub,
+                                b_offset, e_offset);
                         if (ret == -1) {
                                 goto out;
                         }
                 } else {
-                        off = insert_block(list, length);
-                        if (off == -1) {
-                                fprintf(stderr, "%s\n", strerror(errno));
-                                goto out;
+                        stored = 1;
+                        /* The container store indexes its chunks when the
+                         * container is sealed */
+                        if (store_type == STORE_TYPE_CONTAINER) {
+                                ret = insert_block_to_container(list, length,
+                                        digest, &off);
+                        } else {
+                                ret = insert_block(list, length, &off);
+                                if (ret == 0)
+                                        ret = insert_hash(digest, off);
                         }
-                        ret = insert_hash(hash, off);
                         if (ret == -1) {
                                 fprintf(stderr, "%s\n", strerror(errno));
                                 goto out;
                         }
-                        ret = write_to_stub(hash, h_length, fd_stub, b_offset,
-                                e_offset);
+                        ret = filter_insert(digest, h_length);
+                        if (ret == -1)
+                                goto out;
+                        ret = write_to_stub(digest, h_length, stub,
+                                b_offset, e_offset);
                         if (ret == -1) {
                                 fprintf(stderr, "%s\n", strerror(errno));
                                 goto out;
                         }
                 }
+        } else if (store_type == STORE_TYPE_PACK) {
+                ret = insert_block_to_pack(digest, list, length);
+                if (ret == -1)
+                        goto out;
+                stored = ret == 0;
+                ret = write_to_stub(digest, h_length, stub, b_offset,
+                        e_offset);
+                if (ret == -1) {
+                        fprintf(stderr, "%s\n", strerror(errno));
+                        goto out;
+                }
         } else {
+                hash = parse_arena(arena, digest, h_length);
+                if (hash == NULL)
+                        goto out;
                 ret = insert_block_to_object(hash, list, store_path);
                 if (ret == -1) {
                         fprintf(stderr, "%s\n", strerror(errno));
                         goto out;
                 }
-                ret = write_to_stub(hash, h_length, fd_stub, b_offset,
+                stored = ret == 0;
+                ret = write_to_stub(digest, h_length, stub, b_offset,
                         e_offset);
                 if (ret == -1) {
                         fprintf(stderr, "%s\n", strerror(errno));
                         goto out;
                 }
         }
-        ret = 0;
+        ret = stored;
 out:
         return ret;
 
-}
\ No newline at end of file
+}
@@ -3,6 +3,8 @@
 #endif
 
 #include "vector.h"
+#include "arena.h"
+#include "fingerprint.h"
 #include<stdio.h>
 #include<string.h>  
 #include<stdlib.h> 
@@ -12,6 +14,7 @@
 #include<ctype.h> 
 #include<sys/stat.h>
 #include<sys/types.h>
+#include<sys/mman.h>
 #include<fcntl.h>
 #include<time.h> 
 #include <libgen.h> 
@@ -25,34 +28,33 @@
 #include<openssl/ssl.h>
 #include<openssl/sha.h>
 #endif
+#include<stdint.h>
 #define int_size sizeof(int)
 
 typedef unsigned char DIGEST;
 
+struct stub_writer;
+
 /*@description:Function to get hash of a particular block.
-@in: vector_ptr list-block contents strored in vector,int length-length of buffer,
-        int hash_type-type of hash(sha1 or md5)
-@out: char** hash-hash generated from a block,int *h_length-length of hash generated
-@return: hash */
-int get_hash(int hash_type,char** hash,int *h_length, vector_ptr list);
+@in: vector_ptr list-block contents strored in vector,
+        const struct hash_provider *hash-fingerprint algorithm
+@out: DIGEST *digest-fingerprint generated from a block,int *h_length-length
+of fingerprint generated
+@return: -1 for error and 0 on success */
+int get_hash(const struct hash_provider *hash, DIGEST *digest, int *h_length,
+        vector_ptr list);
 
 /*@description:Function to insert hash to hashstore
-@in: char *buff-buffer that contains hash,int offset-starting position of block
+@in: DIGEST *digest-fingerprint of block,uint64_t offset-starting position of block
 @out: int 
 @return: -1 for error and 0 if inserted successfully */
-int insert_hash(char *buff,int offset);
+int insert_hash(DIGEST *digest, uint64_t offset);
 
 /*@description:Function to insert block to blockstore
 @in: vector_ptr list-buffer containing block,size_t length-size of block
-@out: int 
-@return: -1 for error and 0 if inserted successfully */
-int insert_block(vector_ptr list,size_t length);
-
-/*@description:Function to write the full path of file to catalog
-@in: char* filename-filename of file that has been deduped
-@out: int 
+@out: uint64_t *offset-position of the block in blockstore
 @return: -1 for error and 0 if inserted successfully */
-int writecatalog(char* filename);
+int insert_block(vector_ptr list, size_t length, uint64_t *offset);
 
 /*@description:Function to read the full path of file from catalog
 @in: int fc-file descriptor of catalog file
@@ -72,18 +74,11 @@ int searchpath(char out[],int filedes);
 @return: -1 for error and 0 if found. */
 int file_exist(char *filename);
 
-/*@description:Function to write hash,beginning offset and ending offset of block to stub
-@in: char *buff-buffer containing hash,size_t l-length of hash,int filedes-file
-descriptor of stub,int b_offset-beginning offset of block,int e_offset-ending offset of block
-@out: int 
-@return: -1 for error and 0 if found. */
-int write_to_stub(char buff[],size_t l,int filedes,int b_offset,int e_offset);
-
 /*@description:Function to get specific block from specified position 
-@in: int pos-position of block,
+@in: uint64_t pos-position of block,
 @out: char*
 @return: block */
-char* get_block(int pos, int *l);
+char* get_block(uint64_t pos, int *l);
 
 /*@description:Function to check single instance of block of specified position
 @in: int  st1-filedescriptor of stub,int b_offset-beginning offset of block,
@@ -94,38 +89,35 @@ int  searchstubhash(int  st1,int b_offset,int e_offset);
 
 /*@description:Function to create hash using md5.
 @in: vector_ptr list-Vector to store block for which the hash is generated,
-int length-length of block
-@out: char*-returns hash of block using md5
-@return: hash */
-DIGEST *str2md5(vector_ptr list);
+DIGEST *digest-16 byte buffer for the fingerprint
+@out: DIGEST*-returns hash of block using md5
+@return: digest */
+DIGEST *str2md5(vector_ptr list, DIGEST *digest);
 
 /*@description:Function to create hash using sha1.
 @in: vector_ptr list-Vector to store block for which the hash is generated,
-int length-length of block
-@out: char*-returns hash of block using sha1
-@return: hash */
-char* sha1(vector_ptr list);
+DIGEST *digest-20 byte buffer for the fingerprint
+@out: DIGEST*-returns fingerprint of block using sha1
+@return: digest */
+DIGEST *sha1(vector_ptr list, DIGEST *digest);
 
 /*@description:Function to insert block to blockstore object
 @in: vector_ptr list-buffer containing block,size_t length-size of block
 @out: int 
-@return: -1 for error and 0 if inserted successfully */
+@return: -1 for error, 1 if the block was stored already and 0 if inserted
+successfully */
 int insert_block_to_object(char *hash,vector_ptr list, char *store_path);
 
-/*@description:Function to get chunk from file
-@in: char **buffer-buffer containing block,size_t length-size of block, int fd_input -
- file descriptor of file, int chunk_type - type of chunk to be used.
-@out: int
-@return: -1 for error and 0 if inserted successfully */
-int get_next_chunk(int fd_input, int chunk_type,int block_size,
-        char **buffer, int *length);
-
 /*@description:Function to insert block to blockstore object
-@in: vector_ptr list-buffer containing block,size_t length-size of block, char *hash-
-hash value of chunk, int h_length - length of the hash, int store - type of store,
-int e_offset - Ending offset, int b_offset - Beginning offset.
+@in: vector_ptr list-buffer containing block,size_t length-size of block, DIGEST *digest-
+fingerprint of chunk, int h_length - length of the fingerprint, int store - type of store,
+uint64_t b_offset - Beginning offset, uint64_t e_offset - Ending offset,
+struct stub_writer *stub - writer of the stub of the file,
+struct arena *arena - scratch memory of the dedup session.
 @out: int 
-@return: -1 for error and 0 if inserted successfully */
-int chunk_store(vector_ptr list, char *hash, int length, int h_length,
-        int e_offset, int b_offset, int fd_stub, int store, char *store_path);
+@return: -1 for error, 1 if the chunk was new to the store and 0 if it was
+stored already */
+int chunk_store(vector_ptr list, DIGEST *digest, int length, int h_length,
+        uint64_t b_offset, uint64_t e_offset, struct stub_writer *stub,
+        int store, char *store_path, struct arena *arena);
 
@@ -0,0 +1,382 @@
+#include "filter.h"
+
+/* The filter file is mapped as a whole, updates reach the file through the
+shared mapping */
+static int fd_filter = -1;
+static size_t map_size;
+static struct filter_header *filter;
+static unsigned char *slots;
+
+/*Function to get the two base hashes of a fingerprint. Fingerprints are
+uniformly distributed so their bytes are used directly.
+Input:DIGEST *digest,int len
+Output:uint64_t *h1,uint64_t *h2
+*/
+static void
+filter_hashes(DIGEST *digest, int len, uint64_t *h1, uint64_t *h2)
+{
+
+        *h1 = 0;
+        *h2 = 0;
+        memcpy(h1, digest, len < 8 ? len : 8);
+        if (len > 8)
+                memcpy(h2, digest + 8, len - 8 < 8 ? len - 8 : 8);
+        *h2 |= 1;
+
+}
+
+/*Function to get the size in bytes of the slot array of a filter.
+Input:struct filter_header *header
+Output:size_t
+*/
+static size_t
+filter_array_size(struct filter_header *header)
+{
+
+        if (header->type == FILTER_BLOOM)
+                return (header->nr_slots + 7) / 8;
+        return header->nr_slots * CUCKOO_BUCKET_SLOTS * header->nr_hashes;
+
+}
+
+/*Function to size a filter for the given capacity and false positive rate.
+A bloom filter gets m = -n*ln(p)/ln(2)^2 bits and k = m/n*ln(2) hash
+functions. A cuckoo filter with 4 slot buckets needs tags of log2(8/p) bits
+and is kept below 95% load.
+Input:struct filter_header *header
+Output:void
+*/
+static void
+filter_size(struct filter_header *header)
+{
+
+        double  bits            =       0;
+        uint64_t buckets        =       1;
+
+        if (header->type == FILTER_BLOOM) {
+                bits = -(double)header->capacity * log(header->fp_rate) /
+                        (M_LN2 * M_LN2);
+                header->nr_slots = (uint64_t)bits < 64 ? 64 : (uint64_t)bits;
+                header->nr_hashes = (uint32_t)(bits / header->capacity *
+                        M_LN2 + 0.5);
+                if (header->nr_hashes == 0)
+                        header->nr_hashes = 1;
+                return;
+        }
+        bits = ceil(log2(2.0 * CUCKOO_BUCKET_SLOTS / header->fp_rate));
+        if (bits <= 8)
+                header->nr_hashes = 1;
+        else if (bits <= 16)
+                header->nr_hashes = 2;
+        else
+                header->nr_hashes = 4;
+        while (buckets * CUCKOO_BUCKET_SLOTS * 95 < header->capacity * 100)
+                buckets <<= 1;
+        header->nr_slots = buckets;
+
+}
+
+/*Function to get the filter type of a namespace setting.
+Input:char *filter
+Output:int
+*/
+int
+get_filter_type(char *filter)
+{
+
+        int ret         =       -1;
+
+        if (filter == NULL || strcmp(filter, "none") == 0)
+                ret = FILTER_NONE;
+        else if (strcmp(filter, "bloom") == 0)
+                ret = FILTER_BLOOM;
+        else if (strcmp(filter, "cuckoo") == 0)
+                ret = FILTER_CUCKOO;
+        return ret;
+
+}
+
+/*Function to open the filter of a namespace. A filter whose header does not
+match the namespace settings is recreated, the caller then repopulates it
+from the hash store.
+Input:char *path,int type,double fp_rate,uint64_t capacity
+Output:int *created
+*/
+int
+init_filter_store(char *path, int type, double fp_rate, uint64_t capacity,
+int *created)
+{
+
+        int ret         =       -1;
+        DIR *dp         =       NULL;
+        char filename[1024], filter_path[1024];
+        struct filter_header header;
+        struct stat st;
+
+        *created = 0;
+        if (type == FILTER_NONE)
+                return 0;
+        if (fp_rate <= 0 || fp_rate >= 1)
+                fp_rate = FILTER_FP_RATE;
+        if (capacity == 0)
+                capacity = FILTER_CAPACITY;
+        sprintf(filter_path, "%s/filters", path);
+        dp = opendir(filter_path);
+        if (NULL == dp) {
+                ret = mkdir(filter_path, 0777);
+                if (ret < 0) {
+                        fprintf(stderr, "%s\n", strerror(errno));
+                        goto out;
+                }
+        }
+        sprintf(filename, "%s/fingerprint.filter", filter_path);
+        fd_filter = open(filename, O_CREAT|O_RDWR, S_IRUSR|S_IWUSR);
+        if (fd_filter == -1) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                goto out;
+        }
+        if (fstat(fd_filter, &st) == -1) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                goto out;
+        }
+        memset(&header, 0, sizeof(header));
+        if (st.st_size < (off_t)sizeof(header) ||
+                pread(fd_filter, &header, sizeof(header), 0) != sizeof(header) ||
+                memcmp(header.magic, FILTER_MAGIC, MAGIC_LEN) != 0 ||
+                header.version != STORE_FORMAT_VERSION ||
+                header.type != (uint32_t)type || header.fp_rate != fp_rate ||
+                header.capacity != capacity ||
+                st.st_size != (off_t)(sizeof(header) +
+                filter_array_size(&header))) {
+                memset(&header, 0, sizeof(header));
+                memcpy(header.magic, FILTER_MAGIC, MAGIC_LEN);
+                header.version = STORE_FORMAT_VERSION;
+                header.type = type;
+                header.fp_rate = fp_rate;
+                header.capacity = capacity;
+                filter_size(&header);
+                if (ftruncate(fd_filter, 0) == -1 ||
+                        ftruncate(fd_filter, sizeof(header) +
+                        filter_array_size(&header)) == -1 ||
+                        pwrite(fd_filter, &header, sizeof(header), 0) !=
+                        sizeof(header)) {
+                        fprintf(stderr, "%s\n", strerror(errno));
+                        ret = -1;
+                        goto out;
+                }
+                *created = 1;
+        }
+        map_size = sizeof(header) + filter_array_size(&header);
+        filter = mmap(NULL, map_size, PROT_READ|PROT_WRITE, MAP_SHARED,
+                fd_filter, 0);
+        if (filter == MAP_FAILED) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                filter = NULL;
+                ret = -1;
+                goto out;
+        }
+        slots = (unsigned char *)(filter + 1);
+        ret = 0;
+out:
+        if (dp != NULL)
+                closedir(dp);
+        return ret;
+
+}
+
+/*Function to get the tag stored in a slot of a cuckoo bucket.
+Input:uint64_t bucket,int slot
+Output:uint32_t
+*/
+static uint32_t
+cuckoo_get(uint64_t bucket, int slot)
+{
+
+        uint32_t tag    =       0;
+
+        memcpy(&tag, slots + (bucket * CUCKOO_BUCKET_SLOTS + slot) *
+                filter->nr_hashes, filter->nr_hashes);
+        return tag;
+
+}
+
+/*Function to store a tag in a slot of a cuckoo bucket.
+Input:uint64_t bucket,int slot,uint32_t tag
+Output:void
+*/
+static void
+cuckoo_set(uint64_t bucket, int slot, uint32_t tag)
+{
+
+        memcpy(slots + (bucket * CUCKOO_BUCKET_SLOTS + slot) *
+                filter->nr_hashes, &tag, filter->nr_hashes);
+
+}
+
+/*Function to get the alternate bucket of a tag. It is its own inverse so
+either bucket leads to the other.
+Input:uint64_t bucket,uint32_t tag
+Output:uint64_t
+*/
+static uint64_t
+cuckoo_alt(uint64_t bucket, uint32_t tag)
+{
+
+        return (bucket ^ ((uint64_t)tag * 0x5bd1e995)) &
+                (filter->nr_slots - 1);
+
+}
+
+/*Function to get the tag and buckets of a fingerprint. Tag 0 marks an
+empty slot so it is never produced.
+Input:DIGEST *digest,int len
+Output:uint32_t *tag,uint64_t *b1,uint64_t *b2
+*/
+static void
+cuckoo_locate(DIGEST *digest, int len, uint32_t *tag, uint64_t *b1,
+uint64_t *b2)
+{
+
+        uint64_t h1     =       0;
+        uint64_t h2     =       0;
+
+        filter_hashes(digest, len, &h1, &h2);
+        *tag = (uint32_t)(h2 >> 32);
+        if (filter->nr_hashes < sizeof(uint32_t))
+                *tag &= (1U << (filter->nr_hashes * 8)) - 1;
+        if (*tag == 0)
+                *tag = 1;
+        *b1 = h1 & (filter->nr_slots - 1);
+        *b2 = cuckoo_alt(*b1, *tag);
+
+}
+
+/*Function to check whether a fingerprint may be present in the filter.
+Input:DIGEST *digest,int len
+Output:int
+*/
+int
+filter_lookup(DIGEST *digest, int len)
+{
+
+        int     ret     =       1;
+        uint32_t i      =       0;
+        uint32_t tag    =       0;
+        uint64_t h1     =       0;
+        uint64_t h2     =       0;
+        uint64_t bit    =       0;
+        uint64_t b1     =       0;
+        uint64_t b2     =       0;
+
+        if (filter == NULL || filter->overflow)
+                goto out;
+        if (filter->type == FILTER_BLOOM) {
+                filter_hashes(digest, len, &h1, &h2);
+                for (i = 0; i < filter->nr_hashes; i++) {
+                        bit = (h1 + i * h2) % filter->nr_slots;
+                        if (!(slots[bit / 8] & (1 << (bit % 8)))) {
+                                ret = 0;
+                                goto out;
+                        }
+                }
+                goto out;
+        }
+        cuckoo_locate(digest, len, &tag, &b1, &b2);
+        for (i = 0; i < CUCKOO_BUCKET_SLOTS; i++) {
+                if (cuckoo_get(b1, i) == tag || cuckoo_get(b2, i) == tag)
+                        goto out;
+        }
+        ret = 0;
+out:
+        return ret;
+
+}
+
+/*Function to add a fingerprint to the filter. When a cuckoo filter can not
+place a tag it is marked as overflowed and every lookup is answered by the
+hash store from then on.
+Input:DIGEST *digest,int len
+Output:int
+*/
+int
+filter_insert(DIGEST *digest, int len)
+{
+
+        int     ret     =       0;
+        int     kick    =       0;
+        uint32_t i      =       0;
+        uint32_t tag    =       0;
+        uint32_t victim =       0;
+        uint64_t h1     =       0;
+        uint64_t h2     =       0;
+        uint64_t bit    =       0;
+        uint64_t b1     =       0;
+        uint64_t b2     =       0;
+
+        if (filter == NULL || filter->overflow)
+                goto out;
+        filter->count++;
+        if (filter->type == FILTER_BLOOM) {
+                filter_hashes(digest, len, &h1, &h2);
+                for (i = 0; i < filter->nr_hashes; i++) {
+                        bit = (h1 + i * h2) % filter->nr_slots;
+                        slots[bit / 8] |= 1 << (bit % 8);
+                }
+                goto out;
+        }
+        cuckoo_locate(digest, len, &tag, &b1, &b2);
+        for (kick = 0; kick < CUCKOO_MAX_KICKS; kick++) {
+                for (i = 0; i < CUCKOO_BUCKET_SLOTS; i++) {
+                        if (cuckoo_get(b1, i) == 0) {
+                                cuckoo_set(b1, i, tag);
+                                goto out;
+                        }
+                        if (cuckoo_get(b2, i) == 0) {
+                                cuckoo_set(b2, i, tag);
+                                goto out;
+                        }
+                }
+                i = (tag + kick) % CUCKOO_BUCKET_SLOTS;
+                victim = cuckoo_get(b1, i);
+                cuckoo_set(b1, i, tag);
+                tag = victim;
+                b1 = cuckoo_alt(b1, tag);
+                b2 = cuckoo_alt(b1, tag);
+        }
+        fprintf(stderr, "Fingerprint filter is full, falling back to the "
+                "hash store\n");
+        filter->overflow = 1;
+out:
+        return ret;
+
+}
+
+/*Function to flush and close the filter.
+Input:void
+Output:int
+*/
+int
+fini_filter_store()
+{
+
+        int ret         =       0;
+
+        if (filter != NULL) {
+                if (msync(filter, map_size, MS_SYNC) == -1 ||
+                        munmap(filter, map_size) == -1) {
+                        fprintf(stderr, "%s\n", strerror(errno));
+                        ret = -1;
+                }
+                filter = NULL;
+                slots = NULL;
+        }
+        if (fd_filter != -1) {
+                if (close(fd_filter) == -1) {
+                        fprintf(stderr, "%s\n", strerror(errno));
+                        ret = -1;
+                }
+                fd_filter = -1;
+        }
+        return ret;
+
+}
@@ -0,0 +1,79 @@
+#ifndef __FILTER_H__
+#define __FILTER_H__
+
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<unistd.h>
+#include<dirent.h>
+#include<errno.h>
+#include<math.h>
+#include<stdint.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<sys/types.h>
+#include<fcntl.h>
+#include "store_format.h"
+
+#define FILTER_MAGIC            "YDLF"
+#define FILTER_FP_RATE          0.01
+#define FILTER_CAPACITY         (1 << 20)
+#define CUCKOO_BUCKET_SLOTS     4
+#define CUCKOO_MAX_KICKS        500
+
+typedef unsigned char DIGEST;
+
+enum filter_type {FILTER_NONE, FILTER_BLOOM, FILTER_CUCKOO};
+
+/*Header of the filter file, the bit array of a bloom filter or the buckets
+of a cuckoo filter follow it. The filter holds every fingerprint of the
+hash store, so fingerprints are never removed from it. It is rebuilt from
+the hash store when the file is missing or sized differently.*/
+struct filter_header
+{
+        char magic[MAGIC_LEN];
+        uint32_t version;
+        uint32_t type;
+        uint32_t nr_hashes;     /* bloom: hash functions, cuckoo: tag bytes */
+        uint64_t nr_slots;      /* bloom: bits, cuckoo: buckets */
+        uint64_t capacity;
+        uint64_t count;
+        double fp_rate;
+        uint32_t overflow;      /* cuckoo filter ran out of room */
+        uint32_t reserved;
+};
+
+/*@description:Function to get the filter type of a namespace setting
+@in: char *filter-none, bloom or cuckoo
+@out: int
+@return: -1 for unknown filter and filter_type otherwise */
+int get_filter_type(char *filter);
+
+/*@description:Function to open the filter of a namespace, creating it when it
+does not exist yet
+@in: char *path-path of store_block, int type-filter_type, double fp_rate-
+false positive rate, uint64_t capacity-number of fingerprints it is sized for
+@out: int *created-set to 1 if the filter is new and has to be populated
+@return: -1 for error and 0 if opened successfully */
+int init_filter_store(char *path, int type, double fp_rate, uint64_t capacity,
+        int *created);
+
+/*@description:Function to check whether a fingerprint may be present
+@in: DIGEST *digest-fingerprint, int len-length of fingerprint
+@out: int
+@return: 0 if fingerprint is definitely new and 1 if it may be present */
+int filter_lookup(DIGEST *digest, int len);
+
+/*@description:Function to add a fingerprint to the filter
+@in: DIGEST *digest-fingerprint, int len-length of fingerprint
+@out: int
+@return: -1 for error and 0 if added successfully */
+int filter_insert(DIGEST *digest, int len);
+
+/*@description:Function to flush and close the filter
+@in: void
+@out: int
+@return: -1 for error and 0 if closed successfully */
+int fini_filter_store();
+
+#endif
@@ -0,0 +1,165 @@
+#include "fingerprint.h"
+#include "md5.h"
+#include "sha1.h"
+#include "hash_batch.h"
+#include <pthread.h>
+#include <openssl/sha.h>
+#ifdef HAVE_LIBBLAKE3
+#include <blake3.h>
+#endif
+#ifdef HAVE_LIBXXHASH
+#define XXH_STATIC_LINKING_ONLY
+#include <xxhash.h>
+#endif
+
+/* Digest context of the calling thread, freed when the thread exits */
+static pthread_key_t ctx_key;
+static pthread_once_t ctx_once = PTHREAD_ONCE_INIT;
+
+/*Function to create the key of the per thread digest contexts.
+Input:void
+Output:void
+*/
+static void
+ctx_key_create()
+{
+
+        pthread_key_create(&ctx_key, (void (*)(void *))EVP_MD_CTX_free);
+
+}
+
+/*Function to fingerprint the pieces of a vector with an OpenSSL digest,
+the context is allocated once per thread and reset for every chunk.
+Input:const EVP_MD *md,vector_ptr list,DIGEST *digest
+Output:DIGEST* - digest, NULL for error
+*/
+DIGEST *
+evp_digest(const EVP_MD *md, vector_ptr list, DIGEST *digest)
+{
+
+        int             i       =       0;
+        EVP_MD_CTX      *c      =       NULL;
+
+        if (list == NULL)
+                return digest;
+        pthread_once(&ctx_once, ctx_key_create);
+        c = (EVP_MD_CTX *)pthread_getspecific(ctx_key);
+        if (c == NULL) {
+                c = EVP_MD_CTX_new();
+                if (c == NULL || pthread_setspecific(ctx_key, c) != 0) {
+                        fprintf(stderr, "Error in digest allocation\n");
+                        EVP_MD_CTX_free(c);
+                        return NULL;
+                }
+        }
+        if (EVP_DigestInit_ex(c, md, NULL) != 1)
+                goto error;
+        for (i = 0; i < list->count; i++)
+                if (EVP_DigestUpdate(c, list->iov[i].iov_base,
+                        list->iov[i].iov_len) != 1)
+                        goto error;
+        if (EVP_DigestFinal_ex(c, digest, NULL) != 1)
+                goto error;
+        return digest;
+error:
+        fprintf(stderr, "Error in computing the fingerprint\n");
+        return NULL;
+
+}
+
+/*Function to create hash using sha256. OpenSSL picks the SHA extensions
+of the CPU at run time where there are any.
+Input:vector_ptr list, DIGEST *digest - 32 byte buffer for the fingerprint
+Output:DIGEST* - digest
+*/
+static DIGEST *
+sha256(vector_ptr list, DIGEST *digest)
+{
+
+        return evp_digest(EVP_sha256(), list, digest);
+
+}
+
+#ifdef HAVE_LIBBLAKE3
+/*Function to create hash using BLAKE3, the library picks the widest
+SIMD kernel of the CPU at run time.
+Input:vector_ptr list, DIGEST *digest - 32 byte buffer for the fingerprint
+Output:DIGEST* - digest
+*/
+static DIGEST *
+blake3(vector_ptr list, DIGEST *digest)
+{
+
+        blake3_hasher c;
+        int i;
+
+        if (list != NULL) {
+                blake3_hasher_init(&c);
+                for (i = 0; i < list->count; i++)
+                        blake3_hasher_update(&c, list->iov[i].iov_base,
+                                list->iov[i].iov_len);
+                blake3_hasher_finalize(&c, digest, BLAKE3_OUT_LEN);
+        }
+        return digest;
+
+}
+#endif
+
+#ifdef HAVE_LIBXXHASH
+/*Function to create hash using XXH3 128 bit, stored big endian.
+Input:vector_ptr list, DIGEST *digest - 16 byte buffer for the fingerprint
+Output:DIGEST* - digest
+*/
+static DIGEST *
+xxh128(vector_ptr list, DIGEST *digest)
+{
+
+        XXH3_state_t c;
+        XXH128_canonical_t canonical;
+        int i;
+
+        if (list != NULL) {
+                XXH3_128bits_reset(&c);
+                for (i = 0; i < list->count; i++)
+                        XXH3_128bits_update(&c, list->iov[i].iov_base,
+                                list->iov[i].iov_len);
+                XXH128_canonicalFromHash(&canonical, XXH3_128bits_digest(&c));
+                memcpy(digest, canonical.digest, sizeof(canonical.digest));
+        }
+        return digest;
+
+}
+#endif
+
+/* Fingerprint algorithms by hash_type, a namespace records the name so the
+ * order of the table does not matter */
+static const struct hash_provider providers[] = {
+        {"md5",         MD5_DIGEST_LENGTH,      str2md5,        md5_batch},
+        {"sha1",        SHA_DIGEST_LENGTH,      sha1,           sha1_batch},
+        {"sha256",      SHA256_DIGEST_LENGTH,   sha256,         NULL},
+#ifdef HAVE_LIBBLAKE3
+        {"blake3",      BLAKE3_OUT_LEN,         blake3,         NULL},
+#endif
+#ifdef HAVE_LIBXXHASH
+        {"xxh128",      sizeof(XXH128_canonical_t), xxh128,     NULL},
+#endif
+};
+
+/*Function to find the fingerprint algorithm of a hash type.
+Input:const char *name
+Output:const struct hash_provider* - NULL if unknown
+*/
+const struct hash_provider *
+get_hash_provider(const char *name)
+{
+
+        size_t i        =       0;
+
+        if (name == NULL)
+                return NULL;
+        for (i = 0; i < sizeof(providers) / sizeof(providers[0]); i++)
+                if (strcmp(providers[i].name, name) == 0)
+                        return &providers[i];
+        return NULL;
+
+}
@@ -0,0 +1,55 @@
+#ifndef __FINGERPRINT_H__
+#define __FINGERPRINT_H__
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<openssl/evp.h>
+#include "vector.h"
+
+typedef unsigned char DIGEST;
+
+struct chunk_slice;
+
+/*Fingerprint algorithm a namespace can be created with.
+        name       : Value of hash_type in the namespace
+        digest_len : Length of the fingerprint, at most MAX_DIGEST_LEN
+        digest     : Function to fingerprint the pieces of a vector into a
+                     digest_len byte buffer, NULL for error
+        digest_batch : Function to fingerprint many chunks at once, NULL if
+                     the algorithm has no multi-buffer kernel
+*/
+struct hash_provider
+{
+        const char      *name;
+        int             digest_len;
+        DIGEST          *(*digest)(vector_ptr list, DIGEST *digest);
+        int             (*digest_batch)(const struct chunk_slice *slices,
+                                DIGEST **digests, int count);
+};
+
+/*@description:Function to find the fingerprint algorithm of a hash type.
+Algorithms whose library was not found at build time are not known.
+Input:
+        const char *name : hash_type of the namespace
+Output:
+        const struct hash_provider * : NULL if the hash type is unknown
+*/
+const struct hash_provider *get_hash_provider(const char *name);
+
+/*@description:Function to fingerprint the pieces of a vector with an
+OpenSSL digest. Every thread keeps a context of its own.
+Input:
+        const EVP_MD *md : Digest algorithm
+        vector_ptr list  : Pieces to fingerprint
+        DIGEST *digest   : Buffer of EVP_MD_size(md) bytes
+Output:
+        DIGEST *         : digest, NULL for error
+*/
+DIGEST *evp_digest(const EVP_MD *md, vector_ptr list, DIGEST *digest);
+
+#endif
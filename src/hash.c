@@ -1,18 +1,191 @@
 #include "hash.h"
 #include "clean_buff.h"
+#include "store_format.h"
+#include "fingerprint.h"
 
 static int fd_hash;
+static int digest_len;
+
+/* In-memory index of the hash store, keyed by the binary fingerprint */
+static struct hash_entry *hash_table;
+static size_t table_size;
+static size_t table_count;
+
+/*Function to get the home slot of a fingerprint in the hash table.
+Fingerprints are uniformly distributed so their leading bytes are used
+directly.
+Input:DIGEST *digest
+Output:size_t
+*/
+static size_t
+hash_slot(DIGEST *digest)
+{
+
+        uint64_t        key     =       0;
+
+        memcpy(&key, digest, sizeof(key));
+        return key & (table_size - 1);
+
+}
+
+/*Function to find the slot of a fingerprint in the hash table.
+Input:DIGEST *digest,int len
+Output:struct hash_entry* - matching or empty slot
+*/
+static struct hash_entry *
+hash_table_find(DIGEST *digest, int len)
+{
+
+        size_t                  slot    =       0;
+        struct hash_entry       *entry  =       NULL;
+
+        slot = hash_slot(digest);
+        while (1) {
+                entry = &hash_table[slot];
+                if (entry->length == 0)
+                        break;
+                if (entry->length == len &&
+                        memcmp(entry->digest, digest, len) == 0)
+                        break;
+                slot = (slot + 1) & (table_size - 1);
+        }
+        return entry;
+
+}
+
+/*Function to double the size of the hash table.
+Input:void
+Output:int
+*/
+static int
+hash_table_grow()
+{
+
+        int                     ret             =       -1;
+        size_t                  index           =       0;
+        size_t                  old_size        =       table_size;
+        struct hash_entry       *old_table      =       hash_table;
+        struct hash_entry       *entry          =       NULL;
+
+        hash_table = (struct hash_entry *)calloc(old_size * 2,
+                sizeof(struct hash_entry));
+        if (hash_table == NULL) {
+                fprintf(stderr, "Error in hash table allocation\n");
+                hash_table = old_table;
+                goto out;
+        }
+        table_size = old_size * 2;
+        for (index = 0; index < old_size; index++) {
+                if (old_table[index].length == 0)
+                        continue;
+                entry = hash_table_find(old_table[index].digest,
+                        old_table[index].length);
+                *entry = old_table[index];
+        }
+        free(old_table);
+        ret = 0;
+out:
+        return ret;
+
+}
+
+/*Function to add a fingerprint to the hash table. A later offset for the
+same fingerprint replaces the earlier one.
+Input:DIGEST *digest,int len,uint64_t offset
+Output:int
+*/
+static int
+hash_table_insert(DIGEST *digest, int len, uint64_t offset)
+{
+
+        int                     ret     =       -1;
+        struct hash_entry       *entry  =       NULL;
+
+        if ((table_count + 1) * 10 > table_size * 7) {
+                ret = hash_table_grow();
+                if (ret == -1)
+                        goto out;
+        }
+        entry = hash_table_find(digest, len);
+        if (entry->length == 0) {
+                memcpy(entry->digest, digest, len);
+                entry->length = len;
+                table_count++;
+        }
+        entry->offset = offset;
+        ret = 0;
+out:
+        return ret;
+
+}
+
+/*Function to load all the records of the hash file into the hash table.
+Input:void
+Output:int
+*/
+static int
+load_hash_store()
+{
+
+        int     ret             =       -1;
+        int     fd              =       -1;
+        uint64_t offset         =        0;
+        DIGEST  record[HASH_RECORD_MAX];
+        FILE    *fp             =       NULL;
+
+        table_size = HASH_TABLE_INIT;
+        table_count = 0;
+        hash_table = (struct hash_entry *)calloc(table_size,
+                sizeof(struct hash_entry));
+        if (hash_table == NULL) {
+                fprintf(stderr, "Error in hash table allocation\n");
+                goto out;
+        }
+        if (-1 == lseek(fd_hash, STORE_HEADER_SIZE, SEEK_SET)) {
+                printf("\nLseek failed with error: [%s]\n", strerror(errno));
+                goto out;
+        }
+        fd = dup(fd_hash);
+        if (fd == -1) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                goto out;
+        }
+        fp = fdopen(fd, "r");
+        if (fp == NULL) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                close(fd);
+                goto out;
+        }
+        while (fread(record, digest_len + sizeof(offset), 1, fp) == 1) {
+                memcpy(&offset, record + digest_len, sizeof(offset));
+                ret = hash_table_insert(record, digest_len, offset);
+                if (ret == -1)
+                        goto out;
+        }
+        if (ferror(fp)) {
+                printf("\nError while reading %s\n", strerror(errno));
+                ret = -1;
+                goto out;
+        }
+        ret = 0;
+out:
+        if (fp != NULL)
+                fclose(fp);
+        return ret;
+
+}
 
 /*Function to create hash for a given block
 Input:void
 Output:int*/
 int
-init_hash_store(char *path)
+init_hash_store(char *path, int length)
 {
 
         int ret         =       -1;
         DIR *dp = NULL;
         char filename[1024], hash_path[1024];
+        struct store_header header;
 
         strcpy(hash_path,path);
         sprintf(hash_path, "%s/hashs", hash_path);
@@ -33,6 +206,23 @@ init_hash_store(char *path)
                         strerror(errno));
                 goto out;
         }
+        ret = read_store_header(fd_hash, HASH_STORE_MAGIC, &header);
+        if (ret == -1)
+                goto out;
+        if (ret == 1) {
+                ret = write_store_header(fd_hash, HASH_STORE_MAGIC, length, 0);
+                if (ret == -1)
+                        goto out;
+        } else if (header.digest_len != length) {
+                fprintf(stderr, "Hash store holds %u byte fingerprints, "
+                        "expected %d\n", header.digest_len, length);
+                ret = -1;
+                goto out;
+        }
+        digest_len = length;
+        ret = load_hash_store();
+        if (ret == -1)
+                goto out;
         ret = 0;
 
 out:
@@ -43,29 +233,25 @@ out:
 }
 
 /*Function to write contents to a hash file.
-Input:char *buff,int offset
+Input:DIGEST *digest,uint64_t offset
 Output:int
 */
 int
-insert_hash(char *buff, int offset)
+insert_hash(DIGEST *digest, uint64_t offset)
 {
 
-        size_t          length;
         int ret         =       -1;
+        DIGEST record[HASH_RECORD_MAX];
 
-        length = strlen(buff);
-        if (write (fd_hash, &length, int_size) == -1) {
+        memcpy(record, digest, digest_len);
+        memcpy(record + digest_len, &offset, sizeof(offset));
+        if (write(fd_hash, record, digest_len + sizeof(offset)) == -1) {
                 printf("\nWrite failed with error%s\n", strerror(errno));
                 goto out;
         }
-        if (-1 == write(fd_hash, buff, length)) {
-                printf("\nWrite1 failed with error%s\n", strerror(errno));
-                goto out;
-        }
-        if (write (fd_hash, &offset, int_size) == -1) {
-                printf("\nWrite failed with error%s\n", strerror(errno));
+        ret = hash_table_insert(digest, digest_len, offset);
+        if (ret == -1)
                 goto out;
-        }
         ret = 0;
 out:
         return ret;
@@ -73,129 +259,80 @@ out:
 }
 
 /*Function to check whether a hash is present in hash store or not.
-Input:char *out
+Input:DIGEST *digest
 Output:int
 */
 int
-searchhash(char *out)
+searchhash(DIGEST *digest)
 {
 
-        struct stat             st;
-        int     fd2             =               fd_hash;
-        int     size            =               0;
-        size_t  length          =               0;
-        int     ret             =               -1;
-        int     offset          =               0;
-        char    *buffer         =               NULL;
-
-        fstat(fd_hash, &st);
-        size = st.st_size;
-        /*rewind the stream pointer to the start of temporary file*/
-        if (-1 == lseek(fd_hash, 0, SEEK_SET)) {
-                printf("\nLseek failed with error: [%s]\n", strerror(errno));
-                goto out;
-        }
-        if (size == 0) {
-                ret = 1;
-                goto out;
-        }
-        while (size > 0) {
-                ret = read(fd2, &length, int_size);
-                if (ret == -1) {
-                        printf("\nError while reading %s\n", strerror(errno));
-                        goto out;
-                }
-                buffer = (char *)calloc(1, length+1);
-                ret = read(fd2, buffer, length);
-                if (ret == -1) {
-                        printf("\nRead failed with error %s\n",
-                                strerror(errno));
-                        goto out;
-                }
-                ret = read(fd2, &offset, int_size);
-                if (ret == -1) {
-                        printf("\nError while reading %s\n", strerror(errno));
-                        goto out;
-                }
+        int     ret             =               1;
 
-                buffer[length] = '\0';
-                if (strcmp(out, buffer) == 0) {
-                        ret = 0;
-                        clean_buff(&buffer);
-                        break;
-                }
-                size -= (length+int_size+int_size);
-                clean_buff(&buffer);
-                ret = 1;
-        }
-out:
+        if (hash_table_find(digest, digest_len)->length != 0)
+                ret = 0;
         return ret;
 
 }
 
 /*Function to get the position of specific block in hash.
-Input:char* hash
+Input:DIGEST *digest,uint64_t *offset
 Output:int
 */
 int
-getposition(char *hash)
+getposition(DIGEST *digest, uint64_t *offset)
 {
 
-        struct stat             st;
-        int     size    =       0;
-        size_t  length  =       0;
         int     ret     =       -1;
-        int     offset  =       0;
-        char    *buffer  =       NULL;
-        int h_length    =       0;
-
-        fstat(fd_hash, &st);
-        size = st.st_size;
-        h_length = strlen(hash);
-        /* rewind the stream pointer to the start of temporary file*/
-        if (-1 == lseek(fd_hash, 0, SEEK_SET)) {
-                printf("\nLseek failed with error: [%s]\n", strerror(errno));
-                goto out;
-        }
-        if (size == 0) {
-                ret = 1;
+        struct hash_entry *entry = NULL;
+
+        entry = hash_table_find(digest, digest_len);
+        if (entry->length == 0)
                 goto out;
-        }
+        *offset = entry->offset;
+        ret = 0;
+out:
+        return ret;
 
-        while (size > 0) {
-                ret = read(fd_hash, &length, int_size);
-                if (ret == -1) {
-                        printf("\nError while reading %s", strerror(errno));
-                        goto out;
-                }
-                buffer = (char *)calloc(1, length+1);
-                hash[h_length] = '\0';
-                ret = read(fd_hash, buffer, length);
-                if (ret == -1) {
-                        printf("\nRead failed with error %s\n",
-                                strerror(errno));
-                        goto out;
-                }
-                ret = read(fd_hash, &offset, int_size);
-                if (ret == -1) {
-                        printf("\nError while reading %s", strerror(errno));
+}
+
+/*Function to call fn for every fingerprint of the hash store.
+Input:int (*fn)(DIGEST *, int)
+Output:int
+*/
+int
+walk_hash_store(int (*fn)(DIGEST *, int))
+{
+
+        int     ret             =       0;
+        size_t  index           =       0;
+
+        for (index = 0; index < table_size; index++) {
+                if (hash_table[index].length == 0)
+                        continue;
+                ret = fn(hash_table[index].digest, hash_table[index].length);
+                if (ret == -1)
                         goto out;
-                }
-                buffer[length] = '\0';
-                if (strcmp(hash, buffer) == 0) {
-                        ret = 0;
-                        clean_buff(&buffer);
-                        break;
-                }
-                size -= (length+int_size+int_size);
-                clean_buff(&buffer);
-                ret = -1;
         }
+        ret = 0;
 out:
-        if (ret == -1)
-                return ret;
-        else
-                return offset;
+        return ret;
+
+}
+
+/*Function to get the length of the fingerprints of a hash type.
+Input:char *hash_type
+Output:int
+*/
+int
+get_digest_length(char *hash_type)
+{
+
+        const struct hash_provider *hash =      NULL;
+
+        hash = get_hash_provider(hash_type);
+        if (hash == NULL)
+                return -1;
+        return hash->digest_len;
 
 }
 
@@ -208,6 +345,9 @@ fini_hash_store()
 
         int ret         =       -1;
 
+        clean_buff((char **)&hash_table);
+        table_size = 0;
+        table_count = 0;
         if (fd_hash != -1)
                 ret = close(fd_hash);
         if (ret == -1) {
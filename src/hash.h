@@ -20,33 +20,61 @@
 #include<openssl/ssl.h>
 #include<openssl/sha.h>
 #endif
+#include "store_format.h"
 #define block 10
 #define NAME_SIZE 100
 #define int_size sizeof(int)
+#define HASH_TABLE_INIT 1024
+#define HASH_RECORD_MAX (MAX_DIGEST_LEN + sizeof(uint64_t))
 
-/*@description:Function to create hashstore
-@in: void
+typedef unsigned char DIGEST;
+
+/*Structure of a slot in the in-memory index of the hash store*/
+struct hash_entry
+{
+        DIGEST digest[MAX_DIGEST_LEN];
+        int length;
+        uint64_t offset;
+};
+
+/*@description:Function to create hashstore and load it into an in-memory
+hash table so that lookups do not have to scan the hash file
+@in: char *path-path of the store, int length-length of the fingerprints
 @out: int 
 @return: -1 for error and 0 if created successfully */
-int init_hash_store();
+int init_hash_store(char *path, int length);
 
 /*@description:Function to insert hash to hashstore
-@in: char *buff-buffer that contains hash,int offset-starting position of block
+@in: DIGEST *digest-fingerprint of block,uint64_t offset-starting position
+of block
 @out: int 
 @return: -1 for error and 0 if inserted successfully */
-int insert_hash(char *buff,int offset);
+int insert_hash(DIGEST *digest, uint64_t offset);
 
 /*@description:Function to check whether hash is already present or not.
-@in: char *out-input hash
+@in: DIGEST *digest-input fingerprint
 @out: int hash
-@return: -1 for error and 0 if hash already present */
-int searchhash(char *out);
+@return: 1 if not present and 0 if hash already present */
+int searchhash(DIGEST *digest);
 
 /*@description:Function to get the position of specific block in hash
-@in: char* hash-hash
-@out: int 
+@in: DIGEST *digest-fingerprint of block
+@out: uint64_t *offset-position of the block in blockstore
 @return: -1 for error and 0 if found. */
-int getposition(char* hash);
+int getposition(DIGEST *digest, uint64_t *offset);
+
+/*@description:Function to call fn for every fingerprint of the hash store,
+used to populate a fingerprint filter
+@in: int (*fn)(DIGEST *, int)-called with fingerprint and its length
+@out: int
+@return: -1 if fn failed and 0 otherwise */
+int walk_hash_store(int (*fn)(DIGEST *, int));
+
+/*@description:Function to get the length of the fingerprints of a hash type
+@in: char *hash_type-md5 or sha1
+@out: int
+@return: -1 for unknown hash type and length of fingerprint otherwise */
+int get_digest_length(char *hash_type);
 
 /*@description:Function to create blockstore
 @in: void
@@ -0,0 +1,622 @@
+#include <pthread.h>
+#include "hash_batch.h"
+#include "md5.h"
+#include "sha1.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#include <cpuid.h>
+#define HAVE_HASH_BATCH_AVX2 1
+#endif
+
+typedef int (*batch_fn)(const struct chunk_slice *slices, DIGEST **digests,
+        int count);
+
+static int batch_kernel;
+static const char *batch_kernel_name;
+/* OpenSSL hashes a single sha1 stream with the SHA extensions faster than
+ * the multi-buffer kernel */
+static int cpu_has_sha;
+static pthread_once_t batch_once = PTHREAD_ONCE_INIT;
+
+/*Function to fingerprint chunks one after the other.
+Input:
+        DIGEST *(*digest)(vector_ptr, DIGEST *) : Fingerprint function
+        struct chunk_slice *slices : Chunks
+        DIGEST **digests        : Buffer for every fingerprint
+        int count               : Number of chunks
+Output:
+        int                     : 0 on success, -1 on failure
+*/
+static int
+batch_scalar(DIGEST *(*digest)(vector_ptr, DIGEST *),
+        const struct chunk_slice *slices, DIGEST **digests, int count)
+{
+
+        int             ret     =        0;
+        int             i       =        0;
+        struct vector   list;
+
+        vector_init(&list);
+        for (i = 0; i < count; i++) {
+                vector_reset(&list);
+                ret = vector_append(&list, (void *)slices[i].data,
+                        slices[i].length);
+                if (ret == -1)
+                        break;
+                if (digest(&list, digests[i]) == NULL) {
+                        ret = -1;
+                        break;
+                }
+        }
+        vector_free(&list);
+        return ret;
+
+}
+
+#ifdef HAVE_HASH_BATCH_AVX2
+/*A chunk being hashed in a lane. The whole 64 byte blocks are read from
+ the chunk, the last bytes, the padding and the length go to tail.
+        data        : Next whole block of the chunk
+        blocks      : Whole blocks left
+        tail_blocks : Blocks in tail, 1 or 2
+        tail_next   : Next block of tail
+        job         : Index of the chunk, -1 for an idle lane
+*/
+struct mb_lane
+{
+        const unsigned char *data;
+        size_t          blocks;
+        unsigned char   tail[128];
+        int             tail_blocks;
+        int             tail_next;
+        int             job;
+};
+
+static const unsigned char zero_block[64];
+
+/*Function to start hashing a chunk in a lane.
+Input:
+        struct mb_lane *lane    : Lane
+        struct chunk_slice *slice : Chunk
+        int job                 : Index of the chunk
+        int big_endian          : Store the bit length big endian (sha1)
+Output:
+        None
+*/
+static void
+lane_start(struct mb_lane *lane, const struct chunk_slice *slice, int job,
+        int big_endian)
+{
+
+        size_t          rem     =       slice->length % 64;
+        uint64_t        bits    =       (uint64_t)slice->length * 8;
+        int             i       =        0;
+
+        lane->data = (const unsigned char *)slice->data;
+        lane->blocks = slice->length / 64;
+        lane->tail_blocks = rem < 56 ? 1 : 2;
+        lane->tail_next = 0;
+        lane->job = job;
+        memset(lane->tail, 0, sizeof(lane->tail));
+        memcpy(lane->tail, lane->data + lane->blocks * 64, rem);
+        lane->tail[rem] = 0x80;
+        for (i = 0; i < 8; i++)
+                lane->tail[lane->tail_blocks * 64 - 1 - i] = big_endian ?
+                        bits >> (8 * i) : 0;
+        if (!big_endian)
+                for (i = 0; i < 8; i++)
+                        lane->tail[lane->tail_blocks * 64 - 8 + i] =
+                                bits >> (8 * i);
+
+}
+
+/*Function to get the next block of a lane.
+Input:
+        struct mb_lane *lane    : Lane
+Output:
+        const unsigned char *   : Block, a zero block for an idle lane
+*/
+static inline const unsigned char *
+lane_block(struct mb_lane *lane)
+{
+
+        const unsigned char *block      =       zero_block;
+
+        if (lane->job < 0)
+                return block;
+        if (lane->blocks > 0) {
+                block = lane->data;
+                lane->data += 64;
+                lane->blocks--;
+        } else {
+                block = lane->tail + 64 * lane->tail_next++;
+        }
+        return block;
+
+}
+
+/*Function to check whether a lane hashed the last block of its chunk.
+Input:
+        struct mb_lane *lane    : Lane
+Output:
+        int                     : 1 if done, 0 otherwise
+*/
+static inline int
+lane_done(const struct mb_lane *lane)
+{
+
+        return lane->job >= 0 && lane->blocks == 0 &&
+                lane->tail_next == lane->tail_blocks;
+
+}
+
+/*Function to transpose 8 rows of 8 32 bit words, row l of the input is
+ 8 words of lane l, row j of the output is word j of every lane.
+Input:
+        __m256i *r              : Rows
+Output:
+        None
+*/
+__attribute__((target("avx2")))
+static inline void
+transpose8(__m256i *r)
+{
+
+        __m256i t0, t1, t2, t3, t4, t5, t6, t7;
+        __m256i u0, u1, u2, u3, u4, u5, u6, u7;
+
+        t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+        t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+        t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+        t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+        t4 = _mm256_unpacklo_epi32(r[4], r[5]);
+        t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+        t6 = _mm256_unpacklo_epi32(r[6], r[7]);
+        t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+        u0 = _mm256_unpacklo_epi64(t0, t2);
+        u1 = _mm256_unpackhi_epi64(t0, t2);
+        u2 = _mm256_unpacklo_epi64(t1, t3);
+        u3 = _mm256_unpackhi_epi64(t1, t3);
+        u4 = _mm256_unpacklo_epi64(t4, t6);
+        u5 = _mm256_unpackhi_epi64(t4, t6);
+        u6 = _mm256_unpacklo_epi64(t5, t7);
+        u7 = _mm256_unpackhi_epi64(t5, t7);
+        r[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+        r[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+        r[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+        r[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+        r[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+        r[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+        r[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+        r[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+
+}
+
+/*Function to load one 64 byte block of every lane as 16 vectors of word j
+ of every lane.
+Input:
+        const unsigned char **blocks : Block of every lane
+        __m256i *w              : 16 words
+Output:
+        None
+*/
+__attribute__((target("avx2")))
+static inline void
+load_blocks(const unsigned char **blocks, __m256i *w)
+{
+
+        int             l       =        0;
+
+        for (l = 0; l < HASH_BATCH_LANES; l++) {
+                w[l] = _mm256_loadu_si256((const __m256i *)blocks[l]);
+                w[8 + l] = _mm256_loadu_si256(
+                        (const __m256i *)(blocks[l] + 32));
+        }
+        transpose8(w);
+        transpose8(w + 8);
+
+}
+
+#define ROTL(x, n)      _mm256_or_si256(_mm256_slli_epi32((x), (n)), \
+                                _mm256_srli_epi32((x), 32 - (n)))
+#define ADD(x, y)       _mm256_add_epi32((x), (y))
+#define XOR(x, y)       _mm256_xor_si256((x), (y))
+#define AND(x, y)       _mm256_and_si256((x), (y))
+#define OR(x, y)        _mm256_or_si256((x), (y))
+#define SET(x)          _mm256_set1_epi32((int)(x))
+
+/* MD5 round functions */
+#define MD5_F(b, c, d)  XOR((d), AND((b), XOR((c), (d))))
+#define MD5_G(b, c, d)  XOR((c), AND((d), XOR((b), (c))))
+#define MD5_H(b, c, d)  XOR(XOR((b), (c)), (d))
+#define MD5_I(b, c, d)  XOR((c), OR((b), XOR((d), SET(0xffffffff))))
+#define MD5_STEP(f, a, b, c, d, k, t, s) \
+        (a) = ADD((b), ROTL(ADD(ADD((a), f((b), (c), (d))), \
+                ADD(w[k], SET(t))), s))
+
+/*Function to hash one block of every lane with MD5.
+Input:
+        __m256i *state          : A, B, C, D of every lane
+        const unsigned char **blocks : Block of every lane
+Output:
+        None
+*/
+__attribute__((target("avx2")))
+static void
+md5_avx2_block(__m256i *state, const unsigned char **blocks)
+{
+
+        __m256i w[16];
+        __m256i a = state[0], b = state[1], c = state[2], d = state[3];
+
+        load_blocks(blocks, w);
+        MD5_STEP(MD5_F, a, b, c, d, 0, 0xd76aa478, 7);
+        MD5_STEP(MD5_F, d, a, b, c, 1, 0xe8c7b756, 12);
+        MD5_STEP(MD5_F, c, d, a, b, 2, 0x242070db, 17);
+        MD5_STEP(MD5_F, b, c, d, a, 3, 0xc1bdceee, 22);
+        MD5_STEP(MD5_F, a, b, c, d, 4, 0xf57c0faf, 7);
+        MD5_STEP(MD5_F, d, a, b, c, 5, 0x4787c62a, 12);
+        MD5_STEP(MD5_F, c, d, a, b, 6, 0xa8304613, 17);
+        MD5_STEP(MD5_F, b, c, d, a, 7, 0xfd469501, 22);
+        MD5_STEP(MD5_F, a, b, c, d, 8, 0x698098d8, 7);
+        MD5_STEP(MD5_F, d, a, b, c, 9, 0x8b44f7af, 12);
+        MD5_STEP(MD5_F, c, d, a, b, 10, 0xffff5bb1, 17);
+        MD5_STEP(MD5_F, b, c, d, a, 11, 0x895cd7be, 22);
+        MD5_STEP(MD5_F, a, b, c, d, 12, 0x6b901122, 7);
+        MD5_STEP(MD5_F, d, a, b, c, 13, 0xfd987193, 12);
+        MD5_STEP(MD5_F, c, d, a, b, 14, 0xa679438e, 17);
+        MD5_STEP(MD5_F, b, c, d, a, 15, 0x49b40821, 22);
+        MD5_STEP(MD5_G, a, b, c, d, 1, 0xf61e2562, 5);
+        MD5_STEP(MD5_G, d, a, b, c, 6, 0xc040b340, 9);
+        MD5_STEP(MD5_G, c, d, a, b, 11, 0x265e5a51, 14);
+        MD5_STEP(MD5_G, b, c, d, a, 0, 0xe9b6c7aa, 20);
+        MD5_STEP(MD5_G, a, b, c, d, 5, 0xd62f105d, 5);
+        MD5_STEP(MD5_G, d, a, b, c, 10, 0x02441453, 9);
+        MD5_STEP(MD5_G, c, d, a, b, 15, 0xd8a1e681, 14);
+        MD5_STEP(MD5_G, b, c, d, a, 4, 0xe7d3fbc8, 20);
+        MD5_STEP(MD5_G, a, b, c, d, 9, 0x21e1cde6, 5);
+        MD5_STEP(MD5_G, d, a, b, c, 14, 0xc33707d6, 9);
+        MD5_STEP(MD5_G, c, d, a, b, 3, 0xf4d50d87, 14);
+        MD5_STEP(MD5_G, b, c, d, a, 8, 0x455a14ed, 20);
+        MD5_STEP(MD5_G, a, b, c, d, 13, 0xa9e3e905, 5);
+        MD5_STEP(MD5_G, d, a, b, c, 2, 0xfcefa3f8, 9);
+        MD5_STEP(MD5_G, c, d, a, b, 7, 0x676f02d9, 14);
+        MD5_STEP(MD5_G, b, c, d, a, 12, 0x8d2a4c8a, 20);
+        MD5_STEP(MD5_H, a, b, c, d, 5, 0xfffa3942, 4);
+        MD5_STEP(MD5_H, d, a, b, c, 8, 0x8771f681, 11);
+        MD5_STEP(MD5_H, c, d, a, b, 11, 0x6d9d6122, 16);
+        MD5_STEP(MD5_H, b, c, d, a, 14, 0xfde5380c, 23);
+        MD5_STEP(MD5_H, a, b, c, d, 1, 0xa4beea44, 4);
+        MD5_STEP(MD5_H, d, a, b, c, 4, 0x4bdecfa9, 11);
+        MD5_STEP(MD5_H, c, d, a, b, 7, 0xf6bb4b60, 16);
+        MD5_STEP(MD5_H, b, c, d, a, 10, 0xbebfbc70, 23);
+        MD5_STEP(MD5_H, a, b, c, d, 13, 0x289b7ec6, 4);
+        MD5_STEP(MD5_H, d, a, b, c, 0, 0xeaa127fa, 11);
+        MD5_STEP(MD5_H, c, d, a, b, 3, 0xd4ef3085, 16);
+        MD5_STEP(MD5_H, b, c, d, a, 6, 0x04881d05, 23);
+        MD5_STEP(MD5_H, a, b, c, d, 9, 0xd9d4d039, 4);
+        MD5_STEP(MD5_H, d, a, b, c, 12, 0xe6db99e5, 11);
+        MD5_STEP(MD5_H, c, d, a, b, 15, 0x1fa27cf8, 16);
+        MD5_STEP(MD5_H, b, c, d, a, 2, 0xc4ac5665, 23);
+        MD5_STEP(MD5_I, a, b, c, d, 0, 0xf4292244, 6);
+        MD5_STEP(MD5_I, d, a, b, c, 7, 0x432aff97, 10);
+        MD5_STEP(MD5_I, c, d, a, b, 14, 0xab9423a7, 15);
+        MD5_STEP(MD5_I, b, c, d, a, 5, 0xfc93a039, 21);
+        MD5_STEP(MD5_I, a, b, c, d, 12, 0x655b59c3, 6);
+        MD5_STEP(MD5_I, d, a, b, c, 3, 0x8f0ccc92, 10);
+        MD5_STEP(MD5_I, c, d, a, b, 10, 0xffeff47d, 15);
+        MD5_STEP(MD5_I, b, c, d, a, 1, 0x85845dd1, 21);
+        MD5_STEP(MD5_I, a, b, c, d, 8, 0x6fa87e4f, 6);
+        MD5_STEP(MD5_I, d, a, b, c, 15, 0xfe2ce6e0, 10);
+        MD5_STEP(MD5_I, c, d, a, b, 6, 0xa3014314, 15);
+        MD5_STEP(MD5_I, b, c, d, a, 13, 0x4e0811a1, 21);
+        MD5_STEP(MD5_I, a, b, c, d, 4, 0xf7537e82, 6);
+        MD5_STEP(MD5_I, d, a, b, c, 11, 0xbd3af235, 10);
+        MD5_STEP(MD5_I, c, d, a, b, 2, 0x2ad7d2bb, 15);
+        MD5_STEP(MD5_I, b, c, d, a, 9, 0xeb86d391, 21);
+        state[0] = ADD(state[0], a);
+        state[1] = ADD(state[1], b);
+        state[2] = ADD(state[2], c);
+        state[3] = ADD(state[3], d);
+
+}
+
+/* SHA1 round functions */
+#define SHA1_CH(b, c, d)        XOR((d), AND((b), XOR((c), (d))))
+#define SHA1_PARITY(b, c, d)    XOR(XOR((b), (c)), (d))
+#define SHA1_MAJ(b, c, d)       OR(AND((b), (c)), AND((d), OR((b), (c))))
+#define SHA1_STEP(f, k) \
+        do { \
+                if (i >= 16) \
+                        w[i & 15] = ROTL(XOR(XOR(w[(i - 3) & 15], \
+                                w[(i - 8) & 15]), XOR(w[(i - 14) & 15], \
+                                w[i & 15])), 1); \
+                t = ADD(ADD(ROTL(a, 5), f(b, c, d)), \
+                        ADD(ADD(e, SET(k)), w[i & 15])); \
+                e = d; \
+                d = c; \
+                c = ROTL(b, 30); \
+                b = a; \
+                a = t; \
+        } while (0)
+
+/*Function to hash one block of every lane with SHA1.
+Input:
+        __m256i *state          : A, B, C, D, E of every lane
+        const unsigned char **blocks : Block of every lane
+Output:
+        None
+*/
+__attribute__((target("avx2")))
+static void
+sha1_avx2_block(__m256i *state, const unsigned char **blocks)
+{
+
+        __m256i w[16];
+        __m256i a = state[0], b = state[1], c = state[2], d = state[3];
+        __m256i e = state[4], t;
+        const __m256i bswap = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4,
+                11, 10, 9, 8, 15, 14, 13, 12, 3, 2, 1, 0, 7, 6, 5, 4,
+                11, 10, 9, 8, 15, 14, 13, 12);
+        int     i       =       0;
+
+        load_blocks(blocks, w);
+        for (i = 0; i < 16; i++)
+                w[i] = _mm256_shuffle_epi8(w[i], bswap);
+        for (i = 0; i < 20; i++)
+                SHA1_STEP(SHA1_CH, 0x5a827999);
+        for (; i < 40; i++)
+                SHA1_STEP(SHA1_PARITY, 0x6ed9eba1);
+        for (; i < 60; i++)
+                SHA1_STEP(SHA1_MAJ, 0x8f1bbcdc);
+        for (; i < 80; i++)
+                SHA1_STEP(SHA1_PARITY, 0xca62c1d6);
+        state[0] = ADD(state[0], a);
+        state[1] = ADD(state[1], b);
+        state[2] = ADD(state[2], c);
+        state[3] = ADD(state[3], d);
+        state[4] = ADD(state[4], e);
+
+}
+
+/*Function to run a multi-buffer kernel over a batch. Every lane hashes one
+ chunk, a lane that finished its chunk takes the next one, so chunks of
+ different lengths keep all lanes busy until the batch runs out.
+Input:
+        void (*block)(__m256i *, const unsigned char **) : Block function
+        const uint32_t *iv      : Initial state
+        int words               : Words of state
+        int big_endian          : Words are stored big endian (sha1)
+        struct chunk_slice *slices : Chunks
+        DIGEST **digests        : Buffer for every fingerprint
+        int count               : Number of chunks
+Output:
+        None
+*/
+__attribute__((target("avx2")))
+static void
+batch_avx2(void (*block)(__m256i *, const unsigned char **),
+        const uint32_t *iv, int words, int big_endian,
+        const struct chunk_slice *slices, DIGEST **digests, int count)
+{
+
+        struct mb_lane  lanes[HASH_BATCH_LANES];
+        const unsigned char *blocks[HASH_BATCH_LANES];
+        uint32_t        st[5][HASH_BATCH_LANES] __attribute__((aligned(32)));
+        __m256i         state[5];
+        uint32_t        word            =       0;
+        int             next            =       0;
+        int             active          =       0;
+        int             l               =       0;
+        int             j               =       0;
+
+        for (l = 0; l < HASH_BATCH_LANES; l++) {
+                lanes[l].job = -1;
+                if (next < count) {
+                        lane_start(&lanes[l], &slices[next], next,
+                                big_endian);
+                        next++;
+                        active++;
+                }
+                for (j = 0; j < words; j++)
+                        st[j][l] = iv[j];
+        }
+        for (j = 0; j < words; j++)
+                state[j] = _mm256_load_si256((const __m256i *)st[j]);
+        while (active > 0) {
+                for (l = 0; l < HASH_BATCH_LANES; l++)
+                        blocks[l] = lane_block(&lanes[l]);
+                block(state, blocks);
+                for (l = 0; l < HASH_BATCH_LANES; l++)
+                        if (lane_done(&lanes[l]))
+                                break;
+                if (l == HASH_BATCH_LANES)
+                        continue;
+                /* Some lane is done, take its digest and refill it */
+                for (j = 0; j < words; j++)
+                        _mm256_store_si256((__m256i *)st[j], state[j]);
+                for (l = 0; l < HASH_BATCH_LANES; l++) {
+                        if (!lane_done(&lanes[l]))
+                                continue;
+                        for (j = 0; j < words; j++) {
+                                word = st[j][l];
+                                if (big_endian)
+                                        word = __builtin_bswap32(word);
+                                memcpy(digests[lanes[l].job] + 4 * j, &word,
+                                        sizeof(word));
+                                st[j][l] = iv[j];
+                        }
+                        lanes[l].job = -1;
+                        active--;
+                        if (next < count) {
+                                lane_start(&lanes[l], &slices[next], next,
+                                        big_endian);
+                                next++;
+                                active++;
+                        }
+                }
+                for (j = 0; j < words; j++)
+                        state[j] = _mm256_load_si256((const __m256i *)st[j]);
+        }
+
+}
+
+static const uint32_t md5_iv[4] = {
+        0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476
+};
+
+static const uint32_t sha1_iv[5] = {
+        0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0
+};
+#endif
+
+/*Function to select the batch hashing kernel.
+Input:
+        int kernel              : hash_batch_kernel
+Output:
+        int                     : 0 on success, -1 if the CPU lacks it
+*/
+int
+hash_batch_set_kernel(int kernel)
+{
+
+        int     ret     =       -1;
+
+        switch (kernel) {
+        case HASH_BATCH_AUTO:
+#ifdef HAVE_HASH_BATCH_AVX2
+                if (__builtin_cpu_supports("avx2")) {
+                        ret = hash_batch_set_kernel(HASH_BATCH_AVX2);
+                        break;
+                }
+#endif
+                ret = hash_batch_set_kernel(HASH_BATCH_SCALAR);
+                break;
+        case HASH_BATCH_SCALAR:
+                batch_kernel = HASH_BATCH_SCALAR;
+                batch_kernel_name = "scalar";
+                ret = 0;
+                break;
+#ifdef HAVE_HASH_BATCH_AVX2
+        case HASH_BATCH_AVX2:
+                if (!__builtin_cpu_supports("avx2"))
+                        break;
+                batch_kernel = HASH_BATCH_AVX2;
+                batch_kernel_name = "avx2";
+                ret = 0;
+                break;
+#endif
+        default:
+                break;
+        }
+        return ret;
+
+}
+
+/*Function to pick the fastest kernel on first use. A kernel set explicitly
+ before is kept.
+Input:
+        None
+Output:
+        None
+*/
+static void
+batch_select(void)
+{
+
+#ifdef HAVE_HASH_BATCH_AVX2
+        unsigned int    eax = 0, ebx = 0, ecx = 0, edx = 0;
+
+        if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+                cpu_has_sha = (ebx & bit_SHA) != 0;
+#endif
+        if (batch_kernel_name == NULL)
+                hash_batch_set_kernel(HASH_BATCH_AUTO);
+
+}
+
+/*Function to get the name of the selected batch hashing kernel.
+Input:
+        None
+Output:
+        const char *            : Name of the kernel
+*/
+const char *
+hash_batch_kernel_name(void)
+{
+
+        pthread_once(&batch_once, batch_select);
+        return batch_kernel_name;
+
+}
+
+/*Function to fingerprint many chunks with md5.
+Input:
+        struct chunk_slice *slices : Chunks
+        DIGEST **digests        : 16 byte buffer for every fingerprint
+        int count               : Number of chunks
+Output:
+        int                     : 0 on success, -1 on failure
+*/
+int
+md5_batch(const struct chunk_slice *slices, DIGEST **digests, int count)
+{
+
+        pthread_once(&batch_once, batch_select);
+#ifdef HAVE_HASH_BATCH_AVX2
+        if (batch_kernel == HASH_BATCH_AVX2 && count > 1) {
+                batch_avx2(md5_avx2_block, md5_iv, 4, 0, slices, digests,
+                        count);
+                return 0;
+        }
+#endif
+        return batch_scalar(str2md5, slices, digests, count);
+
+}
+
+/*Function to fingerprint many chunks with sha1.
+Input:
+        struct chunk_slice *slices : Chunks
+        DIGEST **digests        : 20 byte buffer for every fingerprint
+        int count               : Number of chunks
+Output:
+        int                     : 0 on success, -1 on failure
+*/
+int
+sha1_batch(const struct chunk_slice *slices, DIGEST **digests, int count)
+{
+
+        pthread_once(&batch_once, batch_select);
+#ifdef HAVE_HASH_BATCH_AVX2
+        if (batch_kernel == HASH_BATCH_AVX2 && count > 1 && !cpu_has_sha) {
+                batch_avx2(sha1_avx2_block, sha1_iv, 5, 1, slices, digests,
+                        count);
+                return 0;
+        }
+#endif
+        return batch_scalar(sha1, slices, digests, count);
+
+}
+
+/*Function to fingerprint many chunks at once.
+Input:
+        const struct hash_provider *hash : Fingerprint algorithm
+        struct chunk_slice *slices : Chunks
+        DIGEST **digests        : Buffer for every fingerprint
+        int count               : Number of chunks
+Output:
+        int                     : 0 on success, -1 on failure
+*/
+int
+hash_batch(const struct hash_provider *hash, const struct chunk_slice *slices,
+        DIGEST **digests, int count)
+{
+
+        if (count <= 0)
+                return 0;
+        if (hash->digest_batch != NULL)
+                return hash->digest_batch(slices, digests, count);
+        return batch_scalar(hash->digest, slices, digests, count);
+
+}
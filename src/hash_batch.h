@@ -0,0 +1,54 @@
+#ifndef __HASH_BATCH_H__
+#define __HASH_BATCH_H__
+
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<stdint.h>
+#include "fingerprint.h"
+#include "Rabin_Karp.h"
+
+/* Chunks hashed side by side by the AVX2 kernels, one per 32 bit lane */
+#define HASH_BATCH_LANES        8
+
+enum hash_batch_kernel {HASH_BATCH_AUTO, HASH_BATCH_SCALAR, HASH_BATCH_AVX2};
+
+/*@description:Function to select the batch hashing kernel. HASH_BATCH_AUTO
+picks the fastest one the CPU supports.
+@in: int kernel-hash_batch_kernel
+@out: int
+@return: -1 if the CPU does not support the kernel and 0 otherwise */
+int hash_batch_set_kernel(int kernel);
+
+/*@description:Function to get the name of the selected batch hashing kernel
+@in: void
+@out: const char *
+@return: name of the kernel */
+const char *hash_batch_kernel_name(void);
+
+/*@description:Function to fingerprint many chunks at once. Algorithms with
+a multi-buffer kernel interleave HASH_BATCH_LANES chunks per instruction
+stream, the others hash one chunk after the other. The digests are the
+same as fingerprinting every chunk on its own.
+@in: const struct hash_provider *hash-fingerprint algorithm, const struct
+chunk_slice *slices-chunks, int count-number of chunks
+@out: DIGEST **digests-digest_len byte buffer for every chunk
+@return: -1 for error and 0 on success */
+int hash_batch(const struct hash_provider *hash,
+        const struct chunk_slice *slices, DIGEST **digests, int count);
+
+/*@description:Function to fingerprint many chunks with md5, the
+digest_batch of the md5 provider
+@in: const struct chunk_slice *slices-chunks, int count-number of chunks
+@out: DIGEST **digests-16 byte buffer for every chunk
+@return: -1 for error and 0 on success */
+int md5_batch(const struct chunk_slice *slices, DIGEST **digests, int count);
+
+/*@description:Function to fingerprint many chunks with sha1, the
+digest_batch of the sha1 provider
+@in: const struct chunk_slice *slices-chunks, int count-number of chunks
+@out: DIGEST **digests-20 byte buffer for every chunk
+@return: -1 for error and 0 on success */
+int sha1_batch(const struct chunk_slice *slices, DIGEST **digests, int count);
+
+#endif
@@ -0,0 +1,137 @@
+#include "hash_batch.h"
+#include "store_format.h"
+#include <time.h>
+
+#define BENCH_SIZE      (64 << 20)
+#define BENCH_ROUNDS    5
+#define BENCH_BATCH     256
+
+/*Function to fingerprint every chunk of the buffer BENCH_BATCH at a time,
+ the way the dedup pipeline does.
+Input:
+        const struct hash_provider *hash : Fingerprint algorithm
+        struct chunk_slice *slices : Chunks
+        DIGEST **digests        : Buffer for every fingerprint
+        int count               : Number of chunks
+Output:
+        int                     : 0 on success, -1 on failure
+*/
+static int
+hash_all(const struct hash_provider *hash, const struct chunk_slice *slices,
+        DIGEST **digests, int count)
+{
+
+        int             i       =       0;
+        int             n       =       0;
+
+        for (i = 0; i < count; i += BENCH_BATCH) {
+                n = count - i < BENCH_BATCH ? count - i : BENCH_BATCH;
+                if (hash_batch(hash, slices + i, digests + i, n) == -1)
+                        return -1;
+        }
+        return 0;
+
+}
+
+/*Microbenchmark of the batch hashing kernels. A random buffer is cut into
+ chunks of 2 KiB to 14 KiB, 8 KiB on average, and fingerprinted by every
+ kernel the CPU supports. The digests have to match the scalar kernel.*/
+int
+main (int argc, char *argv[])
+{
+
+        int             ret             =       -1;
+        int             kernel          =       0;
+        int             algo            =       0;
+        int             round           =       0;
+        int             count           =       0;
+        int             i               =       0;
+        size_t          pos             =       0;
+        size_t          length          =       0;
+        double          secs            =       0;
+        double          best_secs       =       0;
+        char            *data           =       NULL;
+        DIGEST          *buf            =       NULL;
+        DIGEST          *ref            =       NULL;
+        DIGEST          **digests       =       NULL;
+        struct chunk_slice *slices      =       NULL;
+        const struct hash_provider *hash =      NULL;
+        struct timespec t0, t1;
+        const int       kernels[]       =       {HASH_BATCH_SCALAR,
+                                                 HASH_BATCH_AVX2};
+        const char      *algos[]        =       {"md5", "sha1"};
+
+        data = (char *)malloc(BENCH_SIZE);
+        count = BENCH_SIZE / 2048;
+        slices = (struct chunk_slice *)calloc(count,
+                sizeof(struct chunk_slice));
+        digests = (DIGEST **)calloc(count, sizeof(DIGEST *));
+        buf = (DIGEST *)calloc(count, MAX_DIGEST_LEN);
+        ref = (DIGEST *)calloc(count, MAX_DIGEST_LEN);
+        if (data == NULL || slices == NULL || digests == NULL ||
+                buf == NULL || ref == NULL) {
+                fprintf(stderr, "Error in buffer allocation\n");
+                goto out;
+        }
+        srandom(argc > 1 ? atoi(argv[1]) : 1);
+        for (pos = 0; pos < BENCH_SIZE; pos++)
+                data[pos] = random();
+        for (pos = 0, count = 0; pos < BENCH_SIZE; pos += length) {
+                length = 2048 + random() % 12289;
+                if (length > BENCH_SIZE - pos)
+                        length = BENCH_SIZE - pos;
+                slices[count].data = data + pos;
+                slices[count].length = length;
+                slices[count].offset = pos;
+                digests[count] = buf + (size_t)count * MAX_DIGEST_LEN;
+                count++;
+        }
+        for (algo = 0; algo < 2; algo++) {
+                hash = get_hash_provider(algos[algo]);
+                for (kernel = 0; kernel < 2; kernel++) {
+                        if (hash_batch_set_kernel(kernels[kernel]) == -1)
+                                continue;
+                        best_secs = 0;
+                        for (round = 0; round < BENCH_ROUNDS; round++) {
+                                clock_gettime(CLOCK_MONOTONIC, &t0);
+                                if (hash_all(hash, slices, digests,
+                                        count) == -1)
+                                        goto out;
+                                clock_gettime(CLOCK_MONOTONIC, &t1);
+                                secs = (t1.tv_sec - t0.tv_sec) +
+                                        (t1.tv_nsec - t0.tv_nsec) / 1e9;
+                                if (best_secs == 0 || secs < best_secs)
+                                        best_secs = secs;
+                        }
+                        if (kernels[kernel] == HASH_BATCH_SCALAR) {
+                                memcpy(ref, buf, (size_t)count *
+                                        MAX_DIGEST_LEN);
+                        } else {
+                                for (i = 0; i < count; i++)
+                                        if (memcmp(digests[i], ref +
+                                                (size_t)i * MAX_DIGEST_LEN,
+                                                hash->digest_len) != 0)
+                                                break;
+                                if (i < count) {
+                                        fprintf(stderr, "%s %s: digest of "
+                                                "chunk %d differs from "
+                                                "scalar\n", hash->name,
+                                                hash_batch_kernel_name(), i);
+                                        goto out;
+                                }
+                        }
+                        printf("%-5s %-8s %8d chunks %8.1f MB/s\n",
+                                hash->name, hash_batch_kernel_name(), count,
+                                BENCH_SIZE / best_secs / (1 << 20));
+                }
+        }
+        ret = 0;
+out:
+        free(data);
+        free(slices);
+        free(digests);
+        free(buf);
+        free(ref);
+        return ret ? 1 : 0;
+
+}
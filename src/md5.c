@@ -1,28 +1,14 @@
 #include "md5.h"
 #include "vector.h"
+#include "fingerprint.h"
 
 /*Function to implement md5.
-Input:char *buffer
+Input:vector_ptr list, DIGEST *digest - 16 byte buffer for the fingerprint
 Output:DIGEST
 */
-DIGEST *str2md5(vector_ptr list)
+DIGEST *str2md5(vector_ptr list, DIGEST *digest)
 {
 
-        MD5_CTX c;
-        DIGEST *digest = (DIGEST *)calloc(1, 16);
-        vector_ptr temp_node;
-
-        if (list != NULL) {
-                MD5_Init(&c);
-                temp_node = list;
-                do {
-                        MD5_Update(&c, temp_node->vector_element,
-                                temp_node->length);
-                        temp_node = temp_node->next;
-                } while (temp_node != NULL);
-
-                MD5_Final(digest, &c);
-        }
-        return digest;
+        return evp_digest(EVP_md5(), list, digest);
 
 }
\ No newline at end of file
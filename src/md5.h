@@ -19,7 +19,7 @@ typedef struct vector *vector_ptr;
 typedef unsigned char DIGEST;
 
 /*Function to implement md5.
-Input:char *buffer - String to be encrypted
-Output:char* - 16 byte char.
+Input:vector_ptr list - Chunk to be hashed, DIGEST *digest - 16 byte buffer
+Output:DIGEST* - digest
 */
-DIGEST *str2md5(vector_ptr list);
+DIGEST *str2md5(vector_ptr list, DIGEST *digest);
@@ -8,6 +8,8 @@
 #include "ldb.h"
 #include "namespace.h"
 #include "catalog.h"
+#include "fingerprint.h"
+#include "store_format.h"
 
 /*Function to generate minhash
 Input:
@@ -196,13 +198,15 @@ Input:
         int *count        : keeps track of segment id
         int fd_stub       : File discriptor of stub
         int threshold_similarity : Percentage of similarity between segments.
+        struct arena *arena : Scratch memory of the dedup session
 Output:
         int ret           : -1 on failure and 0 on success
 */
 int insert_into_segment(vector_ptr list, int *chunk_count, DIGEST *digest,
 int hash_length, int seg_length, int *count, int size, int threshold_similarity,
 int no_of_prime, char *type, namespace_dtl namespace_input, int length,
-char **high_similarity_seg, int *similarity, int *high_seg_len)
+char **high_similarity_seg, int *similarity, int *high_seg_len,
+struct arena *arena)
 {
 
         int ret                 =         -1;
@@ -210,7 +214,6 @@ char **high_similarity_seg, int *similarity, int *high_seg_len)
         int fd_hash             =         -1;
         int off                 =         -1;
         DIR *dp                 =       NULL;
-        vector_ptr temp_node    =       NULL;
         char *hash              =       NULL;
         char store[1024];
 
@@ -232,7 +235,7 @@ char **high_similarity_seg, int *similarity, int *high_seg_len)
 
         sprintf(store, "%s_hash", store);
         fd_hash = open (store, O_CREAT|O_RDWR|O_APPEND, S_IWUSR|S_IRUSR);
-        hash = parse(digest, hash_length);
+        hash = parse_arena(arena, digest, hash_length);
         if(hash == NULL) {
                 ret = -1;
                 goto out;
@@ -248,29 +251,22 @@ char **high_similarity_seg, int *similarity, int *high_seg_len)
                         if (length <= 0) {
                                 goto out;
                         }
-                        if (write (fd_input, &length, int_size) == -1) {
+                        if (list == NULL) {
                                 fprintf(stderr, "%s\n", strerror(errno));
                                 goto out;
+                                
                         }
-                        off = lseek(fd_input, 1, SEEK_CUR);
+                        /* The segment is opened for appending, the offset
+                         * recorded is one past the end of the length */
+                        off = lseek(fd_input, 0, SEEK_END);
                         if (off == -1)
                                 goto out;
-                        if (list == NULL) {
+                        off += int_size + 1;
+                        if (vector_writev(fd_input, list, &length,
+                                int_size) == -1) {
                                 fprintf(stderr, "%s\n", strerror(errno));
                                 goto out;
-                                
                         }
-
-                        do {
-                                temp_node = list;
-                                if (-1 == write(fd_input, temp_node->vector_element,
-                                        temp_node->length)) {
-                                        fprintf(stderr, "%s\n", strerror(errno));
-                                        goto out;
-                                }
-                                list = list->next;
-                                free(temp_node);
-                        } while (list != NULL);
                 }
                 if (fd_input)
                         close(fd_input);
@@ -279,11 +275,6 @@ char **high_similarity_seg, int *similarity, int *high_seg_len)
                         fprintf(stderr, "Error in creating segment hash file\n");
                         goto out;
                 } else {
-                        hash = parse(digest, hash_length);
-                        if(hash == NULL) {
-                                ret = -1;
-                                goto out;
-                        }
                         length = strlen(hash);
                         if (write (fd_hash, &length, int_size) == -1) {
                                 printf("\nWrite failed with error%s\n",
@@ -305,8 +296,6 @@ char **high_similarity_seg, int *similarity, int *high_seg_len)
                         close(fd_hash);
         }
 
-        clean_buff(&hash);
-
         *chunk_count = *chunk_count + 1;
         if(strcmp(type,"default") == 0) {
                 ret = cal_minhash (digest, hash_length, seg_length, *chunk_count, size,
@@ -418,8 +407,6 @@ minhash_config minhash_config_dtl)
         int fd_input    =       -1;
         int chunk_count =        0;
         int hash_length =        0;
-        int chunk_flag  =        0;
-        int chunk_length=        0;
         int count       =        0;
         int fd_stub     =        0;
         int seg_length  =        0;
@@ -434,7 +421,6 @@ minhash_config minhash_config_dtl)
         char *ts1       =     NULL;
         char *filename  =     NULL;
         char *type      =     NULL;
-        char *chunk_buffer =  NULL;
         char *hash      =     NULL;
         char *high_similarity_seg = NULL;
         char segment_id[1024];
@@ -442,8 +428,25 @@ minhash_config minhash_config_dtl)
         vector_ptr list =     NULL;
         DIGEST *digest  =     NULL;
         void *buffer    =     NULL;
+        struct chunker *chunker = NULL;
+        struct chunk_slice slice;
+        struct vector chunk;
+        DIGEST digest_buf[MAX_DIGEST_LEN];
         struct stat st;
-
+        struct arena arena;
+        struct arena_mark mark;
+        struct catalog_entry entry;
+        const struct hash_provider *provider = NULL;
+
+        vector_init(&chunk);
+        memset(&entry, 0, sizeof(entry));
+        arena_init(&arena, 0);
+        provider = get_hash_provider(namespace_input.hash_type);
+        if (provider == NULL) {
+                fprintf(stderr, "Unknown hash type %s\n",
+                        namespace_input.hash_type);
+                goto out;
+        }
         seg_length      =        minhash_config_dtl.seg_length;
         no_of_prime     =        minhash_config_dtl.no_of_prime;
         threshold_similarity = minhash_config_dtl.threshold_similarity;
@@ -461,7 +464,9 @@ minhash_config minhash_config_dtl)
                 goto out;
         }
         
-        ts1 = strdup(path);
+        ts1 = arena_strdup(&arena, path);
+        if (ts1 == NULL)
+                goto out;
         filename = basename(ts1);
         fd_input = open (path, O_RDONLY, S_IRUSR|S_IWUSR);
         if(fd_input < 0) {
@@ -476,30 +481,44 @@ minhash_config minhash_config_dtl)
                 }
                 fstat(fd_input, &st);
                 size = st.st_size;
+                chunker = create_chunker(NULL);
+                if (chunker == NULL) {
+                        ret = -1;
+                        goto out;
+                }
+                chunker_feed(chunker, fd_input);
+                arena_mark(&arena, &mark);
                 while(1) {
-                        chunk_flag = 0;
-                        list = NULL;
+                        /* Hex hashes of the previous chunk go back to
+                         * the arena */
+                        arena_release(&arena, &mark);
                         b_offset = e_offset;
-                        while (chunk_flag == 0) {
-                                chunk_buffer = get_variable_chunk(fd_input,
-                                        &ret, &size, &chunk_flag, &chunk_length);
-                                if (ret == -1) {
-                                        fprintf (stderr,
-                                                "Error in variable chunking\n");
-                                        goto out;
-                                }
-                                list = insert_vector_element(chunk_buffer, list,
-                                        &ret, chunk_length);
-                                length += chunk_length;
-                                if (ret == -1)
-                                        goto out;
+                        ret = chunker_next(chunker, &slice);
+                        if (ret == -1) {
+                                fprintf (stderr,
+                                        "Error in variable chunking\n");
+                                goto out;
                         }
+                        if (ret == 0)
+                                break;
+                        vector_reset(&chunk);
+                        ret = vector_append(&chunk, (void *)slice.data,
+                                slice.length);
+                        if (ret == -1)
+                                goto out;
+                        list = &chunk;
+                        length = slice.length;
+                        size = st.st_size - (slice.offset + slice.length);
                         e_offset += length - 1;
-                        digest = str2md5(list);
-                        
-                        hash_length = MD5_DIGEST_LENGTH;
+                        entry.chunks++;
+                        digest = provider->digest(list, digest_buf);
+                        if (digest == NULL) {
+                                ret = -1;
+                                goto out;
+                        }
+                        hash_length = provider->digest_len;
 
-                        hash = parse(digest, hash_length);
+                        hash = parse_arena(&arena, digest, hash_length);
                         if(hash == NULL) {
                                 ret = -1;
                                 goto out;
@@ -510,7 +529,7 @@ minhash_config minhash_config_dtl)
                                 buff_counter = 0;
                                 buffer = (void *)calloc(seg_length,
                                 sizeof(int)+strlen(segment_id)+sizeof(int)+
-                                hash_length+2*sizeof(int));
+                                2*hash_length+2*sizeof(int));
                         }
                         memcpy(buffer+buff_counter, &temp_len, sizeof(int));
                         buff_counter+= sizeof(int);
@@ -529,7 +548,8 @@ minhash_config minhash_config_dtl)
                         ret = insert_into_segment(list, &chunk_count, digest,
                         hash_length, seg_length, &count, size, threshold_similarity,
                         no_of_prime, type, namespace_input, length,
-                        &high_similarity_seg, &similarity, &high_seg_len);
+                        &high_similarity_seg, &similarity, &high_seg_len,
+                        &arena);
                         if(chunk_count == 0 || size == 0) {
                                 ret = write_to_minhash_stub(buffer,
                                 high_similarity_seg, threshold_similarity,
@@ -548,13 +568,20 @@ minhash_config minhash_config_dtl)
                         }
                 }
         }
-        sprintf(hash,"%d",count);
-        write_to_db("Count",hash);
-        ret = writecatalog(path);
+        if (hash != NULL) {
+                sprintf(segment_id,"%d",count);
+                write_to_db("Count",segment_id);
+        }
+        entry.size = st.st_size;
+        snprintf(entry.stub, sizeof(entry.stub), "%s", filename);
+        ret = writecatalog(path, &entry);
         if (ret == -1)
                 goto out;
         ret = 0;
 out:
+        arena_destroy(&arena);
+        vector_free(&chunk);
+        destroy_chunker(&chunker);
         close(fd_input);
         return ret;
 
@@ -6,6 +6,7 @@
 #include <libgen.h>
 #include <getopt.h>
 #include <leveldb/c.h>
+#include "arena.h"
 
 typedef unsigned int MIN_HASH;
 
@@ -60,13 +61,15 @@ Input:
         int *count        : keeps track of segment id
         int fd_stub       : File discriptor of stub
         int threshold_similarity : Percentage of similarity between segments.
+        struct arena *arena : Scratch memory of the dedup session
 Output:
         int ret           : -1 on failure and 0 on success
 */
 int insert_into_segment(vector_ptr list, int *chunk_count, DIGEST *digest,
 int hash_length, int seg_length, int *count, int size, int threshold_similarity,
 int no_of_prime, char *type, namespace_dtl namespace_input, int length,
-char **high_similarity_seg, int *similarity, int *high_seg_len);
+char **high_similarity_seg, int *similarity, int *high_seg_len,
+struct arena *arena);
 
 /*@description:Function to generate minhash using XOR
 Input:
@@ -86,11 +89,12 @@ int chunk_count, int size, int count, int no_of_prime, int threshold_similarity,
 /*@description: Function to dedup the file .
 Input:
         namespace_dtl namespace_input : Takes of the information of namespace
-        char *file_path : Path of the file to be deduped
+        char *file_path : Path of the file to be deduped, "-" for stdin
+        char *name : Name the file is cataloged under, NULL for its path
 Output:
         int : Return 0 on success -1 on failure.
 */
-int dedup_file (namespace_dtl namespace_input,char *file_path);
+int dedup_file (namespace_dtl namespace_input,char *file_path,char *name);
 
 int create_extended_seg( char *high_similarity_seg,char *seg_name,namespace_dtl namespace_input);
 
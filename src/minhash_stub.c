@@ -65,7 +65,8 @@ out:
 
 }
 
-/*Function to get the block from blockstore.
+/*Function to get the block from blockstore. The position of a block is
+one past the offset of its payload, its length is stored just before it.
 Input:int pos
 Output:char*
 */
@@ -73,61 +74,32 @@ char*
 get_minhash_block(int pos, int fd_block, int *l)
 {
 
-        struct stat                     st;
-        int     size     =               0;
         int    length    =               0;
         int     ret      =               -1;
         char    *buffer   =               NULL;
-        int     position =               1;
 
-        fstat(fd_block, &st);
-        size = st.st_size;
-        /*rewind the stream pointer to the start of block file*/
-        if (size > 0) {
-                if (-1 == lseek(fd_block, 0, SEEK_SET)) {
-                        printf("\nLseek failed with error: [%s]\n",strerror(errno));
-                        goto out;
-                }
+        ret = pread(fd_block, &length, sizeof(int), pos - 1 - sizeof(int));
+        if (ret != sizeof(int) || length <= 0) {
+                printf("\nError while reading %s",strerror(errno));
+                ret = -1;
+                goto out;
         }
-        while (size > 0) {
-                ret = read(fd_block, &length, sizeof(int));
-                *l = length;
-                if (ret == -1) {
-                        printf("\nError while reading %s",strerror(errno));
-                        goto out;
-                }
-                position = position+ret;
-                if (length <= 0) {
-                        goto out;
-                }
-                buffer = (char *)calloc(1, length+1);
-
-                if (position == pos) {
-                        ret = read(fd_block, buffer, length);
-                        if (ret == -1) {
-                                printf("\nRead failed with error %s\n",strerror(errno));
-                                goto out;
-                        }
-                        ret = 0;
-                        buffer[length] = '\0';
-                        break;
-                }
-                ret = read(fd_block, buffer, length);
-                if (ret == -1) {
-                        printf("\nRead failed with error %s\n",strerror(errno));
-                        goto out;
-                }
-                position = position + length;
-                buffer[length] = '\0';
-                size -= (length+sizeof(int));
-                free(buffer);
-
+        buffer = (char *)calloc(1, length+1);
+        if (buffer == NULL) {
+                ret = -1;
+                goto out;
         }
+        ret = pread(fd_block, buffer, length, pos - 1);
+        if (ret != length) {
+                printf("\nRead failed with error %s\n",strerror(errno));
+                ret = -1;
+                goto out;
+        }
+        *l = length;
         ret = 0;
 out:
-        if (ret == -1) {
-                memset(buffer, 0, length+1);
-        }
+        if (ret == -1)
+                clean_buff(&buffer);
         return buffer;
 }
 
@@ -174,7 +146,7 @@ delete_minhash_stub(char *path, char *filename)
         DIR *dp = NULL;
         char stub_path[1024];
 
-        ret = reset_catalog(filename, path);
+        ret = reset_catalog(filename, NULL);
         if(ret == -1) {
                 goto out;
         }
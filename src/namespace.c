@@ -5,6 +5,11 @@
 #include "restore.h"
 #include "stub.h"
 #include "minhash_restore.h"
+#include "convert.h"
+#include "container.h"
+#include "pack.h"
+#include "fingerprint.h"
+#include "restore_cache.h"
 
 
 /*Function to to give correct instruction to use the various information.
@@ -21,10 +26,26 @@ print_usage (FILE *stream, int exit_code)
                 "\n -c --create      Create new namespace\n"
                 " -n --namespace   Create namespace file\n"
                 " -p --store_path  Path of the store\n"
-                " -h --hash_type   Type of hash\n"
+                " -h --hash_type   Type of hash, md5/sha1/sha256, blake3 and xxh128\n"
+                "                  need libblake3 and libxxhash at build time\n"
                 " -s --store_type  Type of store\n"
+                " --object_layout  Layout of object store, file per chunk or packs\n"
                 " --chunk_scheme   Type of chunk\n"
                 " --chunk_size     Size of chunk is it is fixed chunk_scheme\n"
+                " --chunk_window   Bytes in rolling hash window of variable chunk_scheme\n"
+                " --chunk_mask_bits Average chunk size is 2^mask_bits for variable chunk_scheme\n"
+                " --chunk_min      Minimum chunk size of variable chunk_scheme\n"
+                " --chunk_avg      Average chunk size of variable chunk_scheme\n"
+                " --chunk_max      Maximum chunk size of variable chunk_scheme\n"
+                " --filter         Fingerprint filter in front of the hash store\n"
+                " --filter_fp_rate False positive rate of the filter\n"
+                " --filter_capacity Number of fingerprints the filter is sized for\n"
+                " --threads        Threads of dedup and restore, 0 to run them in one thread\n"
+                " --restore_cache  MiB of chunks a restore keeps for reuse, 64 by default\n"
+                " --restore_faa    MiB of the forward assembly area, restores read chunks\n"
+                "                  in store order a window at a time, 0 to read in stub order\n"
+                " --restore_copy   How restores in stub order copy chunks, zero to copy in\n"
+                "                  the kernel by default or buffered to read them into memory\n"
                 " --desc           Description of namespace\n"
                 " -i --info        Display all the information of namespace\n"
                 "                  To Display information of all namespace use 'all'\n"
@@ -39,14 +60,27 @@ print_usage (FILE *stream, int exit_code)
                 " --segments       Number of chunks in a segment\n"
                 " --prime          Range of prime number"
                 " -r --restore     Restore file\n"
-                " -f --file        File path to perform various file operation\n"
+                " --offset         First byte to restore, 0 by default\n"
+                " --length         Number of bytes to restore, the rest of the file by default\n"
+                " --convert        Upgrade the stores of namespace to the current format\n"
+                " -f --file        File path to perform various file operation,\n"
+                "                  '-' to dedup stdin or restore to stdout\n"
+                " --logical_name   Name a dedup, restore or delete catalogs the file under,\n"
+                "                  instead of its path, needed with --file -\n"
                 " --help           Prints usage\n"
                 "\nNamespace operation:\n====================\n"
                 "Creat namespace:\n"
                 "$> yadl --create/-c  -n <namespace_name> --store_path <store_path>\n"
-                "[--hash_type {md5/sha1}]\n"
+                "[--hash_type {md5/sha1/sha256/blake3/xxh128}]\n"
                 "[--chunk_scheme {variable/fixed} [--chunk_size <chunk_size>]  ]\n"
-                "[--store_type {default/object}] [--desc <namespace_description>]\n"
+                "[--chunk_window <window_bytes>] [--chunk_mask_bits <mask_bits>]\n"
+                "[--chunk_min <size>] [--chunk_avg <size>] [--chunk_max <size>]\n"
+                "[--store_type {default/object/container}] [--desc <namespace_description>]\n"
+                "[--object_layout {loose/pack}]\n"
+                "[--filter {none/bloom/cuckoo} [--filter_fp_rate <rate>] "
+                "[--filter_capacity <fingerprints>]] [--threads <count>]\n"
+                "[--restore_cache <MiB>] [--restore_faa <MiB>]\n"
+                "[--restore_copy {zero/buffered}]\n"
                 "\nInfo of namespace:\n"
                 "$> yadl --info/-i -n <namespace_name>\n"
                 "$> yadl --info/-i -n all\n"
@@ -57,21 +91,34 @@ print_usage (FILE *stream, int exit_code)
                         " [--desc <namespace_description>]\n"
                 "\nReset namespace:\n"
                 "$> yadl --reset/-R -n <namespace_name>\n"
+                "\nConvert namespace stores to the current on-disk format:\n"
+                "$> yadl --convert -n <namespace_name>\n"
                 "\nDelete namespace:\n"
                 "$> yadl --delete/-d -n <namespace_name>\n"
                 "\nFile operations:\n================\n"
                 "Dedup file:\n"
                 "$> yadl --dedup -n <namespace_name> --file/-f <file_path>\n"
+                "[--logical_name <name>]\n"
+                "$> <command> | yadl --dedup -n <namespace_name> --file/-f - "
+                "--logical_name <name>\n"
                 "\nMin hash dedup\n"
                 "$>yadl --min_hash/-m --similarity <Percentage similarity> "
                 "--segments <Number of chunks> --min_hash_type {default, xor} "
                 "-f/--file <file path> [--prime <Range of prime number>]\n"
                 "\nRestore file:\n"
                 "$> yadl --restore/-r -n <namespace_name> --file/-f <file_path>\n"
+                "[--offset <offset>] [--length <length>] [--threads <count>]\n"
+                "[--restore_cache <MiB>] [--restore_faa <MiB>]\n"
+                "[--restore_copy {zero/buffered}] [--logical_name <name>]\n"
+                "$> yadl --restore/-r -n <namespace_name> --file/-f - "
+                "--logical_name <name> | <command>\n"
                 "\nMinhash Restore file:\n"
                 "$> yadl --min_hash_restore --file/-f <file_path>\n"
                 "\nDelete file:\n"
                 "$> yadl --delete/-d -n <namespace_name> --file/-f <file_path>\n"
+                "[--logical_name <name>]\n"
+                "$> yadl --delete/-d -n <namespace_name> --file/-f - "
+                "--logical_name <name>\n"
                 "\nList files in namespace:\n"
                 "$> yadl --list/-l -n <namespace_name>\n\n"
                 "Help : \n"
@@ -87,6 +134,7 @@ create_default_namespace(char *namespace_path)
         char    file_path[LENGTH]       =       "";
         char    content[LENGTH]         =       "";
         DIR     *store_dp               =       NULL;
+        struct chunk_params params;
 
         if (namespace_path == NULL) {
                 printf("Invalid namespace path\n");
@@ -104,6 +152,14 @@ create_default_namespace(char *namespace_path)
         sprintf(content, "%shash_type:md5\n", content);
         sprintf(content, "%schunk_scheme:variable\n", content);
         sprintf(content, "%schunk_size:0\n", content);
+        memset(&params, 0, sizeof(params));
+        resolve_chunk_params(&params);
+        sprintf(content, "%schunk_window:%d\n", content, params.window);
+        sprintf(content, "%schunk_mask_bits:%d\n", content, params.mask_bits);
+        sprintf(content, "%schunk_min:%lu\n", content, params.min_size);
+        sprintf(content, "%schunk_avg:%lu\n", content, params.avg_size);
+        sprintf(content, "%schunk_max:%lu\n", content, params.max_size);
+        sprintf(content, "%sfilter:none\n", content);
         sprintf(content, "%sdesc:Default namespace\n", content);
         ret = write (fd, content, strlen(content));
         if (ret < 0)
@@ -149,6 +205,7 @@ create_namespace(char *namespace_path, namespace_dtl set_namespace)
         DIR     *store_dp               =       NULL;
         namespace_dtl get_namespace;
         struct stat st;
+        struct chunk_params params;
 
         if (namespace_path == NULL || set_namespace.store_path == NULL) {
                 printf("Invalid argument list\n");
@@ -183,6 +240,37 @@ create_namespace(char *namespace_path, namespace_dtl set_namespace)
                 set_namespace.hash_type = get_namespace.hash_type;
                 set_namespace.chunk_scheme = get_namespace.chunk_scheme;
                 set_namespace.chunk_size = set_namespace.chunk_size;
+                set_namespace.object_layout = get_namespace.object_layout;
+                if (set_namespace.chunk_window == 0)
+                        set_namespace.chunk_window =
+                                get_namespace.chunk_window;
+                if (set_namespace.chunk_mask_bits == 0 &&
+                        set_namespace.chunk_avg == 0) {
+                        set_namespace.chunk_mask_bits =
+                                get_namespace.chunk_mask_bits;
+                        set_namespace.chunk_avg = get_namespace.chunk_avg;
+                }
+                if (set_namespace.chunk_min == 0)
+                        set_namespace.chunk_min = get_namespace.chunk_min;
+                if (set_namespace.chunk_max == 0)
+                        set_namespace.chunk_max = get_namespace.chunk_max;
+                if (set_namespace.filter == NULL) {
+                        set_namespace.filter = get_namespace.filter;
+                        set_namespace.filter_fp_rate =
+                                get_namespace.filter_fp_rate;
+                        set_namespace.filter_capacity =
+                                get_namespace.filter_capacity;
+                }
+                if (set_namespace.threads == 0)
+                        set_namespace.threads = get_namespace.threads;
+                if (set_namespace.restore_cache == 0)
+                        set_namespace.restore_cache =
+                                get_namespace.restore_cache;
+                if (set_namespace.restore_faa == 0)
+                        set_namespace.restore_faa = get_namespace.restore_faa;
+                if (set_namespace.restore_copy == NULL)
+                        set_namespace.restore_copy =
+                                get_namespace.restore_copy;
                 printf("Default namespace configure is assigning...\n");
         } else if (set_namespace.store_type == NULL ||
                 set_namespace.hash_type == NULL ||
@@ -221,13 +309,13 @@ create_namespace(char *namespace_path, namespace_dtl set_namespace)
                 }
 
                 if (strcmp(set_namespace.store_type, "default") != 0 &&
-                strcmp(set_namespace.store_type, "object") != 0) {
+                strcmp(set_namespace.store_type, "object") != 0 &&
+                strcmp(set_namespace.store_type, "container") != 0) {
                         printf("Invalid store type\n");
                         goto out;
                 }
 
-                if (strcmp(set_namespace.hash_type, "md5") != 0 &&
-                strcmp(set_namespace.hash_type, "sha1") != 0) {
+                if (get_hash_provider(set_namespace.hash_type) == NULL) {
                         printf("Invalid hash type\n");
                         goto out;
                 }
@@ -250,6 +338,63 @@ create_namespace(char *namespace_path, namespace_dtl set_namespace)
                         "chunk_size\n");
                         goto out;
                 }
+
+                if (strcmp(set_namespace.chunk_scheme, "fixed") == 0 &&
+                (set_namespace.chunk_window != 0 ||
+                set_namespace.chunk_mask_bits != 0 ||
+                set_namespace.chunk_min != 0 ||
+                set_namespace.chunk_avg != 0 ||
+                set_namespace.chunk_max != 0)) {
+                        printf("Fixed chunk_scheme does not accept "
+                        "chunk_window, chunk_mask_bits, chunk_min, "
+                        "chunk_avg or chunk_max\n");
+                        goto out;
+                }
+
+                if (set_namespace.chunk_mask_bits != 0 &&
+                set_namespace.chunk_avg != 0) {
+                        printf("chunk_mask_bits and chunk_avg can not be "
+                        "used together\n");
+                        goto out;
+                }
+
+                if (strcmp(set_namespace.chunk_scheme, "variable") == 0 &&
+                get_chunk_params(set_namespace, &params) == -1) {
+                        printf("Invalid chunk parameters\n");
+                        goto out;
+                }
+
+                if (set_namespace.object_layout != NULL &&
+                strcmp(set_namespace.store_type, "object") != 0) {
+                        printf("object_layout needs object store_type\n");
+                        goto out;
+                }
+
+                if (set_namespace.object_layout != NULL &&
+                strcmp(set_namespace.object_layout, "loose") != 0 &&
+                strcmp(set_namespace.object_layout, "pack") != 0) {
+                        printf("Invalid object_layout\n");
+                        goto out;
+                }
+
+                if (get_filter_type(set_namespace.filter) == -1) {
+                        printf("Invalid filter\n");
+                        goto out;
+                }
+
+                if (get_filter_type(set_namespace.filter) == FILTER_NONE &&
+                (set_namespace.filter_fp_rate != 0 ||
+                set_namespace.filter_capacity != 0)) {
+                        printf("filter_fp_rate and filter_capacity need a "
+                        "filter\n");
+                        goto out;
+                }
+
+                if (set_namespace.filter_fp_rate < 0 ||
+                set_namespace.filter_fp_rate >= 1) {
+                        printf("Invalid filter_fp_rate\n");
+                        goto out;
+                }
                 fd = open(file_path, O_APPEND|O_CREAT|O_RDWR, S_IRUSR|S_IWUSR);
                 if (fd < 1) {
                         fprintf(stderr, "%s\n", strerror(errno));
@@ -258,12 +403,55 @@ create_namespace(char *namespace_path, namespace_dtl set_namespace)
                 sprintf(content, "store_path:%s\n", set_namespace.store_path);
                 sprintf(content, "%sstore_type:%s\n", content,
                         set_namespace.store_type);
+                if (strcmp(set_namespace.store_type, "object") == 0)
+                        sprintf(content, "%sobject_layout:%s\n", content,
+                                set_namespace.object_layout != NULL ?
+                                set_namespace.object_layout : "loose");
                 sprintf(content, "%shash_type:%s\n", content,
                         set_namespace.hash_type);
                 sprintf(content, "%schunk_scheme:%s\n", content,
                         set_namespace.chunk_scheme);
                 sprintf(content, "%schunk_size:%lu\n", content,
                         set_namespace.chunk_size);
+                if (strcmp(set_namespace.chunk_scheme, "variable") == 0) {
+                        sprintf(content, "%schunk_window:%d\n", content,
+                                params.window);
+                        sprintf(content, "%schunk_mask_bits:%d\n", content,
+                                params.mask_bits);
+                        sprintf(content, "%schunk_min:%lu\n", content,
+                                params.min_size);
+                        sprintf(content, "%schunk_avg:%lu\n", content,
+                                params.avg_size);
+                        sprintf(content, "%schunk_max:%lu\n", content,
+                                params.max_size);
+                }
+                if (get_filter_type(set_namespace.filter) == FILTER_NONE) {
+                        sprintf(content, "%sfilter:none\n", content);
+                } else {
+                        if (set_namespace.filter_fp_rate == 0)
+                                set_namespace.filter_fp_rate = FILTER_FP_RATE;
+                        if (set_namespace.filter_capacity == 0)
+                                set_namespace.filter_capacity =
+                                        FILTER_CAPACITY;
+                        sprintf(content, "%sfilter:%s\n", content,
+                                set_namespace.filter);
+                        sprintf(content, "%sfilter_fp_rate:%g\n", content,
+                                set_namespace.filter_fp_rate);
+                        sprintf(content, "%sfilter_capacity:%lu\n", content,
+                                set_namespace.filter_capacity);
+                }
+                if (set_namespace.threads > 0)
+                        sprintf(content, "%sthreads:%d\n", content,
+                                set_namespace.threads);
+                if (set_namespace.restore_cache > 0)
+                        sprintf(content, "%srestore_cache:%lu\n", content,
+                                set_namespace.restore_cache);
+                if (set_namespace.restore_faa > 0)
+                        sprintf(content, "%srestore_faa:%lu\n", content,
+                                set_namespace.restore_faa);
+                if (set_namespace.restore_copy != NULL)
+                        sprintf(content, "%srestore_copy:%s\n", content,
+                                set_namespace.restore_copy);
                 sprintf(content, "%sdesc:%s\n", content, set_namespace.desc);
                 ret = write (fd, content, strlen(content));
                 if (ret < 0)
@@ -294,6 +482,58 @@ out:
         return ret;
 }
 
+/*@description: Function to get the variable chunker parameters of a
+ namespace with defaults filled in. Namespaces created before chunk_min,
+ chunk_avg and chunk_max existed resolve from chunk_mask_bits.
+Input:
+        namespace_dtl namespace_input : Namespace information.
+Output:
+        struct chunk_params *params : Effective chunker parameters.
+        int : Return 0 on success -1 on invalid parameters.
+*/
+int
+get_chunk_params(namespace_dtl namespace_input, struct chunk_params *params)
+{
+        memset(params, 0, sizeof(*params));
+        params->window    = namespace_input.chunk_window;
+        params->mask_bits = namespace_input.chunk_mask_bits;
+        params->min_size  = namespace_input.chunk_min;
+        params->avg_size  = namespace_input.chunk_avg;
+        params->max_size  = namespace_input.chunk_max;
+        return resolve_chunk_params(params);
+}
+
+/*Function to print the effective chunker parameters of a namespace.
+Input:
+        char *content : Content of the namespace file.
+Output:
+        None
+*/
+static void
+print_chunk_params(char *content)
+{
+        int     ret                     =       -1;
+        char    buffer[LENGTH]          =       "";
+        namespace_dtl get_namespace;
+        struct chunk_params params;
+
+        /* get_namespace_method tokenizes in place */
+        strncpy(buffer, content, LENGTH - 1);
+        get_namespace = get_namespace_method(buffer, &ret);
+        if (ret == -1 || get_namespace.chunk_scheme == NULL ||
+        strcmp(get_namespace.chunk_scheme, "variable") != 0)
+                return;
+        if (get_chunk_params(get_namespace, &params) == -1) {
+                printf("Invalid chunk parameters\n");
+                return;
+        }
+        printf("effective chunking: window %d, min %lu, avg %lu, max %lu, "
+                "mask_s 0x%llx, mask_l 0x%llx\n", params.window,
+                params.min_size, params.avg_size, params.max_size,
+                (1ULL << (params.mask_bits + CHUNK_NORMALIZATION)) - 1,
+                (1ULL << (params.mask_bits - CHUNK_NORMALIZATION)) - 1);
+}
+
 /*Function to display the info of perticular namespace and info of
  all namespace.
 Input:
@@ -336,6 +576,7 @@ namespace_info(char *namespace_path, namespace_dtl set_namespace)
                         goto out;
                 }
                 printf("\n%s\n", content);
+                print_chunk_params(content);
         } else {
                 dp = opendir(namespace_path);
                 if (dp) {
@@ -362,6 +603,7 @@ namespace_info(char *namespace_path, namespace_dtl set_namespace)
                                                 goto out;
                                         }
                                         printf("\n%s\n", content);
+                                        print_chunk_params(content);
                                         memset(content, 0, LENGTH);
                                         count++;
                                 }
@@ -454,7 +696,18 @@ edit_namespace(char *namespace_path, namespace_dtl set_namespace)
         if (set_namespace.store_path != NULL ||
                 set_namespace.store_type != NULL ||
                 set_namespace.hash_type != NULL ||
-                set_namespace.chunk_scheme != NULL) {
+                set_namespace.chunk_scheme != NULL ||
+                set_namespace.object_layout != NULL ||
+                set_namespace.chunk_window != 0 ||
+                set_namespace.chunk_mask_bits != 0 ||
+                set_namespace.chunk_min != 0 ||
+                set_namespace.chunk_avg != 0 ||
+                set_namespace.chunk_max != 0 ||
+                set_namespace.filter != NULL ||
+                set_namespace.threads != 0 ||
+                set_namespace.restore_cache != 0 ||
+                set_namespace.restore_faa != 0 ||
+                set_namespace.restore_copy != NULL) {
                 printf("Only mutable parameters can be edited\n");
                 goto out;
         }
@@ -549,7 +802,8 @@ delete_namespace(char *namespace_path, namespace_dtl set_namespace)
                                                 namespace_path, namespace_file);
                                         ret = file_operation(reset, "delete",
                                                 namespace_path, set_namespace,
-                                                set_minhash_config);
+                                                set_minhash_config, NULL,
+                                                NULL);
                                         if (ret == -1 || ret == 1) {
                                                 goto out;
                                         }
@@ -641,6 +895,7 @@ get_namespace_method(char *buffer, int *ret)
         namespace_dtl get_namespace;
 
         *ret    =       -1;
+        memset(&get_namespace, 0, sizeof(get_namespace));
         for (str = buffer ; ; str = NULL) {
                 token1 = strtok_r(str, dlmtr2, &saveptr1);
                 if (token1 == NULL)
@@ -680,6 +935,60 @@ get_namespace_method(char *buffer, int *ret)
                 if (strcmp(key_value[0], "chunk_size") == 0) {
                         get_namespace.chunk_size = atoi(key_value[1]);
                 }
+                if (strcmp(key_value[0], "chunk_window") == 0) {
+                        get_namespace.chunk_window = atoi(key_value[1]);
+                }
+                if (strcmp(key_value[0], "chunk_mask_bits") == 0) {
+                        get_namespace.chunk_mask_bits = atoi(key_value[1]);
+                }
+                if (strcmp(key_value[0], "chunk_min") == 0) {
+                        get_namespace.chunk_min =
+                                strtoull(key_value[1], NULL, 10);
+                }
+                if (strcmp(key_value[0], "chunk_avg") == 0) {
+                        get_namespace.chunk_avg =
+                                strtoull(key_value[1], NULL, 10);
+                }
+                if (strcmp(key_value[0], "chunk_max") == 0) {
+                        get_namespace.chunk_max =
+                                strtoull(key_value[1], NULL, 10);
+                }
+                if (strcmp(key_value[0], "object_layout") == 0) {
+                        get_namespace.object_layout = key_value[1];
+                        if (get_namespace.object_layout == NULL) {
+                                goto out;
+                        }
+                }
+                if (strcmp(key_value[0], "filter") == 0) {
+                        get_namespace.filter = key_value[1];
+                        if (get_namespace.filter == NULL) {
+                                goto out;
+                        }
+                }
+                if (strcmp(key_value[0], "filter_fp_rate") == 0) {
+                        get_namespace.filter_fp_rate = atof(key_value[1]);
+                }
+                if (strcmp(key_value[0], "filter_capacity") == 0) {
+                        get_namespace.filter_capacity =
+                                strtoull(key_value[1], NULL, 10);
+                }
+                if (strcmp(key_value[0], "threads") == 0) {
+                        get_namespace.threads = atoi(key_value[1]);
+                }
+                if (strcmp(key_value[0], "restore_cache") == 0) {
+                        get_namespace.restore_cache =
+                                strtoull(key_value[1], NULL, 10);
+                }
+                if (strcmp(key_value[0], "restore_faa") == 0) {
+                        get_namespace.restore_faa =
+                                strtoull(key_value[1], NULL, 10);
+                }
+                if (strcmp(key_value[0], "restore_copy") == 0) {
+                        get_namespace.restore_copy = key_value[1];
+                        if (get_namespace.restore_copy == NULL) {
+                                goto out;
+                        }
+                }
                 index = 0;
         }
         *ret = 0;
@@ -695,21 +1004,27 @@ Input:
         char *namespace_path : Path of the namespace.
         namespace_dtl set_namespace : Contains namespace information to perform
                                         file operations.
+        struct restore_range *range : Bytes to restore, NULL for the whole
+                                        file.
+        char *name : Name the file is cataloged under, NULL for its path
 Output:
         int : Return 0 on success -1 on failure.
 */
 int
 file_operation(enum OPTIONS flag, char *filename, char *namespace_path,
-namespace_dtl set_namespace, minhash_config minhash_config_dtl)
+namespace_dtl set_namespace, minhash_config minhash_config_dtl,
+struct restore_range *range, char *name)
 {
         char    *buffer         =       NULL;
         DIR     *dp             =       NULL;
         int     ret             =       -1;
         int     fd              =       -1;
+        int     created         =        0;
         char    namespace_filename[LENGTH];
         char    path[LENGTH]    =       "";
         char    confirm         =       -1;
         static namespace_dtl get_namespace;
+        struct restore_options options;
 
         if (namespace_path == NULL) {
                 goto out;
@@ -745,6 +1060,24 @@ namespace_dtl set_namespace, minhash_config minhash_config_dtl)
                 goto out;
         }
 
+        /* A thread count or restore memory on the command line overrides
+         * the namespace for this dedup or restore */
+        if (set_namespace.threads > 0)
+                get_namespace.threads = set_namespace.threads;
+        if (set_namespace.restore_cache > 0)
+                get_namespace.restore_cache = set_namespace.restore_cache;
+        if (set_namespace.restore_faa > 0)
+                get_namespace.restore_faa = set_namespace.restore_faa;
+        if (set_namespace.restore_copy != NULL)
+                get_namespace.restore_copy = set_namespace.restore_copy;
+        if (get_namespace.restore_cache == 0)
+                get_namespace.restore_cache = RESTORE_CACHE_SIZE;
+        if (flag == convert) {
+                ret = convert_store(get_namespace.store_path,
+                        get_digest_length(get_namespace.hash_type));
+                goto out;
+        }
+
         sprintf(path, "%s/store_block", get_namespace.store_path);
         dp = opendir(path);
         if (NULL == dp) {
@@ -757,9 +1090,34 @@ namespace_dtl set_namespace, minhash_config minhash_config_dtl)
         ret = init_block_store(path);
         if (ret == -1)
                 goto out;
-        ret = init_hash_store(path);
+        ret = init_hash_store(path,
+                get_digest_length(get_namespace.hash_type));
         if (ret == -1)
                 goto out;
+        ret = init_filter_store(path, get_filter_type(get_namespace.filter),
+                get_namespace.filter_fp_rate, get_namespace.filter_capacity,
+                &created);
+        if (ret == -1)
+                goto out;
+        if (created) {
+                ret = walk_hash_store(filter_insert);
+                if (ret == -1)
+                        goto out;
+        }
+        if (strcmp(get_namespace.store_type, "container") == 0) {
+                ret = init_container_store(path,
+                        get_digest_length(get_namespace.hash_type),
+                        insert_hash);
+                if (ret == -1)
+                        goto out;
+        }
+        if (get_namespace.object_layout != NULL &&
+                strcmp(get_namespace.object_layout, "pack") == 0) {
+                ret = init_pack_store(path,
+                        get_digest_length(get_namespace.hash_type));
+                if (ret == -1)
+                        goto out;
+        }
         ret = init_catalog_store(path);
         if (ret == -1)
                 goto out;
@@ -770,7 +1128,7 @@ namespace_dtl set_namespace, minhash_config minhash_config_dtl)
                         "Try $>yadl --help for more information\n");
                         goto out;
                 }
-                ret = dedup_file(get_namespace, filename);
+                ret = dedup_file(get_namespace, filename, name);
                 if (ret < 0)
                         goto out;
                 break;
@@ -795,7 +1153,14 @@ namespace_dtl set_namespace, minhash_config minhash_config_dtl)
                         "Try $>yadl --help for more information\n");
                         goto out;
                 }
-                ret = restore_file(filename, get_namespace.store_path);
+                options.threads = get_namespace.threads;
+                options.cache_size = get_namespace.restore_cache << 20;
+                options.faa_size = get_namespace.restore_faa << 20;
+                options.zero_copy = get_namespace.restore_copy == NULL ||
+                        strcmp(get_namespace.restore_copy, "buffered") != 0;
+                options.name = name;
+                ret = restore_file(filename, get_namespace.store_path, range,
+                        &options);
                 if (ret < 0)
                         goto out;
                 break;
@@ -812,7 +1177,7 @@ namespace_dtl set_namespace, minhash_config minhash_config_dtl)
                                 goto out;
                         }
                         ret = delete_stub_store(get_namespace.store_path,
-                                filename);
+                                filename, name);
                         if (ret < 0)
                                 goto out;
                         printf("\nStub deleted\n");
@@ -845,12 +1210,28 @@ namespace_dtl set_namespace, minhash_config minhash_config_dtl)
         default:
                 break;
         }
+        /* Sealing the last container adds its fingerprints to the hash
+         * store, so it is closed first */
+        if (strcmp(get_namespace.store_type, "container") == 0) {
+                ret = fini_container_store();
+                if (ret == -1)
+                        goto out;
+        }
         ret = fini_block_store();
         if (ret == -1)
                 goto out;
         ret = fini_hash_store();
         if (ret == -1)
                 goto out;
+        ret = fini_filter_store();
+        if (ret == -1)
+                goto out;
+        if (get_namespace.object_layout != NULL &&
+                strcmp(get_namespace.object_layout, "pack") == 0) {
+                ret = fini_pack_store();
+                if (ret == -1)
+                        goto out;
+        }
         ret = fini_catalog_store();
         if (ret == -1)
                 goto out;
@@ -879,11 +1260,14 @@ start_program(int argc, char **argv, char *namespace_path)
         int     choice                  =       -1;
         int     ret                     =       -1;
         char    *file_path              =     NULL;
+        char    *logical_name           =     NULL;
         enum    OPTIONS flag            =       -1;
         int     option_index            =        0;
         int     i                       =        0;
         minhash_config  set_minhash_config;
         static namespace_dtl set_namespace;
+        struct restore_range range;
+        struct restore_range *restore_range =  NULL;
 
         const char *short_options = "cn:p:h:s:df:ilRrebm";
 
@@ -895,6 +1279,19 @@ start_program(int argc, char **argv, char *namespace_path)
                 {"store_type",      required_argument,      0,   's'},
                 {"chunk_scheme",    required_argument,      0,   0 },
                 {"chunk_size",      required_argument,      0,   0 },
+                {"chunk_window",    required_argument,      0,   0 },
+                {"chunk_mask_bits", required_argument,      0,   0 },
+                {"chunk_min",       required_argument,      0,   0 },
+                {"chunk_avg",       required_argument,      0,   0 },
+                {"chunk_max",       required_argument,      0,   0 },
+                {"object_layout",   required_argument,      0,   0 },
+                {"filter",          required_argument,      0,   0 },
+                {"filter_fp_rate",  required_argument,      0,   0 },
+                {"filter_capacity", required_argument,      0,   0 },
+                {"threads",         required_argument,      0,   0 },
+                {"restore_cache",   required_argument,      0,   0 },
+                {"restore_faa",     required_argument,      0,   0 },
+                {"restore_copy",    required_argument,      0,   0 },
                 {"desc",            required_argument,      0,   0 },
                 {"dedup",           no_argument,            0,   'b'},
                 {"min_hash",        no_argument,            0,   'm'},
@@ -904,16 +1301,22 @@ start_program(int argc, char **argv, char *namespace_path)
                 {"min_hash_type",   required_argument,      0,     0},
                 {"similarity",      required_argument,      0,     0},
                 {"file",            required_argument,      0,   'f'},
+                {"logical_name",    required_argument,      0,   0},
                 {"restore",         no_argument,            0,   'r'},
                 {"delete",          no_argument,            0,   'd'},
                 {"info",            no_argument,            0,   'i'},
                 {"list",            no_argument,            0,   'l'},
                 {"reset",           no_argument,            0,   'R'},
                 {"edit",            no_argument,            0,   'e'},
+                {"offset",          required_argument,      0,   0},
+                {"length",          required_argument,      0,   0},
+                {"convert",         no_argument,            0,   0},
                 {"help",            no_argument,            0,   0},
                 {0,                 0,                      0,   0 }
         };
 
+        range.offset = 0;
+        range.length = RESTORE_TO_END;
         if (argc == 1) {
                 print_usage (stderr, 1);
                 goto out;
@@ -980,10 +1383,177 @@ start_program(int argc, char **argv, char *namespace_path)
                                 set_namespace.chunk_size = atoi(optarg);
                         }
                         if (strcmp(long_options[option_index].name,
+                        "chunk_window") == 0) {
+                                for (i = 0; optarg[i]; i++) {
+                                        if (!isdigit(optarg[i])) {
+                                                printf("Invalid chunk window\n");
+                                                ret = -1;
+                                                goto out;
+                                        }
+                                }
+                                set_namespace.chunk_window = atoi(optarg);
+                        }
+                        if (strcmp(long_options[option_index].name,
+                        "chunk_mask_bits") == 0) {
+                                for (i = 0; optarg[i]; i++) {
+                                        if (!isdigit(optarg[i])) {
+                                                printf("Invalid chunk mask bits\n");
+                                                ret = -1;
+                                                goto out;
+                                        }
+                                }
+                                set_namespace.chunk_mask_bits = atoi(optarg);
+                        }
+                        if (strcmp(long_options[option_index].name,
+                        "chunk_min") == 0) {
+                                for (i = 0; optarg[i]; i++) {
+                                        if (!isdigit(optarg[i])) {
+                                                printf("Invalid chunk min\n");
+                                                ret = -1;
+                                                goto out;
+                                        }
+                                }
+                                set_namespace.chunk_min = strtoull(optarg, NULL, 10);
+                        }
+                        if (strcmp(long_options[option_index].name,
+                        "chunk_avg") == 0) {
+                                for (i = 0; optarg[i]; i++) {
+                                        if (!isdigit(optarg[i])) {
+                                                printf("Invalid chunk avg\n");
+                                                ret = -1;
+                                                goto out;
+                                        }
+                                }
+                                set_namespace.chunk_avg = strtoull(optarg, NULL, 10);
+                        }
+                        if (strcmp(long_options[option_index].name,
+                        "chunk_max") == 0) {
+                                for (i = 0; optarg[i]; i++) {
+                                        if (!isdigit(optarg[i])) {
+                                                printf("Invalid chunk max\n");
+                                                ret = -1;
+                                                goto out;
+                                        }
+                                }
+                                set_namespace.chunk_max = strtoull(optarg, NULL, 10);
+                        }
+                        if (strcmp(long_options[option_index].name,
+                        "object_layout") == 0) {
+                                set_namespace.object_layout = optarg;
+                        }
+                        if (strcmp(long_options[option_index].name,
+                        "filter") == 0) {
+                                set_namespace.filter = optarg;
+                        }
+                        if (strcmp(long_options[option_index].name,
+                        "filter_fp_rate") == 0) {
+                                set_namespace.filter_fp_rate = atof(optarg);
+                                if (set_namespace.filter_fp_rate <= 0) {
+                                        printf("Invalid filter_fp_rate\n");
+                                        ret = -1;
+                                        goto out;
+                                }
+                        }
+                        if (strcmp(long_options[option_index].name,
+                        "filter_capacity") == 0) {
+                                for (i = 0; optarg[i]; i++) {
+                                        if (!isdigit(optarg[i])) {
+                                                printf("Invalid filter "
+                                                "capacity\n");
+                                                ret = -1;
+                                                goto out;
+                                        }
+                                }
+                                set_namespace.filter_capacity =
+                                        strtoull(optarg, NULL, 10);
+                        }
+                        if (strcmp(long_options[option_index].name,
+                        "threads") == 0) {
+                                for (i = 0; optarg[i]; i++) {
+                                        if (!isdigit(optarg[i])) {
+                                                printf("Invalid thread "
+                                                "count\n");
+                                                ret = -1;
+                                                goto out;
+                                        }
+                                }
+                                set_namespace.threads = atoi(optarg);
+                        }
+                        if (strcmp(long_options[option_index].name,
+                        "restore_cache") == 0) {
+                                for (i = 0; optarg[i]; i++) {
+                                        if (!isdigit(optarg[i])) {
+                                                printf("Invalid restore cache "
+                                                "size\n");
+                                                ret = -1;
+                                                goto out;
+                                        }
+                                }
+                                set_namespace.restore_cache =
+                                        strtoull(optarg, NULL, 10);
+                        }
+                        if (strcmp(long_options[option_index].name,
+                        "restore_faa") == 0) {
+                                for (i = 0; optarg[i]; i++) {
+                                        if (!isdigit(optarg[i])) {
+                                                printf("Invalid forward "
+                                                "assembly size\n");
+                                                ret = -1;
+                                                goto out;
+                                        }
+                                }
+                                set_namespace.restore_faa =
+                                        strtoull(optarg, NULL, 10);
+                        }
+                        if (strcmp(long_options[option_index].name,
+                        "restore_copy") == 0) {
+                                if (strcmp(optarg, "zero") != 0 &&
+                                        strcmp(optarg, "buffered") != 0) {
+                                        printf("Invalid restore_copy\n");
+                                        ret = -1;
+                                        goto out;
+                                }
+                                set_namespace.restore_copy = optarg;
+                        }
+                        if (strcmp(long_options[option_index].name,
+                        "offset") == 0 || strcmp(long_options[option_index].
+                        name, "length") == 0) {
+                                for (i = 0; optarg[i]; i++) {
+                                        if (!isdigit(optarg[i])) {
+                                                printf("Invalid %s\n",
+                                                long_options[option_index].
+                                                name);
+                                                ret = -1;
+                                                goto out;
+                                        }
+                                }
+                                if (long_options[option_index].name[0] == 'o')
+                                        range.offset = strtoull(optarg, NULL,
+                                                10);
+                                else
+                                        range.length = strtoull(optarg, NULL,
+                                                10);
+                                restore_range = &range;
+                        }
+                        if (strcmp(long_options[option_index].name,
+                        "logical_name") == 0) {
+                                logical_name = optarg;
+                        }
+                        if (strcmp(long_options[option_index].name,
                         "desc") == 0) {
                                 set_namespace.desc = optarg;
                         }
                         if (strcmp(long_options[option_index].name,
+                        "convert") == 0) {
+                                if (flag != -1) {
+                                        printf("Trying to use more than one "
+                                        "operation :Try $>yadl --help for "
+                                        "more information\n");
+                                        goto out;
+                                }
+                                flag = convert;
+                        }
+                        if (strcmp(long_options[option_index].name,
                         "help") == 0) {
                                 print_usage(stderr, 1);
                                 goto out;
@@ -1103,6 +1673,31 @@ start_program(int argc, char **argv, char *namespace_path)
                 print_usage(stderr, 1);
                 goto out;
         }
+        if (restore_range != NULL && flag != restore) {
+                printf("--offset and --length only apply to --restore :"
+                "Try $>yadl --help for more information\n");
+                goto out;
+        }
+        if (logical_name != NULL && flag != dedup && flag != restore &&
+                flag != delete_file) {
+                printf("--logical_name only applies to --dedup, --restore "
+                "and --delete :Try $>yadl --help for more information\n");
+                goto out;
+        }
+        if (file_path != NULL && strcmp(file_path, STREAM_PATH) == 0) {
+                if (flag != dedup && flag != restore && flag != delete_file) {
+                        printf("--file - only applies to --dedup, --restore "
+                        "and --delete :Try $>yadl --help for more "
+                        "information\n");
+                        goto out;
+                }
+                if (logical_name == NULL) {
+                        printf("--file - needs --logical_name to catalog "
+                        "the stream :Try $>yadl --help for more "
+                        "information\n");
+                        goto out;
+                }
+        }
         switch (flag) {
         case create:
                 ret = create_namespace(namespace_path, set_namespace);
@@ -1133,7 +1728,8 @@ start_program(int argc, char **argv, char *namespace_path)
                         goto out;
                 }
                 ret = file_operation(flag, file_path, namespace_path,
-                        set_namespace, set_minhash_config);
+                        set_namespace, set_minhash_config, restore_range,
+                        logical_name);
                 if (ret == -1)
                         goto out;
                 break;
@@ -1155,8 +1751,10 @@ start_program(int argc, char **argv, char *namespace_path)
                         break;
                 }
         case reset:
+        case convert:
                 ret = file_operation(flag, file_path, namespace_path,
-                        set_namespace, set_minhash_config);
+                        set_namespace, set_minhash_config, restore_range,
+                        logical_name);
                 if (ret == -1)
                         goto out;
                 break;
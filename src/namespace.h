@@ -9,8 +9,13 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include "min_hash.h"
+#include "filter.h"
+#include "Rabin_Karp.h"
 
-enum OPTIONS {create, edit, delete_file, dedup, restore, info, list, reset, minhash, mrestore};
+struct restore_range;
+
+enum OPTIONS {create, edit, delete_file, dedup, restore, info, list, reset, minhash, mrestore,
+        convert};
 
 struct namespace_struct
 {
@@ -19,8 +24,21 @@ struct namespace_struct
         char *desc;
         char *hash_type;
         char *store_type;
+        char *object_layout;
         char *chunk_scheme;
         size_t  chunk_size;
+        int     chunk_window;
+        int     chunk_mask_bits;
+        size_t  chunk_min;
+        size_t  chunk_avg;
+        size_t  chunk_max;
+        char *filter;
+        double  filter_fp_rate;
+        size_t  filter_capacity;
+        int     threads;
+        size_t  restore_cache;
+        size_t  restore_faa;
+        char *restore_copy;
 };
 
 typedef struct namespace_struct namespace_dtl;
@@ -51,11 +69,12 @@ int start_program(int argc, char **argv, char *namespace_path);
 /*@description: Function to dedup the file .
 Input:
         namespace_dtl namespace_input : Takes of the information of namespace
-        char *file_path : Path of the file to be deduped
+        char *file_path : Path of the file to be deduped, "-" for stdin
+        char *name : Name the file is cataloged under, NULL for its path
 Output:
         int : Return 0 on success -1 on failure.
 */
-int dedup_file (namespace_dtl namespace_input,char *file_path);
+int dedup_file (namespace_dtl namespace_input,char *file_path,char *name);
 
 /*@description: Function to call different file operation functions with vaid inputs.
  initiate various stores.
@@ -65,11 +84,15 @@ Input:
         char *namespace_path : Path of the namespace.
         namespace_dtl set_namespace : Contains namespace information to perform
                                         file operations.
+        struct restore_range *range : Bytes to restore, NULL for the whole
+                                        file.
+        char *name : Name the file is cataloged under, NULL for its path
 Output:
         int : Return 0 on success -1 on failure.
 */
 int file_operation(enum OPTIONS flag, char *filename, char *namespace_path,
-namespace_dtl set_namespace, minhash_config minhash_config_dtl);
+namespace_dtl set_namespace, minhash_config minhash_config_dtl,
+struct restore_range *range, char *name);
 
 /*@description: Function to create the namespace with given arguments.
 Input:
@@ -139,6 +162,17 @@ Output:
 */
 namespace_dtl get_namespace_method(char *buffer, int *ret);
 
+/*@description: Function to get the variable chunker parameters of a
+ namespace with defaults filled in
+Input:
+        namespace_dtl namespace_input : Namespace information.
+Output:
+        struct chunk_params *params : Effective chunker parameters.
+        int : Return 0 on success -1 on invalid parameters.
+*/
+int get_chunk_params(namespace_dtl namespace_input,
+        struct chunk_params *params);
+
 /*@description: Function to create the default namespace
 Input:
         char *namespace_path : Path of the namespace.
@@ -1,9 +1,11 @@
 #include "object_store.h"
+#include "store_format.h"
 
 /*Function to insert block to blockstore object
 Input:  vector_ptr list : buffer containing block,size_t length-size of block
         char *hash      : hash value of the block
-Output: int : -1 for error and 0 if inserted successfully */
+Output: int : -1 for error, 1 if the block was stored already and 0 if
+        inserted successfully */
 
 int
 insert_block_to_object(char *hash, vector_ptr list, char *store_path)
@@ -14,7 +16,6 @@ insert_block_to_object(char *hash, vector_ptr list, char *store_path)
         DIR *dp3 = NULL;
         int ret = 0;
         int fd = -1;
-        vector_ptr temp_node = NULL;
         char path[1024], filename[1024];
         struct stat st;
 
@@ -60,22 +61,18 @@ insert_block_to_object(char *hash, vector_ptr list, char *store_path)
         }
 
         sprintf(filename, "%s/%s.txt", path, hash);
-        if (stat (filename, &st) != 0) {
-                fd = open(filename, O_APPEND|O_CREAT|O_RDWR, S_IRUSR|S_IWUSR);
-                if (fd < 1) {
-                        fprintf(stderr, "%s\n", strerror(errno));
-                        goto out;
-                }
-                do {
-                        temp_node = list;
-                        if (-1 == write(fd, temp_node->vector_element,
-                                temp_node->length)) {
-                                fprintf(stderr, "%s\n", strerror(errno));
-                                goto out;
-                        }
-                        list = list->next;
-                        free(temp_node);
-                } while (list != NULL);
+        if (stat (filename, &st) == 0) {
+                ret = 1;
+                goto out;
+        }
+        fd = open(filename, O_APPEND|O_CREAT|O_RDWR, S_IRUSR|S_IWUSR);
+        if (fd < 1) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                goto out;
+        }
+        if (vector_writev(fd, list, NULL, 0) == -1) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                goto out;
         }
         ret = 0;
 out:
@@ -146,3 +143,32 @@ out:
                 close(fd);
         return buffer;
 }
+
+/*Function to copy bytes of an object into a file in the kernel, without
+reading the block into memory.
+Input:char *hash,char *store_path,uint64_t from,int fd_out,
+uint64_t out_offset,size_t length
+Output:int
+*/
+int
+copy_block_from_object(char *hash, char *store_path, uint64_t from,
+        int fd_out, uint64_t out_offset, size_t length)
+{
+
+        int ret = -1;
+        int fd = -1;
+        char filename[1024];
+
+        sprintf(filename, "%s/store_block/blocks/%c%c/%c%c/%s.txt", store_path,
+                hash[0], hash[1], hash[2], hash[3], hash);
+        fd = open(filename, O_RDONLY);
+        if (fd == -1) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                goto out;
+        }
+        ret = copy_file_region(fd, from, fd_out, out_offset, length);
+out:
+        if (fd != -1)
+                close(fd);
+        return ret;
+}
@@ -8,11 +8,13 @@
 #include<unistd.h>
 #include<fcntl.h>
 #include<errno.h>
+#include<stdint.h>
 
 /*@description:Function to insert block to blockstore object
 @in: vector_ptr list-buffer containing block,size_t length-size of block
 @out: int 
-@return: -1 for error and 0 if inserted successfully */
+@return: -1 for error, 1 if the block was stored already and 0 if inserted
+successfully */
 int insert_block_to_object(char *hash,vector_ptr list, char *store_path);
 
 /*@description:Function to get specific block from object
@@ -20,3 +22,13 @@ int insert_block_to_object(char *hash,vector_ptr list, char *store_path);
 @out: char*
 @return: block */
 char *get_block_from_object(char *hash,int *length, char *store_path);
+
+/*@description:Function to copy bytes of a block from its object into a file
+without reading them into memory
+@in: char *hash - hash of block, char *store_path-store path of namespace,
+uint64_t from-first byte of the block, int fd_out-file written,
+uint64_t out_offset-offset in fd_out, size_t length-bytes to copy
+@out: int
+@return: -1 for error and 0 on success */
+int copy_block_from_object(char *hash, char *store_path, uint64_t from,
+        int fd_out, uint64_t out_offset, size_t length);
@@ -0,0 +1,477 @@
+#include "pack.h"
+#include "clean_buff.h"
+#include "vector.h"
+
+/* Open pack file, kept in a small cache so that reads and appends do not
+reopen packs */
+struct pack_fd
+{
+        int fd;
+        int bucket;
+        uint32_t pack_no;
+        unsigned long used;
+};
+
+static char pack_path[1024];
+static int digest_len;
+static int fd_index = -1;
+
+/* In-memory copy of the pack index, keyed by the binary fingerprint */
+static struct pack_entry *pack_table;
+static size_t table_size;
+static size_t table_count;
+
+/* Pack being appended to and its size for every bucket */
+static uint32_t cur_pack[PACK_BUCKETS];
+static uint64_t cur_size[PACK_BUCKETS];
+
+/* Every thread keeps its own cache, restores read packs from many threads */
+static __thread struct pack_fd fds[PACK_FD_CACHE];
+static __thread unsigned long fd_clock;
+
+/*Function to find the slot of a fingerprint in the pack table.
+Input:DIGEST *digest
+Output:struct pack_entry* - matching or empty slot
+*/
+static struct pack_entry *
+pack_table_find(DIGEST *digest)
+{
+
+        size_t                  slot    =       0;
+        uint64_t                key     =       0;
+        struct pack_entry       *entry  =       NULL;
+
+        memcpy(&key, digest, sizeof(key));
+        slot = key & (table_size - 1);
+        while (1) {
+                entry = &pack_table[slot];
+                if (entry->length == 0)
+                        break;
+                if (memcmp(entry->digest, digest, digest_len) == 0)
+                        break;
+                slot = (slot + 1) & (table_size - 1);
+        }
+        return entry;
+
+}
+
+/*Function to add a chunk location to the pack table, growing it to keep
+the load below 70%.
+Input:struct pack_entry *new
+Output:int
+*/
+static int
+pack_table_insert(struct pack_entry *new)
+{
+
+        int                     ret             =       -1;
+        size_t                  index           =       0;
+        size_t                  old_size        =       table_size;
+        struct pack_entry       *old_table      =       pack_table;
+
+        if ((table_count + 1) * 10 > table_size * 7) {
+                pack_table = (struct pack_entry *)calloc(old_size * 2,
+                        sizeof(struct pack_entry));
+                if (pack_table == NULL) {
+                        fprintf(stderr, "Error in pack table allocation\n");
+                        pack_table = old_table;
+                        goto out;
+                }
+                table_size = old_size * 2;
+                for (index = 0; index < old_size; index++) {
+                        if (old_table[index].length != 0)
+                                *pack_table_find(old_table[index].digest) =
+                                        old_table[index];
+                }
+                free(old_table);
+        }
+        if (pack_table_find(new->digest)->length == 0)
+                table_count++;
+        *pack_table_find(new->digest) = *new;
+        ret = 0;
+out:
+        return ret;
+
+}
+
+/*Function to get the fd of a pack, opening it if it is not cached. The
+least recently used pack is closed to make room.
+Input:int bucket,uint32_t pack_no,int create
+Output:int
+*/
+static int
+get_pack_fd(int bucket, uint32_t pack_no, int create)
+{
+
+        int slot        =        0;
+        int victim      =        0;
+        char filename[1024];
+
+        for (slot = 0; slot < PACK_FD_CACHE; slot++) {
+                if (fds[slot].used != 0 && fds[slot].bucket == bucket &&
+                        fds[slot].pack_no == pack_no) {
+                        fds[slot].used = ++fd_clock;
+                        return fds[slot].fd;
+                }
+                if (fds[slot].used < fds[victim].used)
+                        victim = slot;
+        }
+        if (fds[victim].used != 0)
+                close(fds[victim].fd);
+        fds[victim].used = 0;
+        sprintf(filename, "%s/%02x", pack_path, bucket);
+        if (create && mkdir(filename, 0777) == -1 && errno != EEXIST) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                return -1;
+        }
+        sprintf(filename, "%s/%02x/%u.pack", pack_path, bucket, pack_no);
+        fds[victim].fd = open(filename, create ? O_CREAT|O_RDWR : O_RDWR,
+                S_IRUSR|S_IWUSR);
+        if (fds[victim].fd == -1) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                return -1;
+        }
+        fds[victim].bucket = bucket;
+        fds[victim].pack_no = pack_no;
+        fds[victim].used = ++fd_clock;
+        return fds[victim].fd;
+
+}
+
+/*Function to load the pack index into the pack table and find the pack
+each bucket appends to.
+Input:void
+Output:int
+*/
+static int
+load_pack_index()
+{
+
+        int     ret             =       -1;
+        int     fd              =       -1;
+        int     bucket          =        0;
+        uint64_t end            =        0;
+        DIGEST  record[MAX_DIGEST_LEN + 2 * sizeof(uint64_t)];
+        FILE    *fp             =       NULL;
+        struct pack_entry entry;
+
+        table_size = PACK_TABLE_INIT;
+        table_count = 0;
+        pack_table = (struct pack_entry *)calloc(table_size,
+                sizeof(struct pack_entry));
+        if (pack_table == NULL) {
+                fprintf(stderr, "Error in pack table allocation\n");
+                goto out;
+        }
+        memset(cur_pack, 0, sizeof(cur_pack));
+        memset(cur_size, 0, sizeof(cur_size));
+        if (-1 == lseek(fd_index, STORE_HEADER_SIZE, SEEK_SET)) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                goto out;
+        }
+        fd = dup(fd_index);
+        if (fd == -1) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                goto out;
+        }
+        fp = fdopen(fd, "r");
+        if (fp == NULL) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                close(fd);
+                goto out;
+        }
+        memset(&entry, 0, sizeof(entry));
+        while (fread(record, digest_len + 2 * sizeof(uint64_t), 1, fp) == 1) {
+                memcpy(entry.digest, record, digest_len);
+                entry.length = digest_len;
+                memcpy(&entry.pack_no, record + digest_len, sizeof(uint32_t));
+                memcpy(&entry.size, record + digest_len + sizeof(uint32_t),
+                        sizeof(uint32_t));
+                memcpy(&entry.offset, record + digest_len + sizeof(uint64_t),
+                        sizeof(uint64_t));
+                ret = pack_table_insert(&entry);
+                if (ret == -1)
+                        goto out;
+                bucket = entry.digest[0];
+                end = entry.offset + entry.size;
+                if (entry.pack_no > cur_pack[bucket]) {
+                        cur_pack[bucket] = entry.pack_no;
+                        cur_size[bucket] = end;
+                } else if (entry.pack_no == cur_pack[bucket] &&
+                        end > cur_size[bucket]) {
+                        cur_size[bucket] = end;
+                }
+        }
+        if (ferror(fp)) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                ret = -1;
+                goto out;
+        }
+        ret = 0;
+out:
+        if (fp != NULL)
+                fclose(fp);
+        return ret;
+
+}
+
+/*Function to open the pack store and load its index.
+Input:char *path,int length
+Output:int
+*/
+int
+init_pack_store(char *path, int length)
+{
+
+        int ret         =       -1;
+        char filename[1024];
+        struct store_header header;
+
+        sprintf(pack_path, "%s/packs", path);
+        if (mkdir(pack_path, 0777) == -1 && errno != EEXIST) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                goto out;
+        }
+        sprintf(filename, "%s/pack.idx", pack_path);
+        fd_index = open(filename, O_APPEND|O_CREAT|O_RDWR, S_IRUSR|S_IWUSR);
+        if (fd_index == -1) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                goto out;
+        }
+        ret = read_store_header(fd_index, PACK_INDEX_MAGIC, &header);
+        if (ret == -1)
+                goto out;
+        if (ret == 1) {
+                ret = write_store_header(fd_index, PACK_INDEX_MAGIC, length,
+                        STORE_TYPE_PACK);
+                if (ret == -1)
+                        goto out;
+        } else if (header.digest_len != (uint32_t)length) {
+                fprintf(stderr, "Pack index holds %u byte fingerprints, "
+                        "expected %d\n", header.digest_len, length);
+                ret = -1;
+                goto out;
+        }
+        digest_len = length;
+        ret = load_pack_index();
+out:
+        return ret;
+
+}
+
+/*Function to append a chunk to the current pack of its bucket. The length
+header and the chunk nodes go out in a single pwritev.
+Input:DIGEST *digest,vector_ptr list,size_t length
+Output:int
+*/
+int
+insert_block_to_pack(DIGEST *digest, vector_ptr list, size_t length)
+{
+
+        int ret                 =       -1;
+        int fd                  =       -1;
+        int bucket              =       digest[0];
+        uint32_t block_length   =       length;
+        struct pack_entry entry;
+        DIGEST record[MAX_DIGEST_LEN + 2 * sizeof(uint64_t)];
+
+        if (length <= 0 || list == NULL)
+                goto out;
+        if (pack_table_find(digest)->length != 0) {
+                ret = 1;
+                goto out;
+        }
+        if (cur_size[bucket] > 0 &&
+                cur_size[bucket] + PACK_RECORD_HEADER + length > PACK_SIZE) {
+                cur_pack[bucket]++;
+                cur_size[bucket] = 0;
+        }
+        fd = get_pack_fd(bucket, cur_pack[bucket], 1);
+        if (fd == -1)
+                goto out;
+        if (cur_size[bucket] == 0) {
+                if (ftruncate(fd, 0) == -1 || lseek(fd, 0, SEEK_SET) == -1) {
+                        fprintf(stderr, "%s\n", strerror(errno));
+                        goto out;
+                }
+                ret = write_store_header(fd, PACK_MAGIC, digest_len,
+                        STORE_TYPE_PACK);
+                if (ret == -1)
+                        goto out;
+                cur_size[bucket] = STORE_HEADER_SIZE;
+        }
+        if (vector_pwritev(fd, list, &block_length, PACK_RECORD_HEADER,
+                cur_size[bucket]) == -1) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                ret = -1;
+                goto out;
+        }
+        memset(&entry, 0, sizeof(entry));
+        memcpy(entry.digest, digest, digest_len);
+        entry.length = digest_len;
+        entry.pack_no = cur_pack[bucket];
+        entry.size = length;
+        entry.offset = cur_size[bucket] + PACK_RECORD_HEADER;
+        memcpy(record, digest, digest_len);
+        memcpy(record + digest_len, &entry.pack_no, sizeof(uint32_t));
+        memcpy(record + digest_len + sizeof(uint32_t), &entry.size,
+                sizeof(uint32_t));
+        memcpy(record + digest_len + sizeof(uint64_t), &entry.offset,
+                sizeof(uint64_t));
+        if (write(fd_index, record, digest_len + 2 * sizeof(uint64_t)) == -1) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                ret = -1;
+                goto out;
+        }
+        ret = pack_table_insert(&entry);
+        if (ret == -1)
+                goto out;
+        cur_size[bucket] += PACK_RECORD_HEADER + length;
+        ret = 0;
+out:
+        return ret;
+
+}
+
+/*Function to get a chunk from the pack store with a single pread.
+Input:DIGEST *digest
+Output:int *length
+*/
+char *
+get_block_from_pack(DIGEST *digest, int *length)
+{
+
+        int ret                 =       -1;
+        int fd                  =       -1;
+        char *buffer            =       NULL;
+        struct pack_entry *entry =      NULL;
+
+        entry = pack_table_find(digest);
+        if (entry->length == 0) {
+                fprintf(stderr, "Chunk missing from pack store\n");
+                goto out;
+        }
+        fd = get_pack_fd(digest[0], entry->pack_no, 0);
+        if (fd == -1)
+                goto out;
+        buffer = (char *)calloc(1, entry->size + 1);
+        if (buffer == NULL)
+                goto out;
+        if (pread(fd, buffer, entry->size, entry->offset) !=
+                (ssize_t)entry->size) {
+                fprintf(stderr, "Error while reading pack\n");
+                goto out;
+        }
+        *length = entry->size;
+        ret = 0;
+out:
+        if (ret == -1)
+                clean_buff(&buffer);
+        return buffer;
+
+}
+
+/*Function to find where a chunk is kept in the pack store.
+Input:DIGEST *digest
+Output:uint32_t *pack_no,uint64_t *offset
+*/
+int
+get_pack_location(DIGEST *digest, uint32_t *pack_no, uint64_t *offset)
+{
+
+        struct pack_entry *entry =      NULL;
+
+        entry = pack_table_find(digest);
+        if (entry->length == 0) {
+                fprintf(stderr, "Chunk missing from pack store\n");
+                return -1;
+        }
+        *pack_no = entry->pack_no;
+        *offset = entry->offset;
+        return 0;
+
+}
+
+/*Function to read bytes of a pack.
+Input:int bucket,uint32_t pack_no,uint64_t offset,char *buffer,
+size_t length
+Output:int
+*/
+int
+read_pack_region(int bucket, uint32_t pack_no, uint64_t offset,
+        char *buffer, size_t length)
+{
+
+        int fd                  =       -1;
+
+        fd = get_pack_fd(bucket, pack_no, 0);
+        if (fd == -1)
+                return -1;
+        if (pread(fd, buffer, length, offset) != (ssize_t)length) {
+                fprintf(stderr, "Error while reading pack\n");
+                return -1;
+        }
+        return 0;
+
+}
+
+/*Function to copy bytes of a pack into a file in the kernel.
+Input:int bucket,uint32_t pack_no,uint64_t offset,int fd_out,
+uint64_t out_offset,size_t length
+Output:int
+*/
+int
+copy_pack_region(int bucket, uint32_t pack_no, uint64_t offset, int fd_out,
+        uint64_t out_offset, size_t length)
+{
+
+        int fd                  =       -1;
+
+        fd = get_pack_fd(bucket, pack_no, 0);
+        if (fd == -1)
+                return -1;
+        return copy_file_region(fd, offset, fd_out, out_offset, length);
+
+}
+
+/*Function to close the pack store.
+Input:void
+Output:int
+*/
+int
+fini_pack_store()
+{
+
+        int ret         =       0;
+
+        pack_release_fds();
+        clean_buff((char **)&pack_table);
+        table_size = 0;
+        table_count = 0;
+        if (fd_index != -1) {
+                ret = close(fd_index);
+                fd_index = -1;
+        }
+        if (ret == -1)
+                fprintf(stderr, "%s\n", strerror(errno));
+        return ret;
+
+}
+
+/*Function to close the packs cached by the calling thread.
+Input:void
+Output:void
+*/
+void
+pack_release_fds()
+{
+
+        int slot        =       0;
+
+        for (slot = 0; slot < PACK_FD_CACHE; slot++) {
+                if (fds[slot].used != 0)
+                        close(fds[slot].fd);
+        }
+        memset(fds, 0, sizeof(fds));
+
+}
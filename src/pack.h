@@ -0,0 +1,107 @@
+#ifndef __PACK_H__
+#define __PACK_H__
+
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<unistd.h>
+#include<dirent.h>
+#include<errno.h>
+#include<stdint.h>
+#include<sys/stat.h>
+#include<sys/types.h>
+#include<sys/uio.h>
+#include<fcntl.h>
+#include "store_format.h"
+
+#define PACK_MAGIC              "YDLP"
+#define PACK_INDEX_MAGIC        "YDLI"
+#define PACK_BUCKETS            256
+#define PACK_SIZE               (64 << 20)
+#define PACK_FD_CACHE           64
+#define PACK_TABLE_INIT         1024
+#define PACK_RECORD_HEADER      sizeof(uint32_t)
+
+typedef struct vector *vector_ptr;
+
+typedef unsigned char DIGEST;
+
+/*Location of a chunk in the pack store. Packs are kept per fanout bucket,
+the first byte of the fingerprint, and roll over at PACK_SIZE:
+        store_block/packs/<bucket>/<pack_no>.pack
+A pack starts with a store header followed by uint32_t length, payload
+records. The pack index is a store header followed by
+digest[digest_len] uint32_t pack_no uint32_t length uint64_t offset
+records, offset being the start of the payload.
+*/
+struct pack_entry
+{
+        DIGEST digest[MAX_DIGEST_LEN];
+        int length;
+        uint32_t pack_no;
+        uint32_t size;
+        uint64_t offset;
+};
+
+/*@description:Function to open the pack store and load its index
+@in: char *path-path of store_block, int digest_len-length of fingerprints
+@out: int
+@return: -1 for error and 0 if opened successfully */
+int init_pack_store(char *path, int digest_len);
+
+/*@description:Function to append a chunk to the current pack of its bucket,
+chunks already in the store are not written again
+@in: DIGEST *digest-fingerprint of chunk, vector_ptr list-chunk,
+size_t length-size of chunk
+@out: int
+@return: -1 for error, 1 if the chunk was packed already and 0 if
+inserted successfully */
+int insert_block_to_pack(DIGEST *digest, vector_ptr list, size_t length);
+
+/*@description:Function to get a chunk from the pack store
+@in: DIGEST *digest-fingerprint of chunk
+@out: int *length-size of chunk
+@return: NULL for error and chunk otherwise */
+char *get_block_from_pack(DIGEST *digest, int *length);
+
+/*@description:Function to find where a chunk is kept in the pack store, the
+pack bucket is the first byte of the fingerprint
+@in: DIGEST *digest-fingerprint of chunk
+@out: uint32_t *pack_no-pack of the chunk, uint64_t *offset-offset of the
+payload in the pack
+@return: -1 for error and 0 if found */
+int get_pack_location(DIGEST *digest, uint32_t *pack_no, uint64_t *offset);
+
+/*@description:Function to read bytes of a pack in one go, the records of
+many chunks are read together this way
+@in: int bucket-pack bucket, uint32_t pack_no-pack, uint64_t offset-offset
+in the pack, size_t length-bytes to read
+@out: char *buffer-bytes read
+@return: -1 for error and 0 on success */
+int read_pack_region(int bucket, uint32_t pack_no, uint64_t offset,
+        char *buffer, size_t length);
+
+/*@description:Function to copy bytes of a pack into a file without reading
+them into memory
+@in: int bucket-pack bucket, uint32_t pack_no-pack, uint64_t offset-offset
+in the pack, int fd_out-file written, uint64_t out_offset-offset in fd_out,
+size_t length-bytes to copy
+@out: int
+@return: -1 for error and 0 on success */
+int copy_pack_region(int bucket, uint32_t pack_no, uint64_t offset,
+        int fd_out, uint64_t out_offset, size_t length);
+
+/*@description:Function to close the packs the calling thread read chunks
+from, every thread that called get_block_from_pack calls it before it exits
+@in: void
+@out: void
+@return: void */
+void pack_release_fds();
+
+/*@description:Function to close the pack store
+@in: void
+@out: int
+@return: -1 for error and 0 if closed successfully */
+int fini_pack_store();
+
+#endif
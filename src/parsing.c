@@ -29,11 +29,31 @@ int hex_to_int(char digit)
  * Output:char *str -- Hexadecimal hash value
  */
 char *parse(DIGEST *digest, int len)
+{
+
+        return parse_arena(NULL, digest, len);
+
+}
+
+/*
+ * Function to parse the hash byte char to hexadecimal hash value in memory
+ * of an arena.
+ * Input:struct arena *arena -- arena, NULL for calloc
+ * DIGEST -- byte char of hash.
+ * Output:char *str -- Hexadecimal hash value
+ */
+char *parse_arena(struct arena *arena, DIGEST *digest, int len)
 {
 
         int n;
-        char *out = (char *)calloc(1, len * 2 + 1);
+        char *out = NULL;
 
+        if (arena != NULL)
+                out = (char *)arena_alloc(arena, len * 2 + 1);
+        else
+                out = (char *)calloc(1, len * 2 + 1);
+        if (out == NULL)
+                return NULL;
         for (n = 0; n < len; ++n) {
                 snprintf(&(out[n*2]), 16 * 2, "%02x", (unsigned int)digest[n]);
         }
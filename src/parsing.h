@@ -3,6 +3,7 @@
 #include <ctype.h> 
 #include <stdlib.h>
 #include "md5.h"
+#include "arena.h"
 
 typedef unsigned char DIGEST;
 /*
@@ -19,6 +20,15 @@ int hex_to_int(char digit);
  */
 char *parse(DIGEST *digest, int len);
 
+/*
+ * Function to parse the hash byte char to hexadecimal hash value in memory
+ * of an arena, the string is not freed on its own.
+ * Input:struct arena *arena -- arena, NULL to allocate with calloc
+ * DIGEST -- byte char of hash.
+ * Output:char *str -- Hexadecimal hash value, NULL for error.
+ */
+char *parse_arena(struct arena *arena, DIGEST *digest, int len);
+
 /*
  * Function to unparse the hexadecimal to byte char.
  * Input:char *str -- Hexadecimal hash value
@@ -0,0 +1,394 @@
+#include "pipeline.h"
+
+/*State shared by the stages. The batches form a ring, batch n is filled,
+hashed and stored in turn and is filled again as batch n + nr_batches.
+        filled  : Batches filled by the chunker
+        claimed : Batches taken by the hashing threads
+        stored  : Batches stored by the calling thread
+        eof     : The chunker is done
+        error   : A stage failed, every stage stops
+The counters only grow and are guarded by lock, a batch is only touched
+by the stage its sequence number belongs to.*/
+struct pipeline
+{
+        struct chunker  *chunker;
+        const struct hash_provider *hash;
+        struct pipeline_batch *batches;
+        int             nr_batches;
+        uint64_t        filled;
+        uint64_t        claimed;
+        uint64_t        stored;
+        int             eof;
+        int             error;
+        pthread_mutex_t lock;
+        pthread_cond_t  cond;
+};
+
+/*Function to chunk, hash and store a file in the calling thread. The
+chunks of a read window are hashed together, so the multi-buffer kernels
+have enough independent chunks to fill their lanes.
+Input:struct chunker *chunker,const struct hash_provider *hash,
+pipeline_store_fn store,void *arg
+Output:int
+*/
+static int
+run_serial(struct chunker *chunker, const struct hash_provider *hash,
+        pipeline_store_fn store, void *arg)
+{
+
+        int             ret             =       -1;
+        int             count           =        0;
+        int             i               =        0;
+        DIGEST          digest[PIPELINE_HASH_BATCH][MAX_DIGEST_LEN];
+        DIGEST          *digests[PIPELINE_HASH_BATCH];
+        struct chunk_slice slices[PIPELINE_HASH_BATCH];
+        struct vector   chunk;
+
+        vector_init(&chunk);
+        for (i = 0; i < PIPELINE_HASH_BATCH; i++)
+                digests[i] = digest[i];
+        while ((count = chunker_next_batch(chunker, slices,
+                PIPELINE_HASH_BATCH)) > 0) {
+                ret = hash_batch(hash, slices, digests, count);
+                if (ret == -1)
+                        goto out;
+                for (i = 0; i < count; i++) {
+                        vector_reset(&chunk);
+                        ret = vector_append(&chunk, (void *)slices[i].data,
+                                slices[i].length);
+                        if (ret == -1)
+                                goto out;
+                        ret = store(arg, &chunk, slices[i].offset, digest[i],
+                                hash->digest_len);
+                        if (ret == -1)
+                                goto out;
+                }
+        }
+        ret = count;
+        if (ret == -1)
+                fprintf(stderr, "Error in chunking\n");
+out:
+        vector_free(&chunk);
+        return ret;
+
+}
+
+/*Function to stop every stage after a failure.
+Input:struct pipeline *pipe
+Output:void
+*/
+static void
+pipeline_fail(struct pipeline *pipe)
+{
+
+        pthread_mutex_lock(&pipe->lock);
+        pipe->error = 1;
+        pthread_cond_broadcast(&pipe->cond);
+        pthread_mutex_unlock(&pipe->lock);
+
+}
+
+/*Function to copy a chunk into a batch.
+Input:struct pipeline_batch *batch,struct chunk_slice *slice
+Output:int
+*/
+static int
+batch_add(struct pipeline_batch *batch, struct chunk_slice *slice)
+{
+
+        int             ret     =       -1;
+        int             alloc   =        0;
+        char            *buf    =       NULL;
+        struct pipeline_chunk *chunks = NULL;
+
+        if (batch->size < slice->length) {
+                buf = (char *)realloc(batch->buf, slice->length);
+                if (buf == NULL)
+                        goto out;
+                batch->buf = buf;
+                batch->size = slice->length;
+        }
+        if (batch->count == batch->alloc) {
+                alloc = batch->alloc ? batch->alloc * 2 : 64;
+                chunks = (struct pipeline_chunk *)realloc(batch->chunks,
+                        alloc * sizeof(struct pipeline_chunk));
+                if (chunks == NULL)
+                        goto out;
+                batch->chunks = chunks;
+                batch->alloc = alloc;
+        }
+        memcpy(batch->buf + batch->used, slice->data, slice->length);
+        batch->chunks[batch->count].pos = batch->used;
+        batch->chunks[batch->count].length = slice->length;
+        batch->chunks[batch->count].offset = slice->offset;
+        batch->count++;
+        batch->used += slice->length;
+        ret = 0;
+out:
+        if (ret == -1)
+                fprintf(stderr, "Error in batch allocation\n");
+        return ret;
+
+}
+
+/*Function of the chunker thread. The slices point into the chunker
+window, which moves on the next read, so they are copied into the batch.
+Input:void *arg - struct pipeline
+Output:void*
+*/
+static void *
+chunk_stage(void *arg)
+{
+
+        struct pipeline *pipe           =       (struct pipeline *)arg;
+        struct pipeline_batch *batch    =       NULL;
+        struct chunk_slice slice;
+        int             ret             =       -1;
+        int             pending         =        0;
+
+        memset(&slice, 0, sizeof(slice));
+        while (1) {
+                pthread_mutex_lock(&pipe->lock);
+                while (!pipe->error &&
+                        pipe->filled - pipe->stored >=
+                        (uint64_t)pipe->nr_batches)
+                        pthread_cond_wait(&pipe->cond, &pipe->lock);
+                ret = pipe->error ? -1 : 0;
+                pthread_mutex_unlock(&pipe->lock);
+                if (ret == -1)
+                        break;
+                batch = &pipe->batches[pipe->filled % pipe->nr_batches];
+                batch->used = 0;
+                batch->count = 0;
+                batch->hashed = 0;
+                /* A chunk that did not fit the last batch starts this one */
+                if (pending) {
+                        ret = batch_add(batch, &slice);
+                        if (ret == -1)
+                                break;
+                        pending = 0;
+                }
+                while ((ret = chunker_next(pipe->chunker, &slice)) == 1) {
+                        if (batch->count > 0 &&
+                                batch->used + slice.length > batch->size) {
+                                pending = 1;
+                                break;
+                        }
+                        ret = batch_add(batch, &slice);
+                        if (ret == -1)
+                                break;
+                }
+                if (ret == -1) {
+                        fprintf(stderr, "Error in chunking\n");
+                        break;
+                }
+                pthread_mutex_lock(&pipe->lock);
+                if (batch->count > 0)
+                        pipe->filled++;
+                if (ret == 0)
+                        pipe->eof = 1;
+                pthread_cond_broadcast(&pipe->cond);
+                pthread_mutex_unlock(&pipe->lock);
+                if (ret == 0)
+                        break;
+        }
+        if (ret == -1)
+                pipeline_fail(pipe);
+        return NULL;
+
+}
+
+/*Function of a hashing thread, it takes the next filled batch and hashes
+its chunks PIPELINE_HASH_BATCH at a time.
+Input:void *arg - struct pipeline
+Output:void*
+*/
+static void *
+hash_stage(void *arg)
+{
+
+        struct pipeline *pipe           =       (struct pipeline *)arg;
+        struct pipeline_batch *batch    =       NULL;
+        struct pipeline_chunk *chunk    =       NULL;
+        struct chunk_slice slices[PIPELINE_HASH_BATCH];
+        DIGEST          *digests[PIPELINE_HASH_BATCH];
+        int             ret             =        0;
+        int             count           =        0;
+        int             i               =        0;
+
+        while (1) {
+                pthread_mutex_lock(&pipe->lock);
+                while (!pipe->error && !pipe->eof &&
+                        pipe->claimed == pipe->filled)
+                        pthread_cond_wait(&pipe->cond, &pipe->lock);
+                if (pipe->error || pipe->claimed == pipe->filled) {
+                        pthread_mutex_unlock(&pipe->lock);
+                        break;
+                }
+                batch = &pipe->batches[pipe->claimed % pipe->nr_batches];
+                pipe->claimed++;
+                pthread_mutex_unlock(&pipe->lock);
+                for (i = 0; i < batch->count; i++) {
+                        chunk = &batch->chunks[i];
+                        slices[count].data = batch->buf + chunk->pos;
+                        slices[count].length = chunk->length;
+                        slices[count].offset = chunk->offset;
+                        digests[count] = chunk->digest;
+                        chunk->h_length = pipe->hash->digest_len;
+                        if (++count < PIPELINE_HASH_BATCH &&
+                                i + 1 < batch->count)
+                                continue;
+                        ret = hash_batch(pipe->hash, slices, digests, count);
+                        count = 0;
+                        if (ret == -1)
+                                break;
+                }
+                if (ret == -1) {
+                        pipeline_fail(pipe);
+                        break;
+                }
+                pthread_mutex_lock(&pipe->lock);
+                batch->hashed = 1;
+                pthread_cond_broadcast(&pipe->cond);
+                pthread_mutex_unlock(&pipe->lock);
+        }
+        return NULL;
+
+}
+
+/*Function of the store stage, run by the calling thread. Batches are
+stored in the order they were filled, whichever thread hashed them.
+Input:struct pipeline *pipe,pipeline_store_fn store,void *arg
+Output:int
+*/
+static int
+store_stage(struct pipeline *pipe, pipeline_store_fn store, void *arg)
+{
+
+        struct pipeline_batch *batch    =       NULL;
+        struct pipeline_chunk *chunk    =       NULL;
+        struct vector   list;
+        int             ret             =       -1;
+        int             i               =        0;
+
+        vector_init(&list);
+        while (1) {
+                pthread_mutex_lock(&pipe->lock);
+                batch = &pipe->batches[pipe->stored % pipe->nr_batches];
+                while (!pipe->error && !(pipe->stored < pipe->filled &&
+                        batch->hashed) &&
+                        !(pipe->eof && pipe->stored == pipe->filled))
+                        pthread_cond_wait(&pipe->cond, &pipe->lock);
+                if (pipe->error) {
+                        pthread_mutex_unlock(&pipe->lock);
+                        ret = -1;
+                        break;
+                }
+                if (pipe->stored == pipe->filled) {
+                        pthread_mutex_unlock(&pipe->lock);
+                        ret = 0;
+                        break;
+                }
+                pthread_mutex_unlock(&pipe->lock);
+                for (i = 0; i < batch->count; i++) {
+                        chunk = &batch->chunks[i];
+                        vector_reset(&list);
+                        ret = vector_append(&list, batch->buf + chunk->pos,
+                                chunk->length);
+                        if (ret == -1)
+                                break;
+                        ret = store(arg, &list, chunk->offset, chunk->digest,
+                                chunk->h_length);
+                        if (ret == -1)
+                                break;
+                }
+                if (ret == -1) {
+                        pipeline_fail(pipe);
+                        break;
+                }
+                pthread_mutex_lock(&pipe->lock);
+                pipe->stored++;
+                pthread_cond_broadcast(&pipe->cond);
+                pthread_mutex_unlock(&pipe->lock);
+        }
+        vector_free(&list);
+        return ret;
+
+}
+
+/*Function to chunk, hash and store a file, in stages when there are
+hashing threads.
+Input:struct chunker *chunker,const struct hash_provider *hash,int threads,
+pipeline_store_fn store,void *arg
+Output:int
+*/
+int
+run_pipeline(struct chunker *chunker, const struct hash_provider *hash,
+        int threads, pipeline_store_fn store, void *arg)
+{
+
+        int             ret             =       -1;
+        int             i               =        0;
+        int             started         =        0;
+        int             chunker_started =        0;
+        pthread_t       chunk_thread;
+        pthread_t       hash_threads[PIPELINE_MAX_THREADS];
+        struct pipeline pipe;
+
+        if (threads < 1)
+                return run_serial(chunker, hash, store, arg);
+        if (threads > PIPELINE_MAX_THREADS)
+                threads = PIPELINE_MAX_THREADS;
+        memset(&pipe, 0, sizeof(pipe));
+        pipe.chunker = chunker;
+        pipe.hash = hash;
+        pipe.nr_batches = threads * PIPELINE_BATCH_DEPTH;
+        pthread_mutex_init(&pipe.lock, NULL);
+        pthread_cond_init(&pipe.cond, NULL);
+        pipe.batches = (struct pipeline_batch *)calloc(pipe.nr_batches,
+                sizeof(struct pipeline_batch));
+        if (pipe.batches == NULL) {
+                fprintf(stderr, "Error in batch allocation\n");
+                goto out;
+        }
+        for (i = 0; i < pipe.nr_batches; i++) {
+                pipe.batches[i].buf = (char *)malloc(PIPELINE_BATCH_SIZE);
+                if (pipe.batches[i].buf == NULL) {
+                        fprintf(stderr, "Error in batch allocation\n");
+                        goto out;
+                }
+                pipe.batches[i].size = PIPELINE_BATCH_SIZE;
+        }
+        if (pthread_create(&chunk_thread, NULL, chunk_stage, &pipe) != 0) {
+                fprintf(stderr, "Error in creating chunker thread\n");
+                goto out;
+        }
+        chunker_started = 1;
+        for (started = 0; started < threads; started++) {
+                if (pthread_create(&hash_threads[started], NULL, hash_stage,
+                        &pipe) != 0) {
+                        fprintf(stderr, "Error in creating hashing thread\n");
+                        pipeline_fail(&pipe);
+                        goto out;
+                }
+        }
+        ret = store_stage(&pipe, store, arg);
+out:
+        if (chunker_started)
+                pthread_join(chunk_thread, NULL);
+        for (i = 0; i < started; i++)
+                pthread_join(hash_threads[i], NULL);
+        if (pipe.error)
+                ret = -1;
+        if (pipe.batches != NULL) {
+                for (i = 0; i < pipe.nr_batches; i++) {
+                        free(pipe.batches[i].buf);
+                        free(pipe.batches[i].chunks);
+                }
+                free(pipe.batches);
+        }
+        pthread_cond_destroy(&pipe.cond);
+        pthread_mutex_destroy(&pipe.lock);
+        return ret;
+
+}
@@ -0,0 +1,86 @@
+#ifndef __PIPELINE_H__
+#define __PIPELINE_H__
+
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<stdint.h>
+#include<pthread.h>
+#include "dedup.h"
+#include "store_format.h"
+#include "Rabin_Karp.h"
+#include "hash_batch.h"
+
+/* Bytes of chunks handed from stage to stage at once, a chunk longer than
+ * this gets a batch of its own */
+#define PIPELINE_BATCH_SIZE     (1 << 20)
+/* Batches in flight for every hashing thread */
+#define PIPELINE_BATCH_DEPTH    2
+#define PIPELINE_MAX_THREADS    64
+/* Chunks fingerprinted by one hash_batch() call */
+#define PIPELINE_HASH_BATCH     256
+
+/*Chunk of a batch.
+        pos      : Offset of the chunk in the batch buffer
+        length   : Length of the chunk
+        offset   : Offset of the chunk in the file
+        digest   : Fingerprint, set by the hashing stage
+        h_length : Length of the fingerprint
+*/
+struct pipeline_chunk
+{
+        size_t          pos;
+        size_t          length;
+        uint64_t        offset;
+        DIGEST          digest[MAX_DIGEST_LEN];
+        int             h_length;
+};
+
+/*Chunks copied out of the chunker window, the unit passed between the
+stages. A batch is filled by the chunker, hashed by one hashing thread
+and stored by the calling thread, in the order it was filled.*/
+struct pipeline_batch
+{
+        char            *buf;
+        size_t          size;
+        size_t          used;
+        struct pipeline_chunk *chunks;
+        int             count;
+        int             alloc;
+        int             hashed;
+};
+
+/*@description:Function called for every chunk in file order by the store
+stage.
+Input:
+        void *arg       : Argument given to run_pipeline()
+        vector_ptr chunk : Chunk
+        uint64_t offset : Offset of the chunk in the file
+        DIGEST *digest  : Fingerprint of the chunk
+        int h_length    : Length of the fingerprint
+Output:
+        int             : 0 on success, -1 on failure
+*/
+typedef int (*pipeline_store_fn)(void *arg, vector_ptr chunk,
+        uint64_t offset, DIGEST *digest, int h_length);
+
+/*@description:Function to chunk, hash and store a file. Without hashing
+threads the calling thread hashes the chunks of every read window with one
+hash_batch() call and stores them in turn.
+Otherwise the file is read and chunked by a thread of its own, the chunks
+are hashed in batches by the hashing threads and stored by the calling
+thread in file order, so the stores see exactly what the serial path gives
+them.
+Input:
+        struct chunker *chunker : Chunker fed with the file
+        const struct hash_provider *hash : Fingerprint algorithm
+        int threads     : Number of hashing threads, 0 for none
+        pipeline_store_fn store : Function to store a chunk
+        void *arg       : Argument of store
+Output:
+        int             : 0 on success, -1 on failure
+*/
+int run_pipeline(struct chunker *chunker, const struct hash_provider *hash,
+        int threads, pipeline_store_fn store, void *arg);
+
+#endif
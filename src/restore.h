@@ -1,3 +1,6 @@
+#ifndef __RESTORE_H__
+#define __RESTORE_H__
+
 #include<stdio.h>
 #include<string.h>  
 #include<stdlib.h> 
@@ -8,6 +11,7 @@
 #include<sys/stat.h>
 #include<sys/types.h>
 #include<fcntl.h>
+#include<stdint.h>
 #include<time.h> 
 #include <libgen.h> 
 #include<openssl/md5.h>
@@ -24,33 +28,88 @@
 #define NAME_SIZE 100
 #define int_size sizeof(int)
 #define FILE_SIZE  200
+#include "store_format.h"
+
+typedef unsigned char DIGEST;
 
 /*@description:Function to get the position of specific block in hash
-@in: char* hash-hash
-@out: int 
+@in: DIGEST *digest-fingerprint of block
+@out: uint64_t *offset-position of the block in blockstore
 @return: -1 for error and 0 if found. */
-int getposition(char* hash);
+int getposition(DIGEST *digest, uint64_t *offset);
+
+/*Bytes of a file to restore.
+        offset : First byte
+        length : Number of bytes, RESTORE_TO_END for the rest of the file
+*/
+struct restore_range
+{
+        uint64_t        offset;
+        uint64_t        length;
+};
+
+#define RESTORE_TO_END  UINT64_MAX
+
+/*How to restore a file.
+        threads    : Threads fetching chunks, 0 to restore in one thread
+        cache_size : Bytes of chunks kept for reuse, 0 to keep none
+        faa_size   : Bytes of the forward assembly area, 0 to read the
+                     chunks in stub order
+        zero_copy  : 1 to copy chunks in stub order from the store to the
+                     file in the kernel, 0 to read them into memory
+        name       : Name the file was deduped under, NULL for its path
+*/
+struct restore_options
+{
+        int             threads;
+        size_t          cache_size;
+        size_t          faa_size;
+        int             zero_copy;
+        char            *name;
+};
 
-/*@description:Function to restore file.  
-@in: char* path-path of file to be restored
+/*@description:Function to restore file. A range is written into the file at
+its own offset without truncating the file, the chunks before it are found
+through the stub index and only the chunks overlapping it are read. A file
+restored to stdout is written in one thread in stub order and the progress
+messages go to stderr.
+@in: char* path-path of file to be restored, "-" for stdout,char *store_path-store path of
+namespace,struct restore_range *range-bytes to restore, NULL for all,
+struct restore_options *options-how to restore
 @out: int
 @return: -1 for error and 0 if found. */
-int restorefile(char* path, char *store_path);
+int restorefile(char* path, char *store_path, struct restore_range *range,
+        struct restore_options *options);
 
 /*@description:Function to search whether file path is present or not.If present will call restorefile to restore file. 
-@in: void
+@in: char *file_path-path of file, "-" for stdout,char *store_path-store path of namespace,
+struct restore_range *range-bytes to restore, NULL for all,
+struct restore_options *options-how to restore
 @out: int
 @return: -1 for error and 0 if found. */
-int restore_file(char *file_path, char *store_path);
+int restore_file(char *file_path, char *store_path,
+        struct restore_range *range, struct restore_options *options);
 
 /*@description:Function to get specific block from specified position 
-@in: int pos-position of block,
+@in: uint64_t pos-position of block,
 @out: char*
 @return: block */
-char* get_block(int pos, int *length);
+char* get_block(uint64_t pos, int *length);
 
 /*@description:Function to get specific block from object
 @in: char *hash - hash of block
 @out: char*
 @return: block */
 char *get_block_from_object(char *hash,int *length, char *store_path);
+
+/*@description:Function to copy bytes of a block from its object into a file
+without reading them into memory
+@in: char *hash - hash of block, char *store_path-store path of namespace,
+uint64_t from-first byte of the block, int fd_out-file written,
+uint64_t out_offset-offset in fd_out, size_t length-bytes to copy
+@out: int
+@return: -1 for error and 0 on success */
+int copy_block_from_object(char *hash, char *store_path, uint64_t from,
+        int fd_out, uint64_t out_offset, size_t length);
+
+#endif
@@ -0,0 +1,251 @@
+#include "restore_cache.h"
+#include "clean_buff.h"
+
+/*Function to find the bucket of a fingerprint.
+Input:struct chunk_cache *cache,DIGEST *digest
+Output:struct cache_entry** - head of the bucket
+*/
+static struct cache_entry **
+cache_bucket(struct chunk_cache *cache, DIGEST *digest)
+{
+
+        uint64_t        key     =       0;
+
+        memcpy(&key, digest, sizeof(key));
+        return &cache->buckets[key & (cache->nr_buckets - 1)];
+
+}
+
+/*Function to find a cached chunk by its fingerprint.
+Input:struct chunk_cache *cache,DIGEST *digest
+Output:struct cache_entry*
+*/
+static struct cache_entry *
+cache_find(struct chunk_cache *cache, DIGEST *digest)
+{
+
+        struct cache_entry *entry       =       NULL;
+
+        for (entry = *cache_bucket(cache, digest); entry != NULL;
+                entry = entry->hash_next) {
+                if (memcmp(entry->digest, digest, cache->digest_len) == 0)
+                        break;
+        }
+        return entry;
+
+}
+
+/*Function to unlink a chunk from the recently used list.
+Input:struct chunk_cache *cache,struct cache_entry *entry
+Output:void
+*/
+static void
+lru_unlink(struct chunk_cache *cache, struct cache_entry *entry)
+{
+
+        if (entry->prev != NULL)
+                entry->prev->next = entry->next;
+        else
+                cache->head = entry->next;
+        if (entry->next != NULL)
+                entry->next->prev = entry->prev;
+        else
+                cache->tail = entry->prev;
+        entry->prev = NULL;
+        entry->next = NULL;
+
+}
+
+/*Function to link a chunk as the most recently used.
+Input:struct chunk_cache *cache,struct cache_entry *entry
+Output:void
+*/
+static void
+lru_push(struct chunk_cache *cache, struct cache_entry *entry)
+{
+
+        entry->prev = NULL;
+        entry->next = cache->head;
+        if (cache->head != NULL)
+                cache->head->prev = entry;
+        else
+                cache->tail = entry;
+        cache->head = entry;
+
+}
+
+/*Function to take a chunk out of the cache and free it.
+Input:struct chunk_cache *cache,struct cache_entry *entry
+Output:void
+*/
+static void
+cache_evict(struct chunk_cache *cache, struct cache_entry *entry)
+{
+
+        struct cache_entry **link       =       NULL;
+
+        link = cache_bucket(cache, entry->digest);
+        while (*link != entry)
+                link = &(*link)->hash_next;
+        *link = entry->hash_next;
+        lru_unlink(cache, entry);
+        cache->bytes -= sizeof(struct cache_entry) + entry->length;
+        cache->evictions++;
+        clean_buff(&entry->data);
+        free(entry);
+
+}
+
+/*Function to initialize an empty chunk cache. The buckets are sized for
+chunks of 4 KiB.
+Input:struct chunk_cache *cache,size_t capacity,int digest_len
+Output:int
+*/
+int
+chunk_cache_init(struct chunk_cache *cache, size_t capacity, int digest_len)
+{
+
+        int             ret     =       -1;
+
+        memset(cache, 0, sizeof(*cache));
+        cache->capacity = capacity;
+        cache->digest_len = digest_len;
+        cache->nr_buckets = RESTORE_CACHE_MIN_BUCKETS;
+        while (cache->nr_buckets < capacity / 4096)
+                cache->nr_buckets *= 2;
+        cache->buckets = (struct cache_entry **)calloc(cache->nr_buckets,
+                sizeof(struct cache_entry *));
+        if (cache->buckets == NULL) {
+                fprintf(stderr, "Error in restore cache allocation\n");
+                goto out;
+        }
+        pthread_mutex_init(&cache->lock, NULL);
+        ret = 0;
+out:
+        return ret;
+
+}
+
+/*Function to look up a chunk and hold it for the caller.
+Input:struct chunk_cache *cache,DIGEST *digest
+Output:struct cache_entry*
+*/
+struct cache_entry *
+chunk_cache_get(struct chunk_cache *cache, DIGEST *digest)
+{
+
+        struct cache_entry *entry       =       NULL;
+
+        pthread_mutex_lock(&cache->lock);
+        entry = cache_find(cache, digest);
+        if (entry != NULL) {
+                entry->refs++;
+                lru_unlink(cache, entry);
+                lru_push(cache, entry);
+                cache->hits++;
+        } else {
+                cache->misses++;
+        }
+        pthread_mutex_unlock(&cache->lock);
+        return entry;
+
+}
+
+/*Function to add a chunk read from the store and hold it for the caller.
+Input:struct chunk_cache *cache,DIGEST *digest,char *data,int length
+Output:struct cache_entry*
+*/
+struct cache_entry *
+chunk_cache_insert(struct chunk_cache *cache, DIGEST *digest, char *data,
+        int length)
+{
+
+        size_t          size            =       0;
+        struct cache_entry *entry       =       NULL;
+        struct cache_entry *victim      =       NULL;
+        struct cache_entry *prev        =       NULL;
+        struct cache_entry **bucket     =       NULL;
+
+        size = sizeof(struct cache_entry) + length;
+        pthread_mutex_lock(&cache->lock);
+        entry = cache_find(cache, digest);
+        if (entry != NULL) {
+                entry->refs++;
+                clean_buff(&data);
+                goto out;
+        }
+        entry = (struct cache_entry *)calloc(1, sizeof(struct cache_entry));
+        if (entry == NULL) {
+                fprintf(stderr, "Error in restore cache allocation\n");
+                clean_buff(&data);
+                goto out;
+        }
+        memcpy(entry->digest, digest, cache->digest_len);
+        entry->data = data;
+        entry->length = length;
+        entry->refs = 1;
+        if (size > cache->capacity)
+                goto out;
+        /* Chunks held by other threads stay, the cache goes over capacity
+         * by at most one chunk per thread */
+        victim = cache->tail;
+        while (cache->bytes + size > cache->capacity && victim != NULL) {
+                prev = victim->prev;
+                if (victim->refs == 0)
+                        cache_evict(cache, victim);
+                victim = prev;
+        }
+        bucket = cache_bucket(cache, digest);
+        entry->hash_next = *bucket;
+        *bucket = entry;
+        entry->cached = 1;
+        lru_push(cache, entry);
+        cache->bytes += size;
+out:
+        pthread_mutex_unlock(&cache->lock);
+        return entry;
+
+}
+
+/*Function to drop the hold of the caller on a chunk.
+Input:struct chunk_cache *cache,struct cache_entry *entry
+Output:void
+*/
+void
+chunk_cache_release(struct chunk_cache *cache, struct cache_entry *entry)
+{
+
+        pthread_mutex_lock(&cache->lock);
+        entry->refs--;
+        if (entry->cached == 0 && entry->refs == 0) {
+                clean_buff(&entry->data);
+                free(entry);
+        }
+        pthread_mutex_unlock(&cache->lock);
+
+}
+
+/*Function to free every chunk of the cache.
+Input:struct chunk_cache *cache
+Output:void
+*/
+void
+chunk_cache_free(struct chunk_cache *cache)
+{
+
+        struct cache_entry *entry       =       NULL;
+
+        if (cache->buckets == NULL)
+                return;
+        while ((entry = cache->head) != NULL) {
+                cache->head = entry->next;
+                clean_buff(&entry->data);
+                free(entry);
+        }
+        cache->tail = NULL;
+        cache->bytes = 0;
+        free(cache->buckets);
+        cache->buckets = NULL;
+        pthread_mutex_destroy(&cache->lock);
+
+}
@@ -0,0 +1,97 @@
+#ifndef __RESTORE_CACHE_H__
+#define __RESTORE_CACHE_H__
+
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<stdint.h>
+#include<pthread.h>
+#include "restore.h"
+
+/* Default memory of the restore chunk cache in MiB */
+#define RESTORE_CACHE_SIZE      64
+#define RESTORE_CACHE_MIN_BUCKETS 1024
+
+/*Chunk read during a restore. Chunks in the cache are linked from the most
+to the least recently used, a chunk is only evicted when no thread holds it.
+        data   : Contents of the chunk
+        length : Length of the chunk
+        refs   : Threads holding the chunk
+        cached : 1 if the chunk is in the cache, 0 if it is freed on release
+*/
+struct cache_entry
+{
+        DIGEST          digest[MAX_DIGEST_LEN];
+        char            *data;
+        int             length;
+        int             refs;
+        int             cached;
+        struct cache_entry *hash_next;
+        struct cache_entry *prev;
+        struct cache_entry *next;
+};
+
+/*Bounded LRU cache of the chunks of a restore, keyed by fingerprint. It is
+shared by the restore threads.
+        capacity  : Memory of the cached chunks in bytes, 0 to cache nothing
+        bytes     : Memory held by the cached chunks
+        head/tail : Most and least recently used chunk
+        hits      : Lookups served from the cache
+        misses    : Lookups that went to the store
+        evictions : Chunks dropped to make room
+*/
+struct chunk_cache
+{
+        struct cache_entry **buckets;
+        size_t          nr_buckets;
+        size_t          capacity;
+        size_t          bytes;
+        int             digest_len;
+        struct cache_entry *head;
+        struct cache_entry *tail;
+        uint64_t        hits;
+        uint64_t        misses;
+        uint64_t        evictions;
+        pthread_mutex_t lock;
+};
+
+/*@description:Function to initialize an empty chunk cache
+@in: struct chunk_cache *cache-cache, size_t capacity-memory of the cached
+chunks in bytes, 0 to cache nothing, int digest_len-length of fingerprints
+@out: int
+@return: -1 for error and 0 on success */
+int chunk_cache_init(struct chunk_cache *cache, size_t capacity,
+        int digest_len);
+
+/*@description:Function to look up a chunk by its fingerprint. A chunk found
+is held for the caller until chunk_cache_release
+@in: struct chunk_cache *cache-cache, DIGEST *digest-fingerprint
+@out: struct cache_entry *
+@return: NULL if the chunk is not cached and the chunk otherwise */
+struct cache_entry *chunk_cache_get(struct chunk_cache *cache,
+        DIGEST *digest);
+
+/*@description:Function to add a chunk read from the store. The cache takes
+over data, least recently used chunks are evicted to make room. A chunk
+larger than the cache is not cached and is freed on release. If another
+thread added the same chunk first, data is freed and that chunk is returned
+@in: struct chunk_cache *cache-cache, DIGEST *digest-fingerprint,
+char *data-contents of the chunk, int length-length of the chunk
+@out: struct cache_entry *
+@return: NULL for error and the chunk held for the caller otherwise */
+struct cache_entry *chunk_cache_insert(struct chunk_cache *cache,
+        DIGEST *digest, char *data, int length);
+
+/*@description:Function to drop the hold of the caller on a chunk
+@in: struct chunk_cache *cache-cache, struct cache_entry *entry-chunk
+@out: void
+@return: void */
+void chunk_cache_release(struct chunk_cache *cache, struct cache_entry *entry);
+
+/*@description:Function to free every chunk of the cache
+@in: struct chunk_cache *cache-cache
+@out: void
+@return: void */
+void chunk_cache_free(struct chunk_cache *cache);
+
+#endif
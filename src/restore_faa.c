@@ -0,0 +1,271 @@
+#include "restore_faa.h"
+#include "stub.h"
+
+/*Function to order chunks by their place in the store, chunks without a
+region go last.
+Input:const void *a,const void *b - struct faa_chunk
+Output:int
+*/
+static int
+region_compare(const void *a, const void *b)
+{
+
+        const struct faa_chunk *x       =       (const struct faa_chunk *)a;
+        const struct faa_chunk *y       =       (const struct faa_chunk *)b;
+
+        if (x->located != y->located)
+                return y->located - x->located;
+        if (x->region.file != y->region.file)
+                return x->region.file < y->region.file ? -1 : 1;
+        if (x->region.offset != y->region.offset)
+                return x->region.offset < y->region.offset ? -1 : 1;
+        return 0;
+
+}
+
+/*Function to copy the part of a chunk inside the window to its place.
+Input:char *faa,uint64_t base,uint64_t end,struct faa_chunk *chunk,
+char *data,uint64_t length - bytes of data
+Output:void
+*/
+static void
+scatter(char *faa, uint64_t base, uint64_t end, struct faa_chunk *chunk,
+        char *data, uint64_t length)
+{
+
+        uint64_t        from    =       0;
+        uint64_t        to      =       0;
+
+        from = chunk->b_offset < base ? base - chunk->b_offset : 0;
+        to = chunk->b_offset + chunk->length > end ? end - chunk->b_offset :
+                chunk->length;
+        if (to > length)
+                to = length;
+        if (from < to)
+                memcpy(faa + (chunk->b_offset + from - base), data + from,
+                        to - from);
+
+}
+
+/*Function to fill the window base to end with its chunks. Runs of chunks
+of the same file no more than RESTORE_FAA_GAP apart are read with one
+read_region.
+Input:struct restore_source *source,struct faa_chunk *chunks,int nr_chunks,
+char *faa,uint64_t base,uint64_t end,char **read_buf,size_t *read_size
+Output:struct faa_stats *stats
+*/
+static int
+assemble_window(struct restore_source *source, struct faa_chunk *chunks,
+        int nr_chunks, char *faa, uint64_t base, uint64_t end,
+        char **read_buf, size_t *read_size, struct faa_stats *stats)
+{
+
+        int             i               =        0;
+        int             j               =        0;
+        int             k               =        0;
+        int             length          =        0;
+        uint64_t        start           =        0;
+        uint64_t        stop            =        0;
+        uint64_t        tail            =        0;
+        char            *data           =       NULL;
+        char            *tmp            =       NULL;
+        void            *chunk          =       NULL;
+
+        qsort(chunks, nr_chunks, sizeof(struct faa_chunk), region_compare);
+        for (i = 0; i < nr_chunks; i = j) {
+                if (!chunks[i].located) {
+                        data = source->fetch(source->arg, chunks[i].digest,
+                                &length, &chunk);
+                        if (data == NULL)
+                                return -1;
+                        scatter(faa, base, end, &chunks[i], data, length);
+                        source->release(source->arg, chunk);
+                        stats->reads++;
+                        stats->bytes_read += length;
+                        j = i + 1;
+                        continue;
+                }
+                start = chunks[i].region.offset;
+                stop = start + chunks[i].length;
+                for (j = i + 1; j < nr_chunks; j++) {
+                        tail = chunks[j].region.offset + chunks[j].length;
+                        if (!chunks[j].located ||
+                                chunks[j].region.file != chunks[i].region.file ||
+                                chunks[j].region.offset > stop +
+                                RESTORE_FAA_GAP ||
+                                (tail > stop ? tail : stop) - start >
+                                RESTORE_FAA_READ)
+                                break;
+                        if (tail > stop)
+                                stop = tail;
+                }
+                if (stop - start > *read_size) {
+                        tmp = (char *)realloc(*read_buf, stop - start);
+                        if (tmp == NULL) {
+                                fprintf(stderr, "Error in restore buffer "
+                                        "allocation\n");
+                                return -1;
+                        }
+                        *read_buf = tmp;
+                        *read_size = stop - start;
+                }
+                if (source->read_region(source->arg, chunks[i].region.file,
+                        start, *read_buf, stop - start) == -1)
+                        return -1;
+                stats->reads++;
+                stats->bytes_read += stop - start;
+                for (k = i; k < j; k++)
+                        scatter(faa, base, end, &chunks[k], *read_buf +
+                                (chunks[k].region.offset - start),
+                                chunks[k].length);
+        }
+        stats->windows++;
+        stats->chunks += nr_chunks;
+        return 0;
+
+}
+
+/*Function to write a window of the file at its offset.
+Input:int fd_out,char *faa,uint64_t base,uint64_t end
+Output:int
+*/
+static int
+write_window(int fd_out, char *faa, uint64_t base, uint64_t end)
+{
+
+        uint64_t        done    =       0;
+        ssize_t         count   =       0;
+
+        while (done < end - base) {
+                count = pwrite(fd_out, faa + done, end - base - done,
+                        base + done);
+                if (count == -1) {
+                        if (errno == EINTR)
+                                continue;
+                        fprintf(stderr, "%s\n", strerror(errno));
+                        return -1;
+                }
+                done += count;
+        }
+        return 0;
+
+}
+
+/*Function to restore a range of a file through a forward assembly area.
+Input:struct stub_reader *reader,struct restore_source *source,
+size_t budget,uint64_t first,uint64_t last,int fd_out
+Output:struct faa_stats *stats
+*/
+int
+run_restore_faa(struct stub_reader *reader, struct restore_source *source,
+        size_t budget, uint64_t first, uint64_t last, int fd_out,
+        struct faa_stats *stats)
+{
+
+        int             ret             =       -1;
+        int             pending         =        0;
+        int             eof             =        0;
+        int             nr_chunks       =        0;
+        int             alloc_chunks    =        0;
+        uint64_t        base            =       first;
+        uint64_t        end             =        0;
+        uint64_t        e_offset        =        0;
+        size_t          faa_size        =       budget;
+        size_t          read_size       =       RESTORE_FAA_READ;
+        char            *faa            =       NULL;
+        char            *read_buf       =       NULL;
+        void            *tmp            =       NULL;
+        struct faa_chunk *chunks        =       NULL;
+        struct faa_chunk next;
+
+        memset(stats, 0, sizeof(*stats));
+        faa = (char *)malloc(faa_size);
+        read_buf = (char *)malloc(read_size);
+        alloc_chunks = RESTORE_FAA_CHUNKS;
+        chunks = (struct faa_chunk *)calloc(alloc_chunks,
+                sizeof(struct faa_chunk));
+        if (faa == NULL || read_buf == NULL || chunks == NULL) {
+                fprintf(stderr, "Error in restore buffer allocation\n");
+                goto out;
+        }
+        while (1) {
+                /* Take the chunks ending inside the window, the first
+                 * chunk is taken whatever its size */
+                nr_chunks = 0;
+                while (!eof) {
+                        if (!pending) {
+                                ret = stub_reader_next(reader, next.digest,
+                                        &next.b_offset, &e_offset);
+                                if (ret == -1)
+                                        goto out;
+                                if (ret == 0) {
+                                        eof = 1;
+                                        break;
+                                }
+                                next.length = e_offset - next.b_offset + 1;
+                                pending = 1;
+                        }
+                        if (e_offset < first) {
+                                pending = 0;
+                                continue;
+                        }
+                        if (next.b_offset >= last) {
+                                eof = 1;
+                                break;
+                        }
+                        if (nr_chunks > 0 && e_offset >= base + faa_size)
+                                break;
+                        if (nr_chunks == alloc_chunks) {
+                                tmp = realloc(chunks, alloc_chunks * 2 *
+                                        sizeof(struct faa_chunk));
+                                if (tmp == NULL) {
+                                        fprintf(stderr, "Error in restore "
+                                                "buffer allocation\n");
+                                        ret = -1;
+                                        goto out;
+                                }
+                                chunks = (struct faa_chunk *)tmp;
+                                alloc_chunks *= 2;
+                        }
+                        ret = source->locate(source->arg, next.digest,
+                                &next.region);
+                        if (ret == -1)
+                                goto out;
+                        next.located = ret == 0;
+                        chunks[nr_chunks++] = next;
+                        pending = 0;
+                }
+                if (nr_chunks == 0)
+                        break;
+                end = chunks[nr_chunks - 1].b_offset +
+                        chunks[nr_chunks - 1].length;
+                if (end > last)
+                        end = last;
+                if (end - base > faa_size) {
+                        tmp = realloc(faa, end - base);
+                        if (tmp == NULL) {
+                                fprintf(stderr, "Error in restore buffer "
+                                        "allocation\n");
+                                ret = -1;
+                                goto out;
+                        }
+                        faa = (char *)tmp;
+                        faa_size = end - base;
+                }
+                ret = assemble_window(source, chunks, nr_chunks, faa, base,
+                        end, &read_buf, &read_size, stats);
+                if (ret == -1)
+                        goto out;
+                ret = write_window(fd_out, faa, base, end);
+                if (ret == -1)
+                        goto out;
+                base = end;
+        }
+        ret = 0;
+out:
+        free(faa);
+        free(read_buf);
+        free(chunks);
+        return ret;
+
+}
@@ -0,0 +1,67 @@
+#ifndef __RESTORE_FAA_H__
+#define __RESTORE_FAA_H__
+
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<stdint.h>
+#include<errno.h>
+#include<unistd.h>
+#include "restore_pool.h"
+
+/* Chunks of a file further apart than this are not read together */
+#define RESTORE_FAA_GAP         (16 << 10)
+/* Largest read of a region, the size of a container */
+#define RESTORE_FAA_READ        (4 << 20)
+#define RESTORE_FAA_CHUNKS      1024
+
+/*Chunk of the window being assembled.
+        b_offset : Beginning offset of the chunk in the file
+        length   : Length of the chunk
+        located  : 1 if region is set, 0 if the chunk is fetched on its own
+*/
+struct faa_chunk
+{
+        DIGEST          digest[MAX_DIGEST_LEN];
+        uint64_t        b_offset;
+        uint64_t        length;
+        int             located;
+        struct chunk_region region;
+};
+
+/*Counters of a forward assembly restore.
+        windows    : Windows of the file assembled
+        chunks     : Chunks copied into the windows
+        reads      : Reads issued to the store
+        bytes_read : Bytes read from the store
+*/
+struct faa_stats
+{
+        uint64_t        windows;
+        uint64_t        chunks;
+        uint64_t        reads;
+        uint64_t        bytes_read;
+};
+
+/*@description:Function to restore the bytes first to last - 1 of a file
+through a forward assembly area. The stub is read a window of the file at a
+time, the chunks of the window are sorted by their place in the store and
+neighbouring chunks are read together, then copied to their place in the
+window, which is written out in one go.
+Input:
+        struct stub_reader *reader : Reader of the stub, at or before the
+                                     record of first
+        struct restore_source *source : Store of the chunks
+        size_t budget   : Bytes of the assembly area
+        uint64_t first  : First byte to restore
+        uint64_t last   : Byte after the last to restore
+        int fd_out      : File descriptor of the restored file
+Output:
+        struct faa_stats *stats : Counters of the restore
+        int             : 0 on success, -1 on failure
+*/
+int run_restore_faa(struct stub_reader *reader, struct restore_source *source,
+        size_t budget, uint64_t first, uint64_t last, int fd_out,
+        struct faa_stats *stats);
+
+#endif
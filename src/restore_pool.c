@@ -0,0 +1,244 @@
+#include "restore_pool.h"
+#include "stub.h"
+
+/*State shared by the stub reader and the fetching threads. The jobs form a
+ring, a fetching thread copies a job out when it takes it so the slot is
+free again at once.
+        queued : Jobs added by the stub reader
+        taken  : Jobs taken by the fetching threads
+        eof    : The stub reader is done
+        error  : A thread failed, every thread stops
+The counters only grow and are guarded by lock.*/
+struct restore_pool
+{
+        struct restore_source *source;
+        struct restore_job *jobs;
+        int             nr_jobs;
+        uint64_t        first;
+        uint64_t        last;
+        int             fd_out;
+        uint64_t        queued;
+        uint64_t        taken;
+        int             eof;
+        int             error;
+        pthread_mutex_t lock;
+        pthread_cond_t  cond;
+};
+
+/*Function to stop every thread after a failure.
+Input:struct restore_pool *pool
+Output:void
+*/
+static void
+restore_pool_fail(struct restore_pool *pool)
+{
+
+        pthread_mutex_lock(&pool->lock);
+        pool->error = 1;
+        pthread_cond_broadcast(&pool->cond);
+        pthread_mutex_unlock(&pool->lock);
+
+}
+
+/*Function to find the part of a chunk inside the restored range.
+Input:struct restore_pool *pool,struct restore_job *job
+Output:uint64_t *from,uint64_t *to - bytes of the chunk
+*/
+static void
+chunk_span(struct restore_pool *pool, struct restore_job *job,
+        uint64_t *from, uint64_t *to)
+{
+
+        *from = job->b_offset < pool->first ? pool->first - job->b_offset : 0;
+        *to = job->e_offset < pool->last ? job->e_offset - job->b_offset + 1 :
+                pool->last - job->b_offset;
+
+}
+
+/*Function to write the part of a chunk inside the restored range at its
+offset in the file.
+Input:struct restore_pool *pool,struct restore_job *job,char *buffer,
+int length
+Output:int
+*/
+static int
+write_chunk(struct restore_pool *pool, struct restore_job *job,
+        char *buffer, int length)
+{
+
+        uint64_t        from    =       0;
+        uint64_t        to      =       0;
+        ssize_t         count   =       0;
+
+        chunk_span(pool, job, &from, &to);
+        if (to > (uint64_t)length)
+                to = length;
+        while (from < to) {
+                count = pwrite(pool->fd_out, buffer + from, to - from,
+                        job->b_offset + from);
+                if (count == -1) {
+                        if (errno == EINTR)
+                                continue;
+                        fprintf(stderr, "%s\n", strerror(errno));
+                        return -1;
+                }
+                from += count;
+        }
+        return 0;
+
+}
+
+/*Function of a fetching thread, it takes the next job, reads its chunk
+from the store and writes it.
+Input:void *arg - struct restore_pool
+Output:void*
+*/
+static void *
+fetch_stage(void *arg)
+{
+
+        struct restore_pool *pool       =       (struct restore_pool *)arg;
+        struct restore_job job;
+        char            *buffer         =       NULL;
+        void            *chunk          =       NULL;
+        uint64_t        from            =        0;
+        uint64_t        to              =        0;
+        int             length          =        0;
+        int             ret             =        0;
+
+        while (1) {
+                pthread_mutex_lock(&pool->lock);
+                while (!pool->error && !pool->eof &&
+                        pool->taken == pool->queued)
+                        pthread_cond_wait(&pool->cond, &pool->lock);
+                if (pool->error || pool->taken == pool->queued) {
+                        pthread_mutex_unlock(&pool->lock);
+                        break;
+                }
+                job = pool->jobs[pool->taken % pool->nr_jobs];
+                pool->taken++;
+                pthread_cond_broadcast(&pool->cond);
+                pthread_mutex_unlock(&pool->lock);
+                if (pool->source->copy_chunk != NULL) {
+                        chunk_span(pool, &job, &from, &to);
+                        if (pool->source->copy_chunk(pool->source->arg,
+                                job.digest, from, to - from, pool->fd_out,
+                                job.b_offset + from) == -1) {
+                                restore_pool_fail(pool);
+                                break;
+                        }
+                        continue;
+                }
+                buffer = pool->source->fetch(pool->source->arg, job.digest,
+                        &length, &chunk);
+                if (buffer == NULL) {
+                        restore_pool_fail(pool);
+                        break;
+                }
+                ret = write_chunk(pool, &job, buffer, length);
+                pool->source->release(pool->source->arg, chunk);
+                if (ret == -1) {
+                        restore_pool_fail(pool);
+                        break;
+                }
+        }
+        if (pool->source->thread_done != NULL)
+                pool->source->thread_done(pool->source->arg);
+        return NULL;
+
+}
+
+/*Function to read the stub ahead and queue the chunks inside the range.
+Input:struct restore_pool *pool,struct stub_reader *reader
+Output:int
+*/
+static int
+queue_stage(struct restore_pool *pool, struct stub_reader *reader)
+{
+
+        struct restore_job job;
+        int             ret     =       -1;
+
+        while ((ret = stub_reader_next(reader, job.digest, &job.b_offset,
+                &job.e_offset)) == 1) {
+                if (job.e_offset < pool->first)
+                        continue;
+                if (job.b_offset >= pool->last)
+                        break;
+                pthread_mutex_lock(&pool->lock);
+                while (!pool->error && pool->queued - pool->taken >=
+                        (uint64_t)pool->nr_jobs)
+                        pthread_cond_wait(&pool->cond, &pool->lock);
+                if (pool->error) {
+                        pthread_mutex_unlock(&pool->lock);
+                        return -1;
+                }
+                pool->jobs[pool->queued % pool->nr_jobs] = job;
+                pool->queued++;
+                pthread_cond_signal(&pool->cond);
+                pthread_mutex_unlock(&pool->lock);
+        }
+        return ret == -1 ? -1 : 0;
+
+}
+
+/*Function to restore a range of a file with a pool of fetching threads.
+Input:struct stub_reader *reader,struct restore_source *source,int threads,
+uint64_t first,uint64_t last,int fd_out
+Output:int
+*/
+int
+run_restore_pool(struct stub_reader *reader, struct restore_source *source,
+        int threads, uint64_t first, uint64_t last, int fd_out)
+{
+
+        int             ret             =       -1;
+        int             i               =        0;
+        int             started         =        0;
+        pthread_t       fetch_threads[RESTORE_MAX_THREADS];
+        struct restore_pool pool;
+
+        if (threads < 1)
+                threads = 1;
+        if (threads > RESTORE_MAX_THREADS)
+                threads = RESTORE_MAX_THREADS;
+        memset(&pool, 0, sizeof(pool));
+        pool.source = source;
+        pool.first = first;
+        pool.last = last;
+        pool.fd_out = fd_out;
+        pool.nr_jobs = threads * RESTORE_QUEUE_DEPTH;
+        pthread_mutex_init(&pool.lock, NULL);
+        pthread_cond_init(&pool.cond, NULL);
+        pool.jobs = (struct restore_job *)calloc(pool.nr_jobs,
+                sizeof(struct restore_job));
+        if (pool.jobs == NULL) {
+                fprintf(stderr, "Error in restore queue allocation\n");
+                goto out;
+        }
+        for (started = 0; started < threads; started++) {
+                if (pthread_create(&fetch_threads[started], NULL, fetch_stage,
+                        &pool) != 0) {
+                        fprintf(stderr, "Error in creating restore thread\n");
+                        restore_pool_fail(&pool);
+                        goto out;
+                }
+        }
+        ret = queue_stage(&pool, reader);
+        if (ret == -1)
+                restore_pool_fail(&pool);
+out:
+        pthread_mutex_lock(&pool.lock);
+        pool.eof = 1;
+        pthread_cond_broadcast(&pool.cond);
+        pthread_mutex_unlock(&pool.lock);
+        for (i = 0; i < started; i++)
+                pthread_join(fetch_threads[i], NULL);
+        if (pool.error)
+                ret = -1;
+        free(pool.jobs);
+        pthread_cond_destroy(&pool.cond);
+        pthread_mutex_destroy(&pool.lock);
+        return ret;
+
+}
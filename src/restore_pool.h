@@ -0,0 +1,89 @@
+#ifndef __RESTORE_POOL_H__
+#define __RESTORE_POOL_H__
+
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<stdint.h>
+#include<errno.h>
+#include<unistd.h>
+#include<pthread.h>
+#include "restore.h"
+
+struct stub_reader;
+
+/* Stub records read ahead for every fetching thread */
+#define RESTORE_QUEUE_DEPTH     64
+#define RESTORE_MAX_THREADS     64
+
+/*Chunk of the file waiting to be fetched and written.
+        digest   : Fingerprint from the stub
+        b_offset : Beginning offset of the chunk in the file
+        e_offset : Ending offset of the chunk in the file
+*/
+struct restore_job
+{
+        DIGEST          digest[MAX_DIGEST_LEN];
+        uint64_t        b_offset;
+        uint64_t        e_offset;
+};
+
+/*Place of a chunk in the store, the payload starts at offset of file.
+Chunks of the same file close to each other can be read together.*/
+struct chunk_region
+{
+        uint64_t        file;
+        uint64_t        offset;
+};
+
+/*Store the chunks of a file are fetched from.
+        fetch       : Function to read a chunk by its fingerprint, NULL for
+                      error. It is called from many threads at once and
+                      sets chunk to what release takes back.
+        release     : Function called once the chunk is written
+        thread_done : Function called by every fetching thread before it
+                      exits, to drop what the store cached for the thread
+        locate      : Function to find the region of a chunk, 0 if found,
+                      1 if the store has no regions and -1 for error
+        read_region : Function to read length bytes at offset of file
+        copy_chunk  : Function to copy length bytes of a chunk, from its
+                      byte from, to out_offset of fd_out in the kernel.
+                      NULL to fetch the chunks into memory.
+        arg         : Argument of the functions
+*/
+struct restore_source
+{
+        char            *(*fetch)(void *arg, DIGEST *digest, int *length,
+                                void **chunk);
+        void            (*release)(void *arg, void *chunk);
+        void            (*thread_done)(void *arg);
+        int             (*locate)(void *arg, DIGEST *digest,
+                                struct chunk_region *region);
+        int             (*read_region)(void *arg, uint64_t file,
+                                uint64_t offset, char *buffer, size_t length);
+        int             (*copy_chunk)(void *arg, DIGEST *digest,
+                                uint64_t from, size_t length, int fd_out,
+                                uint64_t out_offset);
+        void            *arg;
+};
+
+/*@description:Function to restore the bytes first to last - 1 of a file
+from its stub. The calling thread reads the stub ahead, the chunks are
+fetched by a pool of threads and written with pwrite at their own offsets
+in whatever order the fetches finish.
+Input:
+        struct stub_reader *reader : Reader of the stub, at or before the
+                                     record of first
+        struct restore_source *source : Store of the chunks
+        int threads     : Number of fetching threads
+        uint64_t first  : First byte to restore
+        uint64_t last   : Byte after the last to restore
+        int fd_out      : File descriptor of the restored file
+Output:
+        int             : 0 on success, -1 on failure
+*/
+int run_restore_pool(struct stub_reader *reader,
+        struct restore_source *source, int threads, uint64_t first,
+        uint64_t last, int fd_out);
+
+#endif
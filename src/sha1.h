@@ -5,8 +5,11 @@
 #include<string.h>
 #include "vector.h"
 
+typedef unsigned char DIGEST;
+
 /*@description:Function to create hash using sha1.
-@in: char str[]-Buffer to store block for which the hash is generated,int length-length of block
-@out: char*-returns hash of block using sha1
-@return: hash */
-char* sha1(vector_ptr list);
+@in: vector_ptr list-Vector to store block for which the hash is generated,
+DIGEST *digest-20 byte buffer for the fingerprint
+@out: DIGEST*-returns 20 byte fingerprint of block using sha1
+@return: digest */
+DIGEST *sha1(vector_ptr list, DIGEST *digest);
@@ -0,0 +1,169 @@
+#include "store_format.h"
+
+/*Function to write the header of a store file.
+Input:int fd,const char *magic,uint32_t digest_len,uint32_t store_type
+Output:int
+*/
+int
+write_store_header(int fd, const char *magic, uint32_t digest_len,
+uint32_t store_type)
+{
+
+        int ret                         =       -1;
+        struct store_header header;
+
+        memset(&header, 0, STORE_HEADER_SIZE);
+        memcpy(header.magic, magic, MAGIC_LEN);
+        header.version = STORE_FORMAT_VERSION;
+        header.digest_len = digest_len;
+        header.store_type = store_type;
+        if (write(fd, &header, STORE_HEADER_SIZE) != STORE_HEADER_SIZE) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                goto out;
+        }
+        ret = 0;
+out:
+        return ret;
+
+}
+
+/*Function to read and validate the header of a store file. Files written
+before the header was introduced are rejected so that they are not
+misread; they have to be upgraded with --convert first.
+Input:int fd,const char *magic,struct store_header *header
+Output:int
+*/
+int
+read_store_header(int fd, const char *magic, struct store_header *header)
+{
+
+        int ret         =       -1;
+        struct stat     st;
+
+        if (fstat(fd, &st) == -1) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                goto out;
+        }
+        if (st.st_size == 0) {
+                ret = 1;
+                goto out;
+        }
+        if (pread(fd, header, STORE_HEADER_SIZE, 0) != STORE_HEADER_SIZE ||
+                memcmp(header->magic, magic, MAGIC_LEN) != 0) {
+                fprintf(stderr, "Store is in an old on-disk format, "
+                        "upgrade it with $>yadl --convert -n <namespace>\n");
+                goto out;
+        }
+        if (header->version != STORE_FORMAT_VERSION &&
+                !(memcmp(magic, STUB_STORE_MAGIC, MAGIC_LEN) == 0 &&
+                  header->version == STUB_FORMAT_VERSION)) {
+                fprintf(stderr, "Unsupported store format version %u\n",
+                        header->version);
+                goto out;
+        }
+        ret = 0;
+out:
+        return ret;
+
+}
+
+/*Function to copy bytes through a pipe with splice.
+Input:int fd_in,loff_t *off_in,int fd_out,loff_t *off_out,size_t *length
+Output:int - 0 once copied, 1 if splice is not supported, -1 for error
+*/
+static int
+splice_region(int fd_in, loff_t *off_in, int fd_out, loff_t *off_out,
+        size_t *length)
+{
+
+        int             ret             =       -1;
+        int             pipe_fd[2]      =       {-1, -1};
+        ssize_t         in              =        0;
+        ssize_t         out             =        0;
+
+        if (pipe(pipe_fd) == -1) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                goto out;
+        }
+        while (*length > 0) {
+                in = splice(fd_in, off_in, pipe_fd[1], NULL, *length,
+                        SPLICE_F_MOVE);
+                if (in == -1 && (errno == EINVAL || errno == ENOSYS)) {
+                        ret = 1;
+                        goto out;
+                }
+                if (in <= 0) {
+                        fprintf(stderr, "Error while copying chunk\n");
+                        goto out;
+                }
+                while (in > 0) {
+                        out = splice(pipe_fd[0], NULL, fd_out, off_out, in,
+                                SPLICE_F_MOVE);
+                        if (out <= 0) {
+                                fprintf(stderr, "Error while copying "
+                                        "chunk\n");
+                                goto out;
+                        }
+                        in -= out;
+                        *length -= out;
+                }
+        }
+        ret = 0;
+out:
+        if (pipe_fd[0] != -1)
+                close(pipe_fd[0]);
+        if (pipe_fd[1] != -1)
+                close(pipe_fd[1]);
+        return ret;
+
+}
+
+/*Function to copy bytes of a store file into another file in the kernel,
+falling back to a buffer when neither copy_file_range nor splice work.
+Input:int fd_in,uint64_t off_in,int fd_out,uint64_t off_out,size_t length
+Output:int
+*/
+int
+copy_file_region(int fd_in, uint64_t off_in, int fd_out, uint64_t off_out,
+        size_t length)
+{
+
+        int             ret             =       -1;
+        ssize_t         count           =        0;
+        loff_t          in              =       off_in;
+        loff_t          out             =       off_out;
+        char            buffer[COPY_BUFFER_SIZE];
+
+        while (length > 0) {
+                count = copy_file_range(fd_in, &in, fd_out, &out, length, 0);
+                if (count == -1 && errno == EINTR)
+                        continue;
+                if (count <= 0)
+                        break;
+                length -= count;
+        }
+        if (length == 0)
+                return 0;
+        if (count == 0 || (errno != EXDEV && errno != EINVAL &&
+                errno != ENOSYS && errno != EOPNOTSUPP)) {
+                fprintf(stderr, "Error while copying chunk\n");
+                return -1;
+        }
+        ret = splice_region(fd_in, &in, fd_out, &out, &length);
+        if (ret != 1)
+                return ret;
+        while (length > 0) {
+                count = pread(fd_in, buffer, length < COPY_BUFFER_SIZE ?
+                        length : COPY_BUFFER_SIZE, in);
+                if (count <= 0 || pwrite(fd_out, buffer, count, out) !=
+                        count) {
+                        fprintf(stderr, "Error while copying chunk\n");
+                        return -1;
+                }
+                in += count;
+                out += count;
+                length -= count;
+        }
+        return 0;
+
+}
@@ -0,0 +1,79 @@
+#ifndef __STORE_FORMAT_H__
+#define __STORE_FORMAT_H__
+
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<unistd.h>
+#include<errno.h>
+#include<stdint.h>
+#include<sys/stat.h>
+#include<sys/types.h>
+#include<fcntl.h>
+
+#define STORE_FORMAT_VERSION    1
+/* Stubs with compact records, see stub.h */
+#define STUB_FORMAT_VERSION     2
+#define MAGIC_LEN               4
+#define HASH_STORE_MAGIC        "YDLH"
+#define BLOCK_STORE_MAGIC       "YDLB"
+#define STUB_STORE_MAGIC        "YDLS"
+#define STUB_INDEX_MAGIC        "YDLX"
+#define FILE_INFO_MAGIC         "YDLW"
+#define MAX_DIGEST_LEN          32
+
+/* store_type recorded in stub headers */
+#define STORE_TYPE_DEFAULT      0
+#define STORE_TYPE_OBJECT       1
+#define STORE_TYPE_CONTAINER    2
+#define STORE_TYPE_PACK         3
+
+/*Header at the start of every hash store, block store and stub file.
+Records that follow are fixed width:
+        hash store  : digest[digest_len] uint64_t offset
+        block store : uint32_t length, payload
+        stub        : digest[digest_len] uint64_t b_offset uint64_t e_offset
+Stubs of STUB_FORMAT_VERSION have variable width records instead:
+        stub        : digest[digest_len] varint length
+*/
+struct store_header
+{
+        char magic[MAGIC_LEN];
+        uint32_t version;
+        uint32_t digest_len;
+        uint32_t store_type;
+};
+
+#define STORE_HEADER_SIZE sizeof(struct store_header)
+#define COPY_BUFFER_SIZE        (64 << 10)
+
+/*@description:Function to write the header of a store file.
+@in: int fd-file descriptor positioned at the start of the file,
+const char *magic-magic of the store, uint32_t digest_len-length of the
+fingerprints, uint32_t store_type-store the chunks are kept in
+@out: int
+@return: -1 for error and 0 if written successfully */
+int write_store_header(int fd, const char *magic, uint32_t digest_len,
+        uint32_t store_type);
+
+/*@description:Function to read and validate the header of a store file.
+@in: int fd-file descriptor of store file, const char *magic-expected
+magic of the store
+@out: struct store_header *header-header read from the file
+@return: -1 for error, 1 if the file is empty and 0 if header is valid */
+int read_store_header(int fd, const char *magic, struct store_header *header);
+
+/*@description:Function to copy bytes of a store file into another file
+without passing them through user space. copy_file_range shares the extents
+on filesystems that support reflinks, splice and then pread/pwrite are used
+where it is not supported. Neither file offset is moved, so many threads
+can copy at once.
+@in: int fd_in-store file, uint64_t off_in-offset in the store file,
+int fd_out-file written, uint64_t off_out-offset in fd_out,
+size_t length-bytes to copy
+@out: int
+@return: -1 for error and 0 if copied */
+int copy_file_region(int fd_in, uint64_t off_in, int fd_out,
+        uint64_t off_out, size_t length);
+
+#endif
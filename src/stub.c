@@ -1,6 +1,7 @@
 #include "stub.h"
 #include "catalog.h"
 #include "clean_buff.h"
+#include "store_format.h"
 
 /*
  * Function to write contents to a stub file.
@@ -43,19 +44,429 @@ out:
 
 }
 
+/*
+ * Function to build the path of the file holding the stub of a whole file
+ * digest.
+ * Input:char *path,DIGEST *digest,int digest_len
+ * Output:char *whole_path
+ */
+static void
+whole_file_path(char *whole_path, char *path, DIGEST *digest, int digest_len)
+{
+
+        int     i       =       0;
+        int     used    =       0;
+
+        used = sprintf(whole_path, "%s/store_block/stubs/Whole_", path);
+        for (i = 0; i < digest_len; i++)
+                used += sprintf(whole_path + used, "%02x", digest[i]);
+
+}
+
+/*
+ * Function to read Info_<filename>, a record of another key or format is
+ * taken as no record.
+ * Input:char *path,char *filename,char *key
+ * Output:struct file_info *info
+ */
+int
+read_file_info(char *path, char *filename, char *key, struct file_info *info)
+{
+
+        int ret         =       -1;
+        int fd          =       -1;
+        char *stored    =     NULL;
+        char info_path[1024];
+        struct store_header header;
+
+        sprintf(info_path, "%s/store_block/stubs/Info_%s", path, filename);
+        fd = open(info_path, O_RDONLY);
+        if (fd == -1) {
+                if (errno == ENOENT)
+                        ret = 1;
+                else
+                        fprintf(stderr, "%s: %s\n", info_path,
+                                strerror(errno));
+                goto out;
+        }
+        ret = 1;
+        if (read(fd, &header, STORE_HEADER_SIZE) != STORE_HEADER_SIZE ||
+                memcmp(header.magic, FILE_INFO_MAGIC, MAGIC_LEN) != 0 ||
+                header.version != STORE_FORMAT_VERSION ||
+                read(fd, info, sizeof(*info)) != sizeof(*info) ||
+                info->digest_len > MAX_DIGEST_LEN)
+                goto out;
+        if (key != NULL) {
+                if (info->key_len != strlen(key))
+                        goto out;
+                stored = (char *)malloc(info->key_len + 1);
+                if (stored == NULL) {
+                        fprintf(stderr, "%s\n", strerror(errno));
+                        ret = -1;
+                        goto out;
+                }
+                if (read(fd, stored, info->key_len) !=
+                        (ssize_t)info->key_len ||
+                        memcmp(stored, key, info->key_len) != 0)
+                        goto out;
+        }
+        ret = 0;
+out:
+        clean_buff(&stored);
+        if (fd != -1)
+                close(fd);
+        return ret;
+
+}
+
+/*
+ * Function to read the names of the stubs listed in Whole_<digest>, each
+ * name ends with a NUL.
+ * Input:char *path,DIGEST *digest,int digest_len
+ * Output:char **names - NULL and 1 if there is no stub for the digest,
+ * size_t *length - bytes of names
+ */
+static int
+read_whole_file(char *path, DIGEST *digest, int digest_len, char **names,
+size_t *length)
+{
+
+        int ret         =       -1;
+        int fd          =       -1;
+        ssize_t count   =        0;
+        struct stat     st;
+        char whole_path[1024 + 2 * MAX_DIGEST_LEN];
+
+        *names = NULL;
+        *length = 0;
+        whole_file_path(whole_path, path, digest, digest_len);
+        fd = open(whole_path, O_RDONLY);
+        if (fd == -1) {
+                if (errno == ENOENT)
+                        ret = 1;
+                else
+                        fprintf(stderr, "%s: %s\n", whole_path,
+                                strerror(errno));
+                goto out;
+        }
+        if (fstat(fd, &st) == -1) {
+                fprintf(stderr, "%s: %s\n", whole_path, strerror(errno));
+                goto out;
+        }
+        *names = (char *)malloc(st.st_size + 1);
+        if (*names == NULL) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                goto out;
+        }
+        count = read(fd, *names, st.st_size);
+        if (count == -1) {
+                fprintf(stderr, "%s: %s\n", whole_path, strerror(errno));
+                goto out;
+        }
+        (*names)[count] = '\0';
+        *length = count;
+        ret = count > 0 ? 0 : 1;
+out:
+        if (ret != 0)
+                clean_buff(names);
+        if (fd != -1)
+                close(fd);
+        return ret;
+
+}
+
+/*
+ * Function to write the names of the stubs of a digest to Whole_<digest>,
+ * the file is removed once no stub is left.
+ * Input:char *path,DIGEST *digest,int digest_len,char *names,size_t length
+ * Output:int
+ */
+static int
+write_whole_file(char *path, DIGEST *digest, int digest_len, char *names,
+size_t length)
+{
+
+        int ret         =       -1;
+        int fd          =       -1;
+        char whole_path[1024 + 2 * MAX_DIGEST_LEN];
+
+        whole_file_path(whole_path, path, digest, digest_len);
+        if (length == 0) {
+                if (remove(whole_path) == -1 && errno != ENOENT) {
+                        fprintf(stderr, "%s\n", strerror(errno));
+                        goto out;
+                }
+                ret = 0;
+                goto out;
+        }
+        fd = open(whole_path, O_CREAT|O_WRONLY|O_TRUNC, S_IWUSR|S_IRUSR);
+        if (fd == -1 || write(fd, names, length) != (ssize_t)length) {
+                fprintf(stderr, "%s: %s\n", whole_path, strerror(errno));
+                goto out;
+        }
+        ret = 0;
+out:
+        if (fd != -1)
+                close(fd);
+        return ret;
+
+}
+
+/*
+ * Function to remove Info_<filename> and take the stub off the list of
+ * Whole_<digest>, the other stubs of the digest stay on it.
+ * Input:char *path,char *filename
+ * Output:int
+ */
+static int
+release_file_info(char *path, char *filename)
+{
+
+        int ret         =       -1;
+        size_t length   =        0;
+        size_t used     =        0;
+        size_t skip     =        0;
+        char *names     =     NULL;
+        char *name      =     NULL;
+        char info_path[1024];
+        struct file_info info;
+
+        ret = read_file_info(path, filename, NULL, &info);
+        if (ret == -1)
+                goto out;
+        if (ret == 1) {
+                ret = 0;
+                goto out;
+        }
+        ret = read_whole_file(path, info.digest, info.digest_len, &names,
+                &length);
+        if (ret == -1)
+                goto out;
+        if (ret == 0) {
+                for (name = names; name < names + length; name += skip) {
+                        skip = strlen(name) + 1;
+                        if (strcmp(name, filename) == 0)
+                                continue;
+                        memmove(names + used, name, skip);
+                        used += skip;
+                }
+                ret = write_whole_file(path, info.digest, info.digest_len,
+                        names, used);
+                if (ret == -1)
+                        goto out;
+        }
+        sprintf(info_path, "%s/store_block/stubs/Info_%s", path, filename);
+        if (remove(info_path) == -1) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                ret = -1;
+                goto out;
+        }
+        ret = 0;
+out:
+        clean_buff(&names);
+        return ret;
+
+}
+
+/*
+ * Function to write Info_<filename> and add the stub to the list of
+ * Whole_<digest>, in place of the digest the stub had before.
+ * Input:char *path,char *filename,char *key,struct file_info *info
+ * Output:int
+ */
+int
+write_file_info(char *path, char *filename, char *key, struct file_info *info)
+{
+
+        int ret         =       -1;
+        int fd          =       -1;
+        size_t length   =        0;
+        size_t skip     =        0;
+        char *names     =     NULL;
+        char *name      =     NULL;
+        char *tmp       =     NULL;
+        char info_path[1024];
+
+        ret = release_file_info(path, filename);
+        if (ret == -1)
+                goto out;
+        ret = -1;
+        info->key_len = strlen(key);
+        sprintf(info_path, "%s/store_block/stubs/Info_%s", path, filename);
+        fd = open(info_path, O_CREAT|O_WRONLY|O_TRUNC, S_IWUSR|S_IRUSR);
+        if (fd == -1) {
+                fprintf(stderr, "%s: %s\n", info_path, strerror(errno));
+                goto out;
+        }
+        if (write_store_header(fd, FILE_INFO_MAGIC, info->digest_len, 0) ==
+                -1 || write(fd, info, sizeof(*info)) != sizeof(*info) ||
+                write(fd, key, info->key_len) != (ssize_t)info->key_len) {
+                fprintf(stderr, "%s: %s\n", info_path, strerror(errno));
+                goto out;
+        }
+        close(fd);
+        fd = -1;
+        ret = read_whole_file(path, info->digest, info->digest_len, &names,
+                &length);
+        if (ret == -1)
+                goto out;
+        for (name = names; name != NULL && name < names + length;
+                name += skip) {
+                skip = strlen(name) + 1;
+                if (strcmp(name, filename) == 0) {
+                        ret = 0;
+                        goto out;
+                }
+        }
+        tmp = (char *)realloc(names, length + strlen(filename) + 1);
+        if (tmp == NULL) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                ret = -1;
+                goto out;
+        }
+        names = tmp;
+        strcpy(names + length, filename);
+        length += strlen(filename) + 1;
+        ret = write_whole_file(path, info->digest, info->digest_len, names,
+                length);
+out:
+        clean_buff(&names);
+        if (fd != -1)
+                close(fd);
+        return ret;
+
+}
+
+/*
+ * Function to find the stub of a file with the same size and digest.
+ * Input:char *path,struct file_info *info,size_t name_size
+ * Output:char *name
+ */
+int
+find_whole_file(char *path, struct file_info *info, char *name,
+size_t name_size)
+{
+
+        int ret         =       -1;
+        size_t length   =        0;
+        char *names     =     NULL;
+        char *stub      =     NULL;
+        struct file_info found;
+
+        ret = read_whole_file(path, info->digest, info->digest_len, &names,
+                &length);
+        if (ret != 0)
+                goto out;
+        ret = 1;
+        for (stub = names; stub < names + length; stub += strlen(stub) + 1) {
+                if (strlen(stub) >= name_size)
+                        continue;
+                ret = read_file_info(path, stub, NULL, &found);
+                if (ret == -1)
+                        goto out;
+                if (ret == 0 && found.size == info->size &&
+                        found.digest_len == info->digest_len &&
+                        memcmp(found.digest, info->digest,
+                        info->digest_len) == 0) {
+                        strcpy(name, stub);
+                        goto out;
+                }
+                ret = 1;
+        }
+out:
+        clean_buff(&names);
+        return ret;
+
+}
+
+/*
+ * Function to copy <prefix><from> to <prefix><to> in the stub directory.
+ * Input:char *stub_dir,char *prefix,char *from,char *to,int optional - 1 if
+ * a missing source is not an error
+ * Output:int
+ */
+static int
+copy_stub_file(char *stub_dir, char *prefix, char *from, char *to,
+int optional)
+{
+
+        int ret         =       -1;
+        int fd_in       =       -1;
+        int fd_out      =       -1;
+        struct stat     st;
+        char from_path[1100];
+        char to_path[1100];
+
+        sprintf(from_path, "%s/%s%s", stub_dir, prefix, from);
+        sprintf(to_path, "%s/%s%s", stub_dir, prefix, to);
+        fd_in = open(from_path, O_RDONLY);
+        if (fd_in == -1) {
+                if (optional && errno == ENOENT) {
+                        if (remove(to_path) == -1 && errno != ENOENT)
+                                fprintf(stderr, "%s: %s\n", to_path,
+                                        strerror(errno));
+                        else
+                                ret = 0;
+                        goto out;
+                }
+                fprintf(stderr, "%s: %s\n", from_path, strerror(errno));
+                goto out;
+        }
+        fd_out = open(to_path, O_CREAT|O_WRONLY|O_TRUNC, S_IWUSR|S_IRUSR);
+        if (fd_out == -1 || fstat(fd_in, &st) == -1) {
+                fprintf(stderr, "%s: %s\n", to_path, strerror(errno));
+                goto out;
+        }
+        ret = copy_file_region(fd_in, 0, fd_out, 0, st.st_size);
+out:
+        if (fd_in != -1)
+                close(fd_in);
+        if (fd_out != -1)
+                close(fd_out);
+        return ret;
+
+}
+
+/*
+ * Function to give a file the stub and stub index of another.
+ * Input:char *path,char *from,char *to
+ * Output:int
+ */
 int
-delete_stub_store(char *path, char *filename)
+clone_stub(char *path, char *from, char *to)
+{
+
+        int ret         =       -1;
+        char stub_dir[1024];
+
+        if (strcmp(from, to) == 0) {
+                ret = 0;
+                goto out;
+        }
+        sprintf(stub_dir, "%s/store_block/stubs", path);
+        ret = copy_stub_file(stub_dir, "Stub_", from, to, 0);
+        if (ret == -1)
+                goto out;
+        ret = copy_stub_file(stub_dir, "Index_", from, to, 1);
+out:
+        return ret;
+
+}
+
+int
+delete_stub_store(char *path, char *filename, char *name)
 {
 
         int ret         =       -1;
         DIR *dp = NULL;
         char stub_path[1024];
+        char index_path[1100];
 
-        ret = reset_catalog(filename, path);
+        ret = reset_catalog(filename, name);
         if(ret == -1) {
                 goto out;
         }
-        filename = basename(filename);
+        filename = basename(name != NULL ? name : filename);
         strcpy(stub_path,path);
         sprintf(stub_path, "%s/store_block/stubs", stub_path);
         dp = opendir(stub_path);
@@ -63,6 +474,15 @@ delete_stub_store(char *path, char *filename)
                 fprintf(stderr, "%s\n", strerror(errno));
                 goto out;
         }
+        ret = release_file_info(path, filename);
+        if (ret == -1)
+                goto out;
+        sprintf(index_path, "%s/Index_%s", stub_path, filename);
+        if (remove(index_path) == -1 && errno != ENOENT) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                ret = -1;
+                goto out;
+        }
         sprintf (stub_path,"%s/Stub_%s", stub_path, filename);
         printf("%s", stub_path);
         ret = remove(stub_path);
@@ -78,30 +498,492 @@ out:
 
 }
 
+/*
+ * Function to truncate a stub, write its header with STUB_FORMAT_VERSION
+ * and allocate the record buffer.
+ * Input:struct stub_writer *stub,int fd_stub,int store_type,int digest_len
+ * Output:int
+ */
 int
-write_to_stub(char buff[],size_t length,int fd_stub,int b_offset,int e_offset)
+stub_writer_open(struct stub_writer *stub, int fd_stub, int store_type,
+int digest_len)
 {
 
-        int ret         =        -1;
+        int ret         =       -1;
+        struct store_header header;
 
-        if (write (fd_stub, &length, int_size) == -1) {
+        memset(stub, 0, sizeof(*stub));
+        stub->fd = fd_stub;
+        stub->digest_len = digest_len;
+        if (ftruncate(fd_stub, 0) == -1 || lseek(fd_stub, 0, SEEK_SET) == -1) {
                 fprintf(stderr, "%s\n", strerror(errno));
                 goto out;
         }
-        if (-1 == write(fd_stub, buff, length)) {
+        memset(&header, 0, STORE_HEADER_SIZE);
+        memcpy(header.magic, STUB_STORE_MAGIC, MAGIC_LEN);
+        header.version = STUB_FORMAT_VERSION;
+        header.digest_len = digest_len;
+        header.store_type = store_type;
+        if (write(fd_stub, &header, STORE_HEADER_SIZE) != STORE_HEADER_SIZE) {
                 fprintf(stderr, "%s\n", strerror(errno));
                 goto out;
         }
-        if (write (fd_stub, &b_offset, int_size) == -1) {
-                fprintf(stderr,"%s\n",strerror(errno));
+        stub->buf = (char *)malloc(STUB_BUFFER_SIZE);
+        if (stub->buf == NULL) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                goto out;
+        }
+        ret = 0;
+out:
+        return ret;
+
+}
+
+/*
+ * Function to write the buffered records of a stub.
+ * Input:struct stub_writer *stub
+ * Output:int
+ */
+int
+stub_writer_flush(struct stub_writer *stub)
+{
+
+        ssize_t count   =        0;
+        size_t  done    =        0;
+
+        while (done < stub->used) {
+                count = write(stub->fd, stub->buf + done, stub->used - done);
+                if (count == -1) {
+                        if (errno == EINTR)
+                                continue;
+                        fprintf(stderr, "%s\n", strerror(errno));
+                        return -1;
+                }
+                done += count;
+        }
+        stub->written += stub->used;
+        stub->used = 0;
+        return 0;
+
+}
+
+/*
+ * Function to free a stub writer, buffered records are dropped.
+ * Input:struct stub_writer *stub
+ * Output:void
+ */
+void
+stub_writer_free(struct stub_writer *stub)
+{
+
+        free(stub->buf);
+        free(stub->index);
+        stub->buf = NULL;
+        stub->index = NULL;
+        stub->used = 0;
+        stub->nr_index = 0;
+        stub->alloc_index = 0;
+
+}
+
+/*
+ * Function to add a compact record of fingerprint and length of a block to
+ * the stub. The offsets are not stored, blocks have to be added in file
+ * order without gaps.
+ * Input:DIGEST *digest,size_t length,struct stub_writer *stub,
+ * uint64_t b_offset,uint64_t e_offset
+ * Output:int
+ */
+int
+write_to_stub(DIGEST *digest, size_t length, struct stub_writer *stub,
+uint64_t b_offset, uint64_t e_offset)
+{
+
+        int ret         =       -1;
+        uint64_t size   =        0;
+        size_t alloc    =        0;
+        char *p         =       NULL;
+        struct stub_index_entry *index = NULL;
+
+        if (b_offset != stub->offset || e_offset + 1 < b_offset ||
+                length != (size_t)stub->digest_len) {
+                fprintf(stderr, "Stub record out of order\n");
+                goto out;
+        }
+        if (stub->used + length + STUB_VARINT_MAX > STUB_BUFFER_SIZE &&
+                stub_writer_flush(stub) == -1)
+                goto out;
+        if (stub->records % STUB_INDEX_INTERVAL == 0) {
+                if (stub->nr_index == stub->alloc_index) {
+                        alloc = stub->alloc_index ? stub->alloc_index * 2 : 64;
+                        index = (struct stub_index_entry *)realloc(stub->index,
+                                alloc * sizeof(struct stub_index_entry));
+                        if (index == NULL) {
+                                fprintf(stderr, "%s\n", strerror(errno));
+                                goto out;
+                        }
+                        stub->index = index;
+                        stub->alloc_index = alloc;
+                }
+                stub->index[stub->nr_index].b_offset = b_offset;
+                stub->index[stub->nr_index].pos = STORE_HEADER_SIZE +
+                        stub->written + stub->used;
+                stub->nr_index++;
+        }
+        p = stub->buf + stub->used;
+        memcpy(p, digest, length);
+        p += length;
+        size = e_offset + 1 - b_offset;
+        while (size >= 0x80) {
+                *p++ = (char)(size | 0x80);
+                size >>= 7;
+        }
+        *p++ = (char)size;
+        stub->used = p - stub->buf;
+        stub->offset = e_offset + 1;
+        stub->records++;
+        ret = 0;
+out:
+        return ret;
+
+}
+
+/*
+ * Function to write the index of a flushed stub to Index_<filename> next to
+ * the stub.
+ * Input:struct stub_writer *stub,char *path,char *filename
+ * Output:int
+ */
+int
+write_stub_index(struct stub_writer *stub, char *path, char *filename)
+{
+
+        int ret         =       -1;
+        int fd          =       -1;
+        size_t size     =        0;
+        uint64_t stub_size =     0;
+        char index_path[1024];
+        struct store_header header;
+
+        sprintf(index_path, "%s/store_block/stubs/Index_%s", path, filename);
+        fd = open(index_path, O_CREAT|O_WRONLY|O_TRUNC, S_IWUSR|S_IRUSR);
+        if (fd == -1) {
+                fprintf(stderr, "%s: %s\n", index_path, strerror(errno));
                 goto out;
         }
-        if (write (fd_stub, &e_offset, int_size) == -1) {
-                fprintf(stderr,"%s\n",strerror(errno));
+        memset(&header, 0, STORE_HEADER_SIZE);
+        memcpy(header.magic, STUB_INDEX_MAGIC, MAGIC_LEN);
+        header.version = STUB_FORMAT_VERSION;
+        header.digest_len = stub->digest_len;
+        stub_size = STORE_HEADER_SIZE + stub->written;
+        size = stub->nr_index * sizeof(struct stub_index_entry);
+        if (write(fd, &header, STORE_HEADER_SIZE) != STORE_HEADER_SIZE ||
+                write(fd, &stub_size, sizeof(stub_size)) !=
+                sizeof(stub_size) ||
+                (size > 0 && write(fd, stub->index, size) != (ssize_t)size)) {
+                fprintf(stderr, "%s: %s\n", index_path, strerror(errno));
                 goto out;
         }
-        ret=0;
+        ret = 0;
 out:
+        if (fd != -1)
+                close(fd);
         return ret;
 
 }
+
+/*
+ * Function to read the index of a compact stub.
+ * Input:char *path,char *filename,uint64_t stub_size
+ * Output:struct stub_index_entry **index,size_t *count - 0 entries when
+ * there is no index or it was written for another version of the stub
+ */
+static int
+read_stub_index(char *path, char *filename, uint64_t stub_size,
+struct stub_index_entry **index, size_t *count)
+{
+
+        int ret         =       -1;
+        int fd          =       -1;
+        uint64_t size   =        0;
+        char index_path[1024];
+        struct stat st;
+        struct store_header header;
+
+        *index = NULL;
+        *count = 0;
+        sprintf(index_path, "%s/store_block/stubs/Index_%s", path, filename);
+        fd = open(index_path, O_RDONLY);
+        if (fd == -1) {
+                if (errno == ENOENT)
+                        ret = 0;
+                else
+                        fprintf(stderr, "%s: %s\n", index_path,
+                                strerror(errno));
+                goto out;
+        }
+        if (fstat(fd, &st) == -1) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                goto out;
+        }
+        ret = 0;
+        if (read(fd, &header, STORE_HEADER_SIZE) != STORE_HEADER_SIZE ||
+                memcmp(header.magic, STUB_INDEX_MAGIC, MAGIC_LEN) != 0 ||
+                header.version != STUB_FORMAT_VERSION ||
+                read(fd, &size, sizeof(size)) != sizeof(size) ||
+                size != stub_size)
+                goto out;
+        *count = (st.st_size - STORE_HEADER_SIZE - sizeof(size)) /
+                sizeof(struct stub_index_entry);
+        if (*count == 0)
+                goto out;
+        *index = (struct stub_index_entry *)malloc(*count *
+                sizeof(struct stub_index_entry));
+        if (*index == NULL) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                ret = -1;
+                goto out;
+        }
+        size = *count * sizeof(struct stub_index_entry);
+        if (read(fd, *index, size) != (ssize_t)size) {
+                fprintf(stderr, "%s: truncated index\n", index_path);
+                ret = -1;
+        }
+out:
+        if (ret == -1 || *index == NULL) {
+                clean_buff((char **)index);
+                *count = 0;
+        }
+        if (fd != -1)
+                close(fd);
+        return ret;
+
+}
+
+/*
+ * Function to move a stub reader to the last record whose chunk begins at
+ * or before offset, as far as the stub index or the fixed width records
+ * tell. The reader then skips forward record by record.
+ * Input:struct stub_reader *reader,char *path,char *filename,
+ * uint64_t offset
+ * Output:int
+ */
+int
+stub_reader_seek(struct stub_reader *reader, char *path, char *filename,
+uint64_t offset)
+{
+
+        int ret                 =       -1;
+        size_t count            =        0;
+        size_t lo               =        0;
+        size_t hi               =        0;
+        size_t mid              =        0;
+        size_t record           =        0;
+        uint64_t pos            =       STORE_HEADER_SIZE;
+        uint64_t b_offset       =        0;
+        struct stat st;
+        struct stub_index_entry *index = NULL;
+
+        if (fstat(reader->fd, &st) == -1) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                goto out;
+        }
+        if (reader->version == STORE_FORMAT_VERSION) {
+                /* Records are fixed width and carry their offsets */
+                record = reader->digest_len + 2 * sizeof(uint64_t);
+                count = (st.st_size - STORE_HEADER_SIZE) / record;
+                lo = 0;
+                hi = count;
+                while (hi - lo > 1) {
+                        mid = lo + (hi - lo) / 2;
+                        if (pread(reader->fd, &b_offset, sizeof(b_offset),
+                                STORE_HEADER_SIZE + mid * record +
+                                reader->digest_len) != sizeof(b_offset)) {
+                                fprintf(stderr, "Truncated stub\n");
+                                goto out;
+                        }
+                        if (b_offset <= offset)
+                                lo = mid;
+                        else
+                                hi = mid;
+                }
+                pos = STORE_HEADER_SIZE + lo * record;
+                b_offset = 0;
+        } else {
+                ret = read_stub_index(path, filename, st.st_size, &index,
+                        &count);
+                if (ret == -1)
+                        goto out;
+                ret = -1;
+                lo = 0;
+                hi = count;
+                while (hi - lo > 1) {
+                        mid = lo + (hi - lo) / 2;
+                        if (index[mid].b_offset <= offset)
+                                lo = mid;
+                        else
+                                hi = mid;
+                }
+                if (count > 0 && index[lo].b_offset <= offset &&
+                        index[lo].pos >= STORE_HEADER_SIZE &&
+                        index[lo].pos <= (uint64_t)st.st_size) {
+                        pos = index[lo].pos;
+                        b_offset = index[lo].b_offset;
+                }
+        }
+        if (lseek(reader->fd, pos, SEEK_SET) == -1) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                goto out;
+        }
+        reader->pos = 0;
+        reader->length = 0;
+        reader->eof = 0;
+        reader->offset = b_offset;
+        ret = 0;
+out:
+        clean_buff((char **)&index);
+        return ret;
+
+}
+
+/*
+ * Function to start reading the records of a stub after its header.
+ * Input:struct stub_reader *reader,int fd_stub,struct store_header *header
+ * Output:int
+ */
+int
+stub_reader_open(struct stub_reader *reader, int fd_stub,
+struct store_header *header)
+{
+
+        int ret         =       -1;
+
+        memset(reader, 0, sizeof(*reader));
+        reader->fd = fd_stub;
+        reader->version = header->version;
+        reader->digest_len = header->digest_len;
+        if (header->digest_len > MAX_DIGEST_LEN) {
+                fprintf(stderr, "Invalid stub\n");
+                goto out;
+        }
+        if (lseek(fd_stub, STORE_HEADER_SIZE, SEEK_SET) == -1) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                goto out;
+        }
+        reader->buf = (char *)malloc(STUB_BUFFER_SIZE);
+        if (reader->buf == NULL) {
+                fprintf(stderr, "%s\n", strerror(errno));
+                goto out;
+        }
+        ret = 0;
+out:
+        return ret;
+
+}
+
+/*
+ * Function to make sure the buffer of a stub reader holds a whole record,
+ * or everything up to the end of the stub.
+ * Input:struct stub_reader *reader
+ * Output:int
+ */
+static int
+stub_reader_fill(struct stub_reader *reader)
+{
+
+        ssize_t count   =        0;
+
+        if (reader->length - reader->pos >= STUB_RECORD_MAX || reader->eof)
+                return 0;
+        memmove(reader->buf, reader->buf + reader->pos,
+                reader->length - reader->pos);
+        reader->length -= reader->pos;
+        reader->pos = 0;
+        while (reader->length < STUB_BUFFER_SIZE) {
+                count = read(reader->fd, reader->buf + reader->length,
+                        STUB_BUFFER_SIZE - reader->length);
+                if (count == -1) {
+                        if (errno == EINTR)
+                                continue;
+                        fprintf(stderr, "%s\n", strerror(errno));
+                        return -1;
+                }
+                if (count == 0) {
+                        reader->eof = 1;
+                        break;
+                }
+                reader->length += count;
+        }
+        return 0;
+
+}
+
+/*
+ * Function to read the next record of a stub, fixed width records of
+ * STORE_FORMAT_VERSION or compact ones of STUB_FORMAT_VERSION.
+ * Input:struct stub_reader *reader
+ * Output:DIGEST *digest,uint64_t *b_offset,uint64_t *e_offset
+ * int - 1 for a record, 0 at the end, -1 on error
+ */
+int
+stub_reader_next(struct stub_reader *reader, DIGEST *digest,
+uint64_t *b_offset, uint64_t *e_offset)
+{
+
+        size_t          left    =        0;
+        uint64_t        size    =        0;
+        int             shift   =        0;
+        unsigned char   *p      =     NULL;
+        unsigned char   *end    =     NULL;
+
+        if (stub_reader_fill(reader) == -1)
+                return -1;
+        left = reader->length - reader->pos;
+        if (left == 0)
+                return 0;
+        p = (unsigned char *)reader->buf + reader->pos;
+        end = p + left;
+        if (reader->version == STORE_FORMAT_VERSION) {
+                if (left < reader->digest_len + 2 * sizeof(uint64_t))
+                        goto truncated;
+                memcpy(digest, p, reader->digest_len);
+                p += reader->digest_len;
+                memcpy(b_offset, p, sizeof(*b_offset));
+                memcpy(e_offset, p + sizeof(*b_offset), sizeof(*e_offset));
+                reader->pos += reader->digest_len + 2 * sizeof(uint64_t);
+                return 1;
+        }
+        if (left <= (size_t)reader->digest_len)
+                goto truncated;
+        memcpy(digest, p, reader->digest_len);
+        p += reader->digest_len;
+        do {
+                if (p == end || shift >= 64)
+                        goto truncated;
+                size |= (uint64_t)(*p & 0x7f) << shift;
+                shift += 7;
+        } while (*p++ & 0x80);
+        *b_offset = reader->offset;
+        *e_offset = reader->offset + size - 1;
+        reader->offset += size;
+        reader->pos = p - (unsigned char *)reader->buf;
+        return 1;
+truncated:
+        fprintf(stderr, "Truncated stub\n");
+        return -1;
+
+}
+
+/*
+ * Function to free a stub reader.
+ * Input:struct stub_reader *reader
+ * Output:void
+ */
+void
+stub_reader_free(struct stub_reader *reader)
+{
+
+        free(reader->buf);
+        reader->buf = NULL;
+
+}
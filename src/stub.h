@@ -20,16 +20,219 @@
 #include<openssl/ssl.h>
 #include<openssl/sha.h>
 #endif
+#include "store_format.h"
 #define block 10
 #define NAME_SIZE 100
 #define int_size sizeof(int)
+#define STUB_RECORD_MAX (MAX_DIGEST_LEN + 2 * sizeof(uint64_t))
+/* Longest varint, 7 bits of a uint64_t per byte */
+#define STUB_VARINT_MAX 10
+/* Bytes of records collected before they are written at once */
+#define STUB_BUFFER_SIZE (1 << 20)
 
-/*@description:Function to write hash,beginning offset and ending offset of block to stub
-@in: char *buff-buffer containing hash,size_t l-length of hash,int filedes-file descriptor of stub,int b_offset-beginning offset of block,int e_offset-ending offset of bloc
-@out: int 
-@return: -1 for error and 0 if found. */
-int write_to_stub(char buff[],size_t l, int fd_stub, int b_offset, int e_offset);
+/* Records of a compact stub between two entries of its index */
+#define STUB_INDEX_INTERVAL 1024
+
+typedef unsigned char DIGEST;
+
+/*Entry of the index kept next to a compact stub, every STUB_INDEX_INTERVAL
+th record has one. The index file is a store header with
+STUB_INDEX_MAGIC, the size of the stub it was written for and the entries
+in the order of b_offset.
+        b_offset : Beginning offset of the chunk of the record
+        pos      : Position of the record in the stub
+*/
+struct stub_index_entry
+{
+        uint64_t        b_offset;
+        uint64_t        pos;
+};
+
+/*Stub being written with STUB_FORMAT_VERSION records. A record is the
+fingerprint of a chunk followed by its length as a varint, every chunk
+begins where the one before it ended.
+        offset  : Beginning offset of the next chunk
+        used    : Bytes of buf not written yet
+        written : Bytes written to the stub
+        records : Records added
+        index   : Entries of the stub index
+*/
+struct stub_writer
+{
+        int             fd;
+        int             digest_len;
+        uint64_t        offset;
+        char            *buf;
+        size_t          used;
+        uint64_t        written;
+        uint64_t        records;
+        struct stub_index_entry *index;
+        size_t          nr_index;
+        size_t          alloc_index;
+};
+
+/*Whole file a stub was written for, kept in Info_<filename> next to the
+stub. The file is a store header with FILE_INFO_MAGIC, this record and the
+catalog key of the file. Whole_<digest in hex> next to the stubs lists the
+names of the stubs of files with that digest, each ending with a NUL, so
+an identical file is found without chunking it as long as one of them is
+left.
+        size       : Size of the file
+        mtime_sec  : Modification time of the file
+        mtime_nsec : Nanoseconds of the modification time
+        digest     : Fingerprint of the whole file, of the hash type of the
+                     namespace
+        key_len    : Length of the catalog key that follows the record
+        chunks     : Chunks of the file
+*/
+struct file_info
+{
+        uint64_t        size;
+        int64_t         mtime_sec;
+        int64_t         mtime_nsec;
+        DIGEST          digest[MAX_DIGEST_LEN];
+        uint32_t        digest_len;
+        uint32_t        key_len;
+        uint64_t        chunks;
+};
+
+/*Buffered reader of the records of a stub of either version.
+        version : Version from the stub header
+        offset  : Beginning offset of the next chunk of a compact stub
+        pos     : Next unread byte of buf
+        length  : Bytes read into buf
+*/
+struct stub_reader
+{
+        int             fd;
+        int             version;
+        int             digest_len;
+        uint64_t        offset;
+        char            *buf;
+        size_t          pos;
+        size_t          length;
+        int             eof;
+};
+
+/*@description:Function to truncate a stub, write its header and get ready
+to write its records
+@in: int fd_stub-file descriptor of stub,int store_type-store of the blocks,
+int digest_len-length of fingerprints
+@out: struct stub_writer *stub-writer of the stub
+@return: -1 for error and 0 on success */
+int stub_writer_open(struct stub_writer *stub, int fd_stub, int store_type,
+        int digest_len);
+
+/*@description:Function to add the fingerprint and offsets of a block to a
+stub. Records are written when the buffer is full or on stub_writer_flush.
+@in: DIGEST *digest-fingerprint of block,size_t length-length of
+fingerprint,struct stub_writer *stub-writer of stub,uint64_t
+b_offset-beginning offset of block,uint64_t e_offset-ending offset of block
+@out: int
+@return: -1 for error and 0 if added successfully. */
+int write_to_stub(DIGEST *digest, size_t length, struct stub_writer *stub,
+        uint64_t b_offset, uint64_t e_offset);
+
+/*@description:Function to write the buffered records of a stub
+@in: struct stub_writer *stub-writer of stub
+@out: int
+@return: -1 for error and 0 if written successfully. */
+int stub_writer_flush(struct stub_writer *stub);
+
+/*@description:Function to write the index of a stub, after its records
+were flushed
+@in: struct stub_writer *stub-writer of stub,char *path-store path of
+namespace,char *filename-name of the file the stub belongs to
+@out: int
+@return: -1 for error and 0 if written successfully. */
+int write_stub_index(struct stub_writer *stub, char *path, char *filename);
+
+/*@description:Function to free a stub writer without writing the records
+still buffered, the file descriptor is left open
+@in: struct stub_writer *stub-writer of stub
+@out: void
+@return: void */
+void stub_writer_free(struct stub_writer *stub);
+
+/*@description:Function to start reading the records of a stub whose header
+was read already
+@in: int fd_stub-file descriptor of stub,struct store_header *header-header
+of the stub
+@out: struct stub_reader *reader-reader of the stub
+@return: -1 for error and 0 on success */
+int stub_reader_open(struct stub_reader *reader, int fd_stub,
+        struct store_header *header);
+
+/*@description:Function to move a stub reader to the record of the chunk
+holding offset or a record before it. Compact stubs are looked up in their
+index and read from the start when it is missing or out of date, fixed
+width stubs are searched directly.
+@in: struct stub_reader *reader-reader of the stub,char *path-store path of
+namespace,char *filename-name of the file the stub belongs to,uint64_t
+offset-offset in the file
+@out: int
+@return: -1 for error and 0 on success */
+int stub_reader_seek(struct stub_reader *reader, char *path, char *filename,
+        uint64_t offset);
+
+/*@description:Function to read the next record of a stub
+@in: struct stub_reader *reader-reader of the stub
+@out: DIGEST *digest-digest_len byte buffer for the fingerprint,uint64_t
+*b_offset-beginning offset of block,uint64_t *e_offset-ending offset of block
+@return: 1 for a record, 0 at the end of the stub and -1 for error */
+int stub_reader_next(struct stub_reader *reader, DIGEST *digest,
+        uint64_t *b_offset, uint64_t *e_offset);
+
+/*@description:Function to free a stub reader, the file descriptor is left
+open
+@in: struct stub_reader *reader-reader of the stub
+@out: void
+@return: void */
+void stub_reader_free(struct stub_reader *reader);
+
+/*@description:Function to write the whole file record of a stub and add
+the stub to the list of the digest of the file
+@in: char *path-store path of namespace,char *filename-name of the file the
+stub belongs to,char *key-catalog key of the file,struct file_info
+*info-size, modification time and digest of the file
+@out: int
+@return: -1 for error and 0 if written successfully. */
+int write_file_info(char *path, char *filename, char *key,
+        struct file_info *info);
+
+/*@description:Function to read the whole file record of a stub
+@in: char *path-store path of namespace,char *filename-name of the file the
+stub belongs to,char *key-catalog key the record must be written for, NULL
+for any
+@out: struct file_info *info-record of the stub
+@return: -1 for error, 1 if the stub has no record for key and 0 if read */
+int read_file_info(char *path, char *filename, char *key,
+        struct file_info *info);
+
+/*@description:Function to find a stub of a file with the same size and
+digest as info. Every stub listed for the digest is checked against its
+own record, so a stale entry is skipped.
+@in: char *path-store path of namespace,struct file_info *info-size and
+digest of the file,size_t name_size-size of name
+@out: char *name-name of the stub found
+@return: -1 for error, 1 if no stub was found and 0 if found */
+int find_whole_file(char *path, struct file_info *info, char *name,
+        size_t name_size);
+
+/*@description:Function to give a file the stub and stub index of another,
+the stub is copied in the kernel and shares extents where the filesystem
+supports reflinks
+@in: char *path-store path of namespace,char *from-name of the stub copied,
+char *to-name of the new stub
+@out: int
+@return: -1 for error and 0 if cloned. */
+int clone_stub(char *path, char *from, char *to);
 
 int init_stub_store(char *path, char *filename, int *fd_stub);
 
-int delete_stub_store(char *path, char *filename);
+/*@description:Function to delete a file from the catalog and its stub
+@in: char *path-store path of namespace,char *filename-path of the file,
+char *name-logical name of the file, NULL to delete it by path
+@out: int
+@return: -1 for error and 0 if deleted. */
+int delete_stub_store(char *path, char *filename, char *name);
@@ -1,56 +1,241 @@
+#include <errno.h>
+#include <limits.h>
 #include "vector.h"
 
-/*description:Function to create a new node of type vector_ptr.
+#define VECTOR_INIT_SLOTS       8
+
+/*description:Function to initialize an empty vector.
 Input:
-        void
+        vector_ptr list : Vector to initialize
 Output:
-        vector_ptr     : New node of type vector_ptr
+        None
 */
-vector_ptr
-getnode()
+void
+vector_init(vector_ptr list)
 {
-        vector_ptr new_node = NULL;
 
-        new_node = (vector_ptr)malloc(sizeof(vector_ptr));
-        return new_node;
+        memset(list, 0, sizeof(*list));
+
 }
 
-/*description:Function to insert buffer content to vector.
+/*description:Function to append a piece to a vector.
 Input:
-        void *data      : Holds the buffer content
-        vector_ptr list : Vector to store the buffer content
-        int *ret        : Returns the exit status
+        vector_ptr list : Vector
+        void *data      : Piece to append
+        size_t length   : Length of the piece
 Output:
-        vector_ptr      : Vector that contains the buffer content
+        int             : 0 on success, -1 on failure
 */
-vector_ptr
-insert_vector_element(void *data, vector_ptr list, int *ret, int length)
+int
+vector_append(vector_ptr list, void *data, size_t length)
 {
 
-        vector_ptr      new_node        =       NULL;
-        vector_ptr      temp_node       =       NULL;
+        int             ret     =       -1;
+        int             alloc   =        0;
+        struct iovec    *tmp    =       NULL;
 
-        new_node = getnode();
-        if (new_node == NULL) {
-                *ret = -1;
-                goto out;
+        if (list->count + 1 >= list->alloc) {
+                alloc = list->alloc ? list->alloc * 2 : VECTOR_INIT_SLOTS;
+                tmp = (struct iovec *)realloc(list->slots,
+                        alloc * sizeof(struct iovec));
+                if (tmp == NULL) {
+                        fprintf(stderr, "Error in vector allocation\n");
+                        goto out;
+                }
+                list->slots = tmp;
+                list->iov = tmp + 1;
+                list->alloc = alloc;
+        }
+        list->iov[list->count].iov_base = data;
+        list->iov[list->count].iov_len = length;
+        list->count++;
+        list->length += length;
+        ret = 0;
+out:
+        return ret;
+
+}
+
+/*description:Function to drop all pieces of a vector.
+Input:
+        vector_ptr list : Vector
+Output:
+        None
+*/
+void
+vector_reset(vector_ptr list)
+{
+
+        list->count = 0;
+        list->length = 0;
+
+}
+
+/*description:Function to free the array of a vector.
+Input:
+        vector_ptr list : Vector
+Output:
+        None
+*/
+void
+vector_free(vector_ptr list)
+{
+
+        free(list->slots);
+        vector_init(list);
+
+}
+
+/*description:Function to write a buffer completely.
+Input:
+        int fd          : File descriptor
+        void *buf       : Buffer
+        size_t length   : Length of the buffer
+        off_t offset    : Offset in the file, -1 for the current offset
+Output:
+        int             : 0 on success, -1 on failure
+*/
+static int
+write_full(int fd, const char *buf, size_t length, off_t offset)
+{
+
+        ssize_t         count   =       0;
+
+        while (length > 0) {
+                if (offset < 0)
+                        count = write(fd, buf, length);
+                else
+                        count = pwrite(fd, buf, length, offset);
+                if (count < 0) {
+                        if (errno == EINTR)
+                                continue;
+                        return -1;
+                }
+                buf += count;
+                length -= count;
+                if (offset >= 0)
+                        offset += count;
         }
-        new_node->length = length;
-        new_node->vector_element = (void *)calloc(1, new_node->length + 1);
-        if (new_node->vector_element == NULL) {
-                *ret = -1;
+        return 0;
+
+}
+
+/*description:Function to write a header and the pieces of a vector with
+one system call. Short writes and vectors longer than IOV_MAX finish the
+rest piece by piece.
+Input:
+        int fd          : File descriptor
+        vector_ptr list : Vector
+        void *header    : Header, NULL for none
+        size_t header_len : Length of the header
+        off_t offset    : Offset in the file, -1 for the current offset
+Output:
+        int             : 0 on success, -1 on failure
+*/
+static int
+vector_write(int fd, vector_ptr list, void *header, size_t header_len,
+        off_t offset)
+{
+
+        int             ret     =       -1;
+        int             i       =        0;
+        int             count   =        0;
+        size_t          total   =        0;
+        size_t          skip    =        0;
+        ssize_t         done    =        0;
+        struct iovec    *iov    =       NULL;
+
+        if (header == NULL)
+                header_len = 0;
+        total = header_len + list->length;
+        if (list->count > 0) {
+                iov = list->iov;
+                count = list->count;
+                if (header_len > 0) {
+                        iov = list->slots;
+                        iov[0].iov_base = header;
+                        iov[0].iov_len = header_len;
+                        count++;
+                }
+                if (count <= IOV_MAX) {
+                        if (offset < 0)
+                                done = writev(fd, iov, count);
+                        else
+                                done = pwritev(fd, iov, count, offset);
+                        if (done < 0 && errno != EINTR)
+                                goto out;
+                        if (done < 0)
+                                done = 0;
+                }
+        }
+        if ((size_t)done == total) {
+                ret = 0;
                 goto out;
         }
-        memcpy(new_node->vector_element, data, new_node->length);
-        new_node->next = NULL;
-        if (list != NULL) {
-                for (temp_node = list; temp_node->next != NULL;
-                temp_node = temp_node->next)
-                        ;
-                temp_node->next = new_node;
-        } else
-                list = new_node;
+        /* Finish what writev() left, a piece at a time */
+        skip = done;
+        if (skip < header_len) {
+                if (write_full(fd, (char *)header + skip, header_len - skip,
+                        offset < 0 ? -1 : offset + (off_t)skip) == -1)
+                        goto out;
+                skip = header_len;
+        }
+        skip -= header_len;
+        total = header_len;
+        for (i = 0; i < list->count; i++) {
+                if (skip >= list->iov[i].iov_len) {
+                        skip -= list->iov[i].iov_len;
+                        total += list->iov[i].iov_len;
+                        continue;
+                }
+                if (write_full(fd, (char *)list->iov[i].iov_base + skip,
+                        list->iov[i].iov_len - skip,
+                        offset < 0 ? -1 : offset + (off_t)(total + skip))
+                        == -1)
+                        goto out;
+                total += list->iov[i].iov_len;
+                skip = 0;
+        }
+        ret = 0;
 out:
-        return list;
+        return ret;
+
 }
 
+/*description:Function to write a record header and the pieces of a
+vector at the current file offset.
+Input:
+        int fd          : File descriptor
+        vector_ptr list : Vector
+        void *header    : Header, NULL for none
+        size_t header_len : Length of the header
+Output:
+        int             : 0 on success, -1 on failure
+*/
+int
+vector_writev(int fd, vector_ptr list, void *header, size_t header_len)
+{
+
+        return vector_write(fd, list, header, header_len, -1);
+
+}
+
+/*description:Function to write a record header and the pieces of a
+vector at an offset.
+Input:
+        int fd          : File descriptor
+        vector_ptr list : Vector
+        void *header    : Header, NULL for none
+        size_t header_len : Length of the header
+        off_t offset    : Offset of the header in the file
+Output:
+        int             : 0 on success, -1 on failure
+*/
+int
+vector_pwritev(int fd, vector_ptr list, void *header, size_t header_len,
+        off_t offset)
+{
+
+        return vector_write(fd, list, header, header_len, offset);
+
+}
@@ -1,31 +1,93 @@
+#ifndef __VECTOR_H__
+#define __VECTOR_H__
+
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/uio.h>
 
-/*Structure to store buffer contents and the length until the chunk is found*/
+/*Structure to hold a chunk as pieces of memory it does not own. The
+pieces are kept in one growable iovec array so the chunk can be hashed
+piece by piece and written with a single writev().
+        slots  : slots[0] is reserved for a record header written in front
+                 of the chunk, the pieces follow it
+        iov    : First piece, slots + 1
+        count  : Number of pieces
+        length : Total bytes of all pieces
+A vector is meant to be reused for every chunk of a file, vector_reset()
+keeps the array.*/
 struct vector
 {
-        void *vector_element;
-        ssize_t length;
-        struct vector *next;
+        struct iovec *slots;
+        struct iovec *iov;
+        int count;
+        int alloc;
+        size_t length;
 };
 typedef struct vector *vector_ptr;
 
-/*@description:Function to create a new node of type vector_ptr.
-Input: 
-        void
+/*@description:Function to initialize an empty vector.
+Input:
+        vector_ptr list : Vector to initialize
+Output:
+        None
+*/
+void vector_init(vector_ptr list);
+
+/*@description:Function to append a piece to a vector, the data is not
+copied and has to outlive the vector.
+Input:
+        vector_ptr list : Vector
+        void *data      : Piece to append
+        size_t length   : Length of the piece
+Output:
+        int             : 0 on success, -1 on failure
+*/
+int vector_append(vector_ptr list, void *data, size_t length);
+
+/*@description:Function to drop all pieces of a vector and keep its array.
+Input:
+        vector_ptr list : Vector
 Output:
-        vector_ptr     : New node of type vector_ptr
+        None
 */
-vector_ptr getnode();
+void vector_reset(vector_ptr list);
 
-/*description:Function to insert buffer content to vector.
+/*@description:Function to free the array of a vector.
 Input:
-        void *data      : Holds the buffer content
-        vector_ptr list : Vector to store the buffer content
-        int *ret        : Returns the exit status
+        vector_ptr list : Vector
 Output:
-        vector_ptr      : Vector that contains the buffer content
+        None
 */
-vector_ptr insert_vector_element(void *data, vector_ptr list, int *ret, int length);
+void vector_free(vector_ptr list);
+
+/*@description:Function to write a record header and the pieces of a vector
+at the current file offset with one writev().
+Input:
+        int fd          : File descriptor
+        vector_ptr list : Vector
+        void *header    : Header, NULL for none
+        size_t header_len : Length of the header
+Output:
+        int             : 0 on success, -1 on failure
+*/
+int vector_writev(int fd, vector_ptr list, void *header, size_t header_len);
+
+/*@description:Function to write a record header and the pieces of a vector
+at an offset with one pwritev().
+Input:
+        int fd          : File descriptor
+        vector_ptr list : Vector
+        void *header    : Header, NULL for none
+        size_t header_len : Length of the header
+        off_t offset    : Offset of the header in the file
+Output:
+        int             : 0 on success, -1 on failure
+*/
+int vector_pwritev(int fd, vector_ptr list, void *header, size_t header_len,
+        off_t offset);
+
+#endif
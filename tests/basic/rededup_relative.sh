@@ -0,0 +1,31 @@
+#!/bin/bash
+# Script to dedup a file twice by its relative path, the second dedup
+# finds the file unchanged and the catalog keeps its stats.
+# Usage: rededup_relative.sh <yadl binary>
+
+yadl=${1:-yadl_dedup}
+work=`mktemp -d`
+work=`cd $work && pwd -P`
+trap 'echo y | $yadl --delete -n rededup_relative > /dev/null; rm -rf $work' EXIT
+
+mkdir -p $work/store
+head -c 1000000 /dev/urandom > $work/a.bin
+cd $work
+
+$yadl --create -n rededup_relative -p $work/store -s default -h sha1 \
+        --chunk_scheme variable > /dev/null || exit 1
+$yadl --dedup -n rededup_relative -f a.bin > /dev/null || exit 1
+output=`$yadl --dedup -n rededup_relative -f a.bin`
+list=`$yadl --list -n rededup_relative`
+
+if echo "$output" | grep -q "unchanged since it was deduped" &&
+        echo "$list" | grep -q "^$work/a.bin$" &&
+        ! echo "$list" | grep -q " 0 unique bytes"
+then
+        echo "Relative re-dedup Passed"
+else
+        echo "Relative re-dedup Failed"
+        echo "$output"
+        echo "$list"
+        exit 1
+fi
@@ -0,0 +1,36 @@
+#!/bin/bash
+# Script to dedup stdin under a logical name, delete it by that name and
+# dedup it again, the second dedup is refused until the delete.
+# Usage: rededup_stream.sh <yadl binary>
+
+yadl=${1:-yadl_dedup}
+work=`mktemp -d`
+work=`cd $work && pwd -P`
+trap 'echo y | $yadl --delete -n rededup_stream > /dev/null; rm -rf $work' EXIT
+
+mkdir -p $work/store
+head -c 1000000 /dev/urandom > $work/a.bin
+
+$yadl --create -n rededup_stream -p $work/store -s default -h sha1 \
+        --chunk_scheme variable > /dev/null || exit 1
+$yadl --dedup -n rededup_stream -f - --logical_name a.dump \
+        < $work/a.bin > /dev/null || exit 1
+$yadl --dedup -n rededup_stream -f - --logical_name a.dump \
+        < $work/a.bin > /dev/null 2>&1 && exit 1
+echo y | $yadl --delete -n rededup_stream -f - --logical_name a.dump \
+        > /dev/null || exit 1
+deleted=`$yadl --list -n rededup_stream`
+$yadl --dedup -n rededup_stream -f - --logical_name a.dump \
+        < $work/a.bin > /dev/null || exit 1
+$yadl --restore -n rededup_stream -f - --logical_name a.dump \
+        > $work/out.bin 2> /dev/null || exit 1
+
+if ! echo "$deleted" | grep -q "a.dump" &&
+        cmp -s $work/a.bin $work/out.bin
+then
+        echo "Stream re-dedup Passed"
+else
+        echo "Stream re-dedup Failed"
+        echo "$deleted"
+        exit 1
+fi